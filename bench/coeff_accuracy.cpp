@@ -0,0 +1,69 @@
+#include <audioeq/dsp/coeffs.h>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/* Accuracy of interpolated coefficient tables against exact design,
+ * and the cost of a table lookup against a full design. */
+
+using namespace aeq::dsp;
+
+struct Case {
+	const char *name;
+	FilterType type;
+	float q;
+	float gain_db;
+};
+
+static const Case cases[] = {
+	{"one-pole lp",	FilterType::OnePoleLowPass,	0.0F,	0.0F},
+	{"lp q0.707",	FilterType::LowPass,		0.707F,	0.0F},
+	{"hp q0.707",	FilterType::HighPass,		0.707F,	0.0F},
+	{"bp q4",	FilterType::BandPass,		4.0F,	0.0F},
+	{"notch q10",	FilterType::Notch,		10.0F,	0.0F},
+	{"peak q1 +6",	FilterType::Peaking,		1.0F,	6.0F},
+	{"peak q8 -12",	FilterType::Peaking,		8.0F,	-12.0F},
+	{"lshelf +6",	FilterType::LowShelf,		0.707F,	6.0F},
+	{"hshelf -6",	FilterType::HighShelf,		0.707F,	-6.0F},
+};
+
+int main()
+{
+	CoefficientCache cache;
+
+	for (int sample_rate : {44100, 48000, 96000}) {
+		std::printf("sample rate %d Hz\n", sample_rate);
+		std::printf("  %-12s %14s %16s %16s\n", "type", "max coeff err", "max resp err dB", "mean resp err dB");
+		for (const auto& c : cases) {
+			auto table = cache.get_table(c.type, c.q, c.gain_db, sample_rate);
+			auto report = table->measure_accuracy();
+			std::printf("  %-12s %14.3g %16.3g %16.3g\n", c.name,
+					report.max_coeff_err, report.max_response_err_db,
+					report.mean_response_err_db);
+		}
+	}
+
+	// sweep cost
+	constexpr size_t nr_updates = 1000000;
+	std::vector<float> freqs(nr_updates);
+	for (size_t i = 0; i < nr_updates; ++i)
+		freqs[i] = 20.0F + 19980.0F * float(i % 4096) / 4096;
+
+	auto table = cache.get_table(FilterType::Peaking, 1.0F, 6.0F, 48000);
+	volatile float sink = 0.0F;
+
+	auto start = std::chrono::steady_clock::now();
+	for (float freq : freqs)
+		sink = sink + design(FilterType::Peaking, freq, 1.0F, 6.0F, 48000).b0;
+	auto design_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for (float freq : freqs)
+		sink = sink + table->lookup(freq).b0;
+	auto lookup_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("exact design: %.1f ns/update, table lookup: %.1f ns/update\n",
+			design_ns / nr_updates, lookup_ns / nr_updates);
+	return 0;
+}
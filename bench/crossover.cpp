@@ -0,0 +1,119 @@
+#include <audioeq/dsp/biquad.h>
+#include <audioeq/dsp/crossover.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/* 4-way stereo Linkwitz-Riley crossover: the shared tree of dsp::LRCrossover against four
+ * independent per-band cascades (the cost of four separate crossover filter instances).
+ * Also checks both produce the same bands and that the bands sum to an allpass of the input. */
+
+using namespace aeq::dsp;
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_channels = 2;
+constexpr size_t quantum = 1024;
+constexpr size_t nr_samples = 1 << 20;
+static const std::vector<float> freqs {120.0F, 800.0F, 4000.0F};
+constexpr float butterworth_q = float(M_SQRT1_2);
+
+/* Stages of band k of an independent instance: high passes of the splits below, low pass of its
+ * own split and allpasses of the splits above. */
+static std::vector<BiquadStage> band_stages(size_t band)
+{
+	std::vector<BiquadStage> stages;
+	auto add = [&](FilterType type, float freq)
+	{
+		stages.emplace_back(design(type, freq, butterworth_q, 0.0F, sample_rate), StatePrecision::F32);
+	};
+	for (size_t j = 0; j < band; ++j) {
+		add(FilterType::HighPass, freqs[j]);
+		add(FilterType::HighPass, freqs[j]);
+	}
+	if (band < freqs.size()) {
+		add(FilterType::LowPass, freqs[band]);
+		add(FilterType::LowPass, freqs[band]);
+	}
+	for (size_t j = band + 2; j <= freqs.size(); ++j)
+		add(FilterType::AllPass, freqs[j - 1]);
+	return stages;
+}
+
+int main()
+{
+	const size_t nr_bands = freqs.size() + 1;
+
+	std::mt19937 rng {1234};
+	std::uniform_real_distribution<float> dist {-0.5F, 0.5F};
+	std::vector<std::vector<float>> input(nr_channels, std::vector<float>(nr_samples));
+	for (auto& channel : input)
+		for (auto& x : channel)
+			x = dist(rng);
+
+	std::vector<std::vector<float>> tree_out(nr_bands * nr_channels, std::vector<float>(nr_samples));
+	std::vector<std::vector<float>> indep_out(nr_bands * nr_channels, std::vector<float>(nr_samples));
+
+	// shared tree
+	LRCrossover<float> crossover {freqs, sample_rate, nr_channels};
+	std::vector<const float *> in_ptrs(nr_channels);
+	std::vector<float *> out_ptrs(nr_bands * nr_channels);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t offset = 0; offset < nr_samples; offset += quantum) {
+		for (unsigned int ch = 0; ch < nr_channels; ++ch)
+			in_ptrs[ch] = input[ch].data() + offset;
+		for (size_t i = 0; i < out_ptrs.size(); ++i)
+			out_ptrs[i] = tree_out[i].data() + offset;
+		crossover.process(in_ptrs.data(), out_ptrs.data(), quantum);
+	}
+	double tree_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// independent instances
+	std::vector<std::vector<BiquadStage>> stages;
+	std::vector<std::vector<BiquadStageState>> states;
+	size_t nr_indep_stages = 0;
+	for (size_t band = 0; band < nr_bands; ++band) {
+		stages.push_back(band_stages(band));
+		nr_indep_stages += stages.back().size() * nr_channels;
+		for (unsigned int ch = 0; ch < nr_channels; ++ch)
+			states.emplace_back(stages.back().size());
+	}
+	start = std::chrono::steady_clock::now();
+	for (size_t offset = 0; offset < nr_samples; offset += quantum) {
+		for (size_t band = 0; band < nr_bands; ++band) {
+			for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+				size_t i = band * nr_channels + ch;
+				process_cascade(stages[band].data(), states[i].data(), stages[band].size(),
+						input[ch].data() + offset, indep_out[i].data() + offset, quantum);
+			}
+		}
+	}
+	double indep_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// the bands must match and sum to an allpass: same energy as the input
+	double max_diff = 0.0;
+	for (size_t i = 0; i < tree_out.size(); ++i)
+		for (size_t n = 0; n < nr_samples; ++n)
+			max_diff = std::fmax(max_diff, std::fabs(tree_out[i][n] - indep_out[i][n]));
+
+	double in_energy = 0.0, sum_energy = 0.0;
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		// skip the start, where the energy is still spreading through the filters
+		for (size_t n = sample_rate; n < nr_samples; ++n) {
+			double sum = 0.0;
+			for (size_t band = 0; band < nr_bands; ++band)
+				sum += tree_out[band * nr_channels + ch][n];
+			in_energy += double(input[ch][n]) * input[ch][n];
+			sum_energy += sum * sum;
+		}
+	}
+
+	const size_t nr_tree_stages = (freqs.size() * 4 + freqs.size() * (freqs.size() - 1) / 2) * nr_channels;
+	std::printf("%-12s %8s %14s\n", "", "biquads", "Mframes/s");
+	std::printf("%-12s %8zu %14.1f\n", "shared tree", nr_tree_stages, nr_samples / tree_s / 1e6);
+	std::printf("%-12s %8zu %14.1f\n", "independent", nr_indep_stages, nr_samples / indep_s / 1e6);
+	std::printf("speedup %.2fx, max band diff %.2e, band sum energy %+.4f dB\n",
+			indep_s / tree_s, max_diff, 10.0 * std::log10(sum_energy / in_energy));
+}
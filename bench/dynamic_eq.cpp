@@ -0,0 +1,145 @@
+#include <audioeq/dsp/biquad.h>
+#include <audioeq/dsp/dynamic_eq.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/* 6-band stereo dynamic equalizer: dsp::DynamicEq against the usual structure of a separate
+ * sidechain band pass per band feeding the follower, and a bell cascade redesigned at every
+ * gain update. Also checks the steady state gain of a band on a sine at its frequency. */
+
+using namespace aeq::dsp;
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_channels = 2;
+constexpr size_t quantum = 1024;
+constexpr size_t nr_samples = 1 << 20;
+constexpr size_t control_interval = DynamicEq<float>::control_interval;
+
+static const std::vector<DynamicBand> bands {
+	{60.0F,		1.0F,	-24.0F,	3.0F,	-6.0F,	20.0F,	200.0F},
+	{250.0F,	2.0F,	-30.0F,	4.0F,	-9.0F,	10.0F,	120.0F},
+	{1200.0F,	4.0F,	-30.0F,	4.0F,	-9.0F,	5.0F,	80.0F},
+	{3500.0F,	6.0F,	-36.0F,	6.0F,	-12.0F,	2.0F,	60.0F},
+	{6500.0F,	3.0F,	-30.0F,	4.0F,	-12.0F,	1.0F,	50.0F},
+	{11000.0F,	2.0F,	-40.0F,	2.0F,	4.0F,	5.0F,	100.0F},
+};
+
+/* Sidechain band pass, follower and redesigned bell of one band and channel. */
+struct ConventionalBand {
+	BiquadStage detector;
+	BiquadStageState detector_state;
+	BiquadStage bell;
+	BiquadStageState bell_state;
+	float env = 0.0F;
+	float attack;
+	float release;
+};
+
+static float gain_db(const DynamicBand& band, float env)
+{
+	float over = 20.0F * std::log10(std::fmax(env, 1e-10F)) - band.threshold_db;
+	if (over <= 0.0F)
+		return 0.0F;
+	float gain = over * (1.0F - 1.0F / band.ratio);
+	return band.range_db < 0.0F ? -std::fmin(gain, -band.range_db) : std::fmin(gain, band.range_db);
+}
+
+static void process_conventional(std::vector<ConventionalBand>& chain, const float *in, float *out, size_t n)
+{
+	float sidechain[control_interval];
+	for (size_t start = 0; start < n; start += control_interval) {
+		const size_t len = std::min(control_interval, n - start);
+		for (size_t i = 0; i < len; ++i)
+			out[start + i] = in[start + i];
+		for (size_t b = 0; b < chain.size(); ++b) {
+			ConventionalBand& band = chain[b];
+			process_stage(band.detector, band.detector_state, in + start, sidechain, len);
+			for (size_t i = 0; i < len; ++i) {
+				float level = std::fabs(sidechain[i]);
+				band.env += (level > band.env ? band.attack : band.release) * (level - band.env);
+			}
+			band.bell = BiquadStage(design(FilterType::Peaking, bands[b].freq, bands[b].q,
+						gain_db(bands[b], band.env), sample_rate), StatePrecision::F32);
+			process_stage(band.bell, band.bell_state, out + start, out + start, len);
+		}
+	}
+}
+
+/* Level in dB of the last second of a signal. */
+static double level_db(const std::vector<float>& signal)
+{
+	double sum = 0.0;
+	for (size_t i = signal.size() - sample_rate; i < signal.size(); ++i)
+		sum += double(signal[i]) * signal[i];
+	return 10.0 * std::log10(sum / sample_rate * 2.0);
+}
+
+int main()
+{
+	std::mt19937 rng {1234};
+	std::normal_distribution<float> dist {0.0F, 0.1F};
+	std::vector<std::vector<float>> input(nr_channels, std::vector<float>(nr_samples));
+	for (auto& channel : input)
+		for (auto& x : channel)
+			x = dist(rng);
+	std::vector<std::vector<float>> output(nr_channels, std::vector<float>(nr_samples));
+
+	// shared band passes and followers
+	DynamicEq<float> eq {bands, sample_rate, nr_channels};
+	std::vector<const float *> in_ptrs(nr_channels);
+	std::vector<float *> out_ptrs(nr_channels);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t offset = 0; offset < nr_samples; offset += quantum) {
+		for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+			in_ptrs[ch] = input[ch].data() + offset;
+			out_ptrs[ch] = output[ch].data() + offset;
+		}
+		eq.process(in_ptrs.data(), out_ptrs.data(), quantum);
+	}
+	double shared_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// sidechain filters and redesigned bells
+	std::vector<std::vector<ConventionalBand>> chains(nr_channels);
+	for (auto& chain : chains) {
+		for (const DynamicBand& band : bands) {
+			ConventionalBand conv;
+			conv.detector = BiquadStage(design(FilterType::BandPass, band.freq, band.q, 0.0F, sample_rate),
+					StatePrecision::F32);
+			conv.attack = 1.0F - std::exp(-1000.0F / (band.attack_ms * sample_rate));
+			conv.release = 1.0F - std::exp(-1000.0F / (band.release_ms * sample_rate));
+			chain.push_back(conv);
+		}
+	}
+	start = std::chrono::steady_clock::now();
+	for (size_t offset = 0; offset < nr_samples; offset += quantum)
+		for (unsigned int ch = 0; ch < nr_channels; ++ch)
+			process_conventional(chains[ch], input[ch].data() + offset, output[ch].data() + offset, quantum);
+	double conv_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%-12s %14s\n", "", "Mframes/s");
+	std::printf("%-12s %14.1f\n", "shared", nr_samples / shared_s / 1e6);
+	std::printf("%-12s %14.1f\n", "sidechain", nr_samples / conv_s / 1e6);
+	std::printf("speedup %.2fx\n\n", conv_s / shared_s);
+
+	// steady state gain of the 6.5 kHz band, whose range is reached 24 dB above threshold
+	const DynamicBand& band = bands[4];
+	std::printf("%-10s %10s %10s %10s\n", "sine dBFS", "expected", "output", "band gain");
+	for (float sine_db : {-50.0F, -30.0F, -24.0F, -18.0F, -6.0F}) {
+		const float amp = std::pow(10.0F, sine_db / 20.0F);
+		std::vector<float> sine(2 * sample_rate), out(sine.size());
+		for (size_t i = 0; i < sine.size(); ++i)
+			sine[i] = amp * float(std::sin(2.0 * M_PI * band.freq * i / sample_rate));
+
+		DynamicEq<float> mono {{band}, sample_rate, 1};
+		const float *in_ptr = sine.data();
+		float *out_ptr = out.data();
+		mono.process(&in_ptr, &out_ptr, sine.size());
+
+		std::printf("%-10.0f %+10.2f %+10.2f %+10.2f\n", sine_db, gain_db(band, amp),
+				level_db(out) - sine_db, mono.get_gain_db(0, 0));
+	}
+}
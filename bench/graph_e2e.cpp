@@ -0,0 +1,417 @@
+#include <audioeq/audioeq.h>
+#include <audioeq/filters/equalizer.h>
+
+#include <dirent.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* End-to-end cost of the equalizer in a real graph, on a private headless pipewire daemon.
+ * For every quantum size and number of chained equalizers, the daemon is started with a null
+ * sink driving the graph, and a probe filter is linked around the chain:
+ *	probe out -> eq 0 -> ... -> eq n-1 -> probe in, null sink
+ * The probe sends an impulse into the chain every impulse_interval samples and times its
+ * return, so the round trip covers the graph scheduling of the chain. It also timestamps its
+ * own process callbacks for the jitter of the quantum period. CPU usage is that of this process
+ * (all filter callbacks run here) and of the daemon over the run.
+ * Needs the pipewire daemon executable in PATH. Usage: bench_graph_e2e [seconds per run] */
+
+extern char **environ;
+
+constexpr int sample_rate = 48000;
+constexpr size_t impulse_interval = sample_rate / 4;
+constexpr float onset_threshold = 1e-6F;
+constexpr size_t max_callbacks = 1 << 20;
+
+static const size_t quanta[] = {64, 128, 256, 512, 1024};
+static const size_t filter_counts[] = {1, 4, 16};
+
+static const aeq::PresetBand eq_bands[] = {
+	{uint32_t(aeq::dsp::FilterType::HighPass),	30.0F,		0.707F,	0.0F},
+	{uint32_t(aeq::dsp::FilterType::LowShelf),	100.0F,		0.707F,	3.0F},
+	{uint32_t(aeq::dsp::FilterType::Peaking),	400.0F,		1.0F,	-2.0F},
+	{uint32_t(aeq::dsp::FilterType::Peaking),	2500.0F,	2.0F,	1.5F},
+	{uint32_t(aeq::dsp::FilterType::HighShelf),	8000.0F,	0.707F,	-3.0F},
+};
+
+/* Sends impulses into its output and times their return at its input. */
+class ProbeFilter : public aeq::Filter {
+public:
+	ProbeFilter() : callback_times(max_callbacks) {}
+
+	void core_init(pw_filter *filter) override
+	{
+		Filter::core_init(filter);
+		add_audio_port(aeq::PortDirection::Input, "probe-in");
+		add_audio_port(aeq::PortDirection::Output, "probe-out");
+	}
+
+	/* Start timing from the next quantum, dropping what the graph did while being set up. */
+	void start()
+	{
+		started.store(true, std::memory_order_release);
+	}
+
+	void stop()
+	{
+		started.store(false, std::memory_order_release);
+	}
+
+	std::vector<uint64_t> latencies;
+	std::vector<int64_t> callback_times;
+	std::atomic<size_t> nr_callbacks {0};
+	std::atomic<size_t> nr_latencies {0};
+private:
+	void on_process(size_t nr_samples) override
+	{
+		if (!started.load(std::memory_order_acquire))
+			return silence(nr_samples);
+
+		size_t idx = nr_callbacks.load(std::memory_order_relaxed);
+		if (idx < callback_times.size()) {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			callback_times[idx] = int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+			nr_callbacks.store(idx + 1, std::memory_order_release);
+		}
+
+		const float *in = get_input_buffer(0, nr_samples);
+		if (in && waiting) {
+			for (size_t i = 0; i < nr_samples; ++i) {
+				if (std::fabs(in[i]) > onset_threshold) {
+					size_t n = nr_latencies.load(std::memory_order_relaxed);
+					if (n < latencies.capacity()) {
+						latencies.push_back(sample_pos + i - emitted_at);
+						nr_latencies.store(n + 1, std::memory_order_release);
+					}
+					waiting = false;
+					break;
+				}
+			}
+		}
+
+		float *out = get_output_buffer(0, nr_samples);
+		if (out) {
+			std::fill_n(out, nr_samples, 0.0F);
+			// one impulse at a time, so what comes back is unambiguous
+			if (!waiting && sample_pos + nr_samples > next_impulse) {
+				size_t offset = next_impulse > sample_pos ? next_impulse - sample_pos : 0;
+				out[offset] = 1.0F;
+				emitted_at = sample_pos + offset;
+				next_impulse = emitted_at + impulse_interval;
+				waiting = true;
+			}
+		}
+		sample_pos += nr_samples;
+	}
+
+	void silence(size_t nr_samples)
+	{
+		float *out = get_output_buffer(0, nr_samples);
+		if (out)
+			std::fill_n(out, nr_samples, 0.0F);
+	}
+
+	std::atomic<bool> started {false};
+	uint64_t sample_pos = 0;
+	uint64_t next_impulse = 0;
+	uint64_t emitted_at = 0;
+	bool waiting = false;
+};
+
+
+struct RunResult {
+	size_t quantum;
+	size_t nr_filters;
+	size_t nr_impulses;
+	uint64_t min_latency;
+	uint64_t max_latency;
+	double period_us;
+	double jitter_mean_us;
+	double jitter_max_us;
+	double client_cpu;
+	double daemon_cpu;
+};
+
+
+static double process_cpu_s()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+	     + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+
+static double daemon_cpu_s(pid_t pid)
+{
+	std::ifstream stat_file {"/proc/" + std::to_string(pid) + "/stat"};
+	std::string stat;
+	std::getline(stat_file, stat);
+	// utime and stime are fields 14 and 15, counted after the parenthesized command name
+	size_t pos = stat.rfind(')');
+	if (pos == std::string::npos)
+		return 0.0;
+	std::istringstream fields {stat.substr(pos + 2)};
+	std::string field;
+	unsigned long long utime = 0, stime = 0;
+	for (int i = 3; i <= 15 && fields >> field; ++i) {
+		if (i == 14)
+			utime = std::stoull(field);
+		else if (i == 15)
+			stime = std::stoull(field);
+	}
+	return double(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+
+static std::string write_config(const std::string& dir, const std::string& core_name, size_t quantum)
+{
+	std::string path = dir + "/daemon.conf";
+	std::ofstream conf {path};
+	conf << "context.properties = {\n"
+		"    core.daemon = true\n"
+		"    core.name = " << core_name << "\n"
+		"    support.dbus = false\n"
+		"    default.clock.rate = " << sample_rate << "\n"
+		"    default.clock.quantum = " << quantum << "\n"
+		"    default.clock.min-quantum = " << quantum << "\n"
+		"    default.clock.max-quantum = " << quantum << "\n"
+		"    default.clock.force-quantum = " << quantum << "\n"
+		"}\n"
+		"context.spa-libs = {\n"
+		"    audio.convert.* = audioconvert/libspa-audioconvert\n"
+		"    support.*       = support/libspa-support\n"
+		"}\n"
+		"context.modules = [\n"
+		"    { name = libpipewire-module-rt flags = [ ifexists nofail ] }\n"
+		"    { name = libpipewire-module-protocol-native }\n"
+		"    { name = libpipewire-module-client-node }\n"
+		"    { name = libpipewire-module-adapter }\n"
+		"    { name = libpipewire-module-link-factory }\n"
+		"]\n"
+		"context.objects = [\n"
+		"    { factory = spa-node-factory\n"
+		"        args = { factory.name = support.node.driver node.name = aeq-bench-dummy\n"
+		"            node.group = pipewire.dummy priority.driver = 1 } }\n"
+		"    { factory = adapter\n"
+		"        args = { factory.name = support.null-audio-sink node.name = aeq-bench-sink\n"
+		"            media.class = Audio/Sink audio.position = [ MONO ] priority.driver = 1000\n"
+		"            adapter.auto-port-config = { mode = dsp monitor = false position = preserve } } }\n"
+		"    { factory = adapter\n"
+		"        args = { factory.name = support.null-audio-sink node.name = aeq-bench-source\n"
+		"            media.class = Audio/Source/Virtual audio.position = [ MONO ]\n"
+		"            adapter.auto-port-config = { mode = dsp monitor = false position = preserve } } }\n"
+		"]\n";
+	return path;
+}
+
+
+/* Start the daemon and wait for its socket. */
+static pid_t start_daemon(const std::string& dir, const std::string& core_name, const std::string& conf_path)
+{
+	std::string runtime_env = "PIPEWIRE_RUNTIME_DIR=" + dir;
+	std::vector<std::string> env_strings {runtime_env};
+	for (char **env = environ; *env; ++env) {
+		if (std::strncmp(*env, "PIPEWIRE_RUNTIME_DIR=", 21) != 0)
+			env_strings.emplace_back(*env);
+	}
+	std::vector<char *> envp;
+	for (auto& env : env_strings)
+		envp.push_back(env.data());
+	envp.push_back(nullptr);
+
+	const char *argv[] = {"pipewire", "-c", conf_path.c_str(), nullptr};
+	pid_t pid;
+	if (posix_spawnp(&pid, "pipewire", nullptr, nullptr, const_cast<char **>(argv), envp.data()) != 0)
+		return -1;
+
+	std::string socket_path = dir + "/" + core_name;
+	for (int i = 0; i < 500; ++i) {
+		struct stat st;
+		if (stat(socket_path.c_str(), &st) == 0)
+			return pid;
+		if (waitpid(pid, nullptr, WNOHANG) == pid)
+			return -1;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	kill(pid, SIGTERM);
+	waitpid(pid, nullptr, 0);
+	return -1;
+}
+
+
+static void stop_daemon(pid_t pid)
+{
+	kill(pid, SIGTERM);
+	waitpid(pid, nullptr, 0);
+}
+
+
+/* Wait for a port to appear in the registry. */
+static aeq::Port *wait_port(aeq::Core& core, const char *node_name, const char *port_name,
+		aeq::PortDirection direction)
+{
+	for (int i = 0; i < 500; ++i) {
+		core.lock_loop();
+		aeq::Port *port = nullptr;
+		aeq::Node *node = core.find_node_by_name(node_name);
+		if (node && port_name) {
+			port = core.find_port(node->get_id(), port_name, direction);
+		} else if (node) {
+			if (direction == aeq::PortDirection::Input && node->get_nr_i_ports() > 0)
+				port = &node->get_i_port(0);
+			else if (direction == aeq::PortDirection::Output && node->get_nr_o_ports() > 0)
+				port = &node->get_o_port(0);
+		}
+		core.unlock_loop();
+		if (port)
+			return port;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	throw aeq::AudioEqErr(std::string("Timed out waiting for a port of ") + node_name);
+}
+
+
+static RunResult run(int argc, char **argv, const std::string& dir, size_t quantum, size_t nr_filters,
+		double seconds)
+{
+	const std::string core_name = "aeq-bench-" + std::to_string(getpid());
+	std::string conf_path = write_config(dir, core_name, quantum);
+	pid_t daemon = start_daemon(dir, core_name, conf_path);
+	if (daemon < 0)
+		throw aeq::AudioEqErr("Failed to start the pipewire daemon.");
+	setenv("PIPEWIRE_RUNTIME_DIR", dir.c_str(), 1);
+	setenv("PIPEWIRE_REMOTE", core_name.c_str(), 1);
+
+	RunResult result {quantum, nr_filters};
+	try {
+		aeq::Core core {argc, argv};
+		ProbeFilter probe;
+		probe.latencies.reserve(size_t(seconds * sample_rate / impulse_interval) + 16);
+		std::vector<std::unique_ptr<aeq::filters::EqualizerFilter>> eqs;
+
+		core.init_filter(probe, "aeq-bench-probe");
+		for (size_t i = 0; i < nr_filters; ++i) {
+			eqs.push_back(std::make_unique<aeq::filters::EqualizerFilter>(sample_rate, 1));
+			eqs.back()->set_curve(eq_bands, std::size(eq_bands));
+			core.init_filter(*eqs.back(), ("aeq-bench-eq" + std::to_string(i)).c_str());
+		}
+
+		aeq::Port *prev_out = wait_port(core, "aeq-bench-probe", "probe-out", aeq::PortDirection::Output);
+		for (size_t i = 0; i < nr_filters; ++i) {
+			std::string name = "aeq-bench-eq" + std::to_string(i);
+			aeq::Port *eq_in = wait_port(core, name.c_str(), "eq-in", aeq::PortDirection::Input);
+			core.link_ports(*prev_out, *eq_in);
+			prev_out = wait_port(core, name.c_str(), "eq-out", aeq::PortDirection::Output);
+		}
+		core.link_ports(*prev_out, *wait_port(core, "aeq-bench-probe", "probe-in", aeq::PortDirection::Input));
+		core.link_ports(*prev_out, *wait_port(core, "aeq-bench-sink", nullptr, aeq::PortDirection::Input));
+
+		// let the graph settle and the equalizers fade their curves in
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+		double client_cpu_start = process_cpu_s();
+		double daemon_cpu_start = daemon_cpu_s(daemon);
+		probe.start();
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		probe.stop();
+		result.client_cpu = (process_cpu_s() - client_cpu_start) / seconds;
+		result.daemon_cpu = (daemon_cpu_s(daemon) - daemon_cpu_start) / seconds;
+
+		const size_t nr_latencies = probe.nr_latencies.load(std::memory_order_acquire);
+		result.nr_impulses = nr_latencies;
+		if (nr_latencies > 0) {
+			auto [min_it, max_it] = std::minmax_element(probe.latencies.begin(),
+					probe.latencies.begin() + nr_latencies);
+			result.min_latency = *min_it;
+			result.max_latency = *max_it;
+		}
+
+		const size_t nr_callbacks = probe.nr_callbacks.load(std::memory_order_acquire);
+		result.period_us = quantum * 1e6 / sample_rate;
+		double sum = 0.0, max = 0.0;
+		for (size_t i = 1; i < nr_callbacks; ++i) {
+			double deviation = std::fabs((probe.callback_times[i] - probe.callback_times[i - 1]) / 1e3
+					- result.period_us);
+			sum += deviation;
+			max = std::max(max, deviation);
+		}
+		if (nr_callbacks > 1)
+			result.jitter_mean_us = sum / (nr_callbacks - 1);
+		result.jitter_max_us = max;
+	} catch (...) {
+		stop_daemon(daemon);
+		throw;
+	}
+	stop_daemon(daemon);
+	return result;
+}
+
+
+/* Remove the runtime directory with what the runs left in it: the daemon config, and the daemon
+ * socket and its lock if the daemon didn't get to remove them. */
+static void remove_runtime_dir(const std::string& dir)
+{
+	if (DIR *dir_stream = opendir(dir.c_str())) {
+		while (dirent *entry = readdir(dir_stream)) {
+			if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0)
+				unlink((dir + "/" + entry->d_name).c_str());
+		}
+		closedir(dir_stream);
+	}
+	if (rmdir(dir.c_str()) < 0)
+		std::perror("rmdir");
+}
+
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? std::atof(argv[1]) : 5.0;
+
+	char dir_template[] = "/tmp/aeq-bench-XXXXXX";
+	if (mkdtemp(dir_template) == nullptr) {
+		std::perror("mkdtemp");
+		return 1;
+	}
+	const std::string dir = dir_template;
+
+	std::printf("%7s %7s %8s %15s %10s %15s %9s %9s\n", "quantum", "filters", "impulses",
+			"latency samples", "latency ms", "jitter mean/max", "client %", "daemon %");
+	int ret = 0;
+	for (size_t quantum : quanta) {
+		for (size_t nr_filters : filter_counts) {
+			try {
+				RunResult r = run(argc, argv, dir, quantum, nr_filters, seconds);
+				std::printf("%7zu %7zu %8zu %7llu-%-7llu %10.2f %7.1f/%-7.1f %9.1f %9.1f\n",
+						r.quantum, r.nr_filters, r.nr_impulses,
+						(unsigned long long)r.min_latency, (unsigned long long)r.max_latency,
+						r.max_latency * 1e3 / sample_rate, r.jitter_mean_us, r.jitter_max_us,
+						r.client_cpu * 100.0, r.daemon_cpu * 100.0);
+			} catch (const aeq::AudioEqErr& e) {
+				std::fprintf(stderr, "quantum %zu, %zu filters: %s\n", quantum, nr_filters, e.what());
+				ret = 1;
+			}
+		}
+	}
+	remove_runtime_dir(dir);
+	return ret;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/* Heap usage of a bench, counted by replacing the whole family of global operator new and delete:
+ * single and array, aligned and nothrow forms. Each block is counted by the size malloc reserved for
+ * it, so the unsized deletes free as much as was counted.
+ * Defines the operators, so include from the one source file of a bench. Not thread-safe. */
+
+static size_t heap_bytes = 0;
+static size_t peak_heap_bytes = 0;
+
+/* Kept out of line, so that the compiler doesn't pair the malloc inside with operator delete. */
+__attribute__((noinline)) static void *count_alloc(size_t size, size_t alignment) noexcept
+{
+	void *p;
+	if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		p = std::malloc(std::max<size_t>(size, 1));
+	else
+		p = std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+	if (p) {
+		heap_bytes += malloc_usable_size(p);
+		peak_heap_bytes = std::max(peak_heap_bytes, heap_bytes);
+	}
+	return p;
+}
+
+__attribute__((noinline)) static void count_free(void *p) noexcept
+{
+	if (p == nullptr)
+		return;
+	heap_bytes -= malloc_usable_size(p);
+	std::free(p);
+}
+
+static void *count_alloc_or_throw(size_t size, size_t alignment)
+{
+	if (void *p = count_alloc(size, alignment))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size) { return count_alloc_or_throw(size, 0); }
+void *operator new[](size_t size) { return count_alloc_or_throw(size, 0); }
+void *operator new(size_t size, std::align_val_t al) { return count_alloc_or_throw(size, size_t(al)); }
+void *operator new[](size_t size, std::align_val_t al) { return count_alloc_or_throw(size, size_t(al)); }
+void *operator new(size_t size, const std::nothrow_t&) noexcept { return count_alloc(size, 0); }
+void *operator new[](size_t size, const std::nothrow_t&) noexcept { return count_alloc(size, 0); }
+void *operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return count_alloc(size, size_t(al)); }
+void *operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return count_alloc(size, size_t(al)); }
+
+void operator delete(void *p) noexcept { count_free(p); }
+void operator delete[](void *p) noexcept { count_free(p); }
+void operator delete(void *p, size_t) noexcept { count_free(p); }
+void operator delete[](void *p, size_t) noexcept { count_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { count_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { count_free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { count_free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { count_free(p); }
+void operator delete(void *p, const std::nothrow_t&) noexcept { count_free(p); }
+void operator delete[](void *p, const std::nothrow_t&) noexcept { count_free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept { count_free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept { count_free(p); }
@@ -0,0 +1,85 @@
+#include <audioeq/dsp/coeffs.h>
+#include <audioeq/dsp/kernels.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/* Throughput of the DSP kernels at every instruction set level the host supports, and their
+ * largest difference from the scalar reference. */
+
+using namespace aeq::dsp;
+
+constexpr size_t quantum = 1024;
+constexpr size_t nr_samples = 1 << 22;
+constexpr size_t nr_lanes = 8;
+
+template<typename F>
+static double time_s(F&& f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run_one_pole(float alpha, const std::vector<float>& input, std::vector<float>& output)
+{
+	float last_out = 0.0F;
+	for (size_t offset = 0; offset < nr_samples; offset += quantum)
+		kernels().one_pole_low_pass(input.data() + offset, output.data() + offset, quantum, alpha, last_out);
+}
+
+static void run_bank(const std::vector<float>& input, std::vector<float>& data)
+{
+	BiquadCoeffs c = design(FilterType::LowPass, 1000.0F, 0.707F, 0.0F, 48000);
+	std::vector<float> b0(nr_lanes, c.b0), b1(nr_lanes, c.b1), b2(nr_lanes, c.b2);
+	std::vector<float> a1(nr_lanes, c.a1), a2(nr_lanes, c.a2);
+	std::vector<float> z1(nr_lanes), z2(nr_lanes);
+	BiquadBankArgs<float> args {b0.data(), b1.data(), b2.data(), a1.data(), a2.data(),
+		z1.data(), z2.data(), nr_lanes};
+
+	data = input;
+	const size_t nr_frames = nr_samples / nr_lanes;
+	for (size_t frame = 0; frame < nr_frames; frame += quantum)
+		kernels().biquad_bank_f32(args, data.data() + frame * nr_lanes, nr_lanes, quantum);
+}
+
+static double max_diff(const std::vector<float>& a, const std::vector<float>& b)
+{
+	double diff = 0.0;
+	for (size_t i = 0; i < a.size(); ++i)
+		diff = std::fmax(diff, std::fabs(a[i] - b[i]));
+	return diff;
+}
+
+int main()
+{
+	std::mt19937 rng {1234};
+	std::uniform_real_distribution<float> dist {-0.5F, 0.5F};
+	std::vector<float> input(nr_samples);
+	for (auto& x : input)
+		x = dist(rng);
+
+	const float alpha = float(design(FilterType::OnePoleLowPass, 1000.0F, 0.0F, 0.0F, 48000).b0);
+
+	force_isa(Isa::Scalar);
+	std::vector<float> ref_one_pole(nr_samples), ref_bank;
+	run_one_pole(alpha, input, ref_one_pole);
+	run_bank(input, ref_bank);
+
+	std::printf("detected: %s\n", isa_name(detect_isa()));
+	std::printf("%-8s %16s %12s %16s %12s\n", "isa", "one-pole Ms/s", "max diff", "bank Msamples/s", "max diff");
+	for (Isa isa : {Isa::Scalar, Isa::Sse2, Isa::Avx2, Isa::Avx512, Isa::Neon}) {
+		if (!force_isa(isa))
+			continue;
+
+		std::vector<float> one_pole(nr_samples), bank;
+		double one_pole_s = time_s([&] { run_one_pole(alpha, input, one_pole); });
+		double bank_s = time_s([&] { run_bank(input, bank); });
+		std::printf("%-8s %16.1f %12.2e %16.1f %12.2e\n", isa_name(isa),
+				nr_samples / one_pole_s / 1e6, max_diff(one_pole, ref_one_pole),
+				nr_samples / bank_s / 1e6, max_diff(bank, ref_bank));
+	}
+}
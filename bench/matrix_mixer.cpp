@@ -0,0 +1,125 @@
+#include <audioeq/filters/matrix_mixer.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/* A detached 64 x 16 matrix mixer on quanta of 64 frames at every instruction set level the host
+ * supports: a dense matrix, a sparse one with 4 routes per output, and a dense one that is always
+ * ramping to new gains. Reports the cost of a quantum, its share of the quantum period at 48 kHz,
+ * and the largest difference of the dense output from the scalar reference. */
+
+using namespace aeq::dsp;
+using aeq::filters::MatrixMixerFilter;
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_inputs = 64;
+constexpr unsigned int nr_outputs = 16;
+constexpr size_t quantum = 64;
+constexpr size_t nr_quanta = 20000;
+/* Quanta between new matrices in the ramping case, shorter than the 10 ms smoothing. */
+constexpr size_t quanta_per_change = 4;
+
+struct Buffers {
+	std::vector<std::vector<float>> in_bufs;
+	std::vector<std::vector<float>> out_bufs;
+	std::vector<float *> in, out;
+
+	Buffers()
+		: in_bufs(nr_inputs, std::vector<float>(quantum)), out_bufs(nr_outputs, std::vector<float>(quantum))
+	{
+		std::mt19937 rng {1234};
+		std::uniform_real_distribution<float> dist {-0.5F, 0.5F};
+		for (auto& buf : in_bufs) {
+			for (auto& x : buf)
+				x = dist(rng);
+			in.push_back(buf.data());
+		}
+		for (auto& buf : out_bufs)
+			out.push_back(buf.data());
+	}
+};
+
+static std::vector<float> dense_matrix(float scale)
+{
+	std::vector<float> gains(nr_inputs * nr_outputs);
+	for (size_t i = 0; i < gains.size(); ++i)
+		gains[i] = scale * float(1 + i % 7) / (7.0F * nr_inputs);
+	return gains;
+}
+
+static std::vector<float> sparse_matrix()
+{
+	std::vector<float> gains(nr_inputs * nr_outputs);
+	for (unsigned int o = 0; o < nr_outputs; ++o)
+		for (unsigned int k = 0; k < 4; ++k)
+			gains[o * nr_inputs + 4 * o + k] = 0.25F;
+	return gains;
+}
+
+/* Run with given matrix settled, returns ns per quantum. */
+static double run_settled(const std::vector<float>& gains, Buffers& bufs)
+{
+	MatrixMixerFilter mixer {sample_rate, nr_inputs, nr_outputs};
+	mixer.init_detached();
+	mixer.set_matrix(gains);
+	// past the ramp from silence
+	for (size_t q = 0; q < sample_rate / quantum; ++q)
+		mixer.process_detached(bufs.in.data(), bufs.out.data(), quantum);
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t q = 0; q < nr_quanta; ++q)
+		mixer.process_detached(bufs.in.data(), bufs.out.data(), quantum);
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / nr_quanta;
+}
+
+static double run_ramping(Buffers& bufs)
+{
+	MatrixMixerFilter mixer {sample_rate, nr_inputs, nr_outputs};
+	mixer.init_detached();
+	std::vector<float> gains[2] = {dense_matrix(1.0F), dense_matrix(0.5F)};
+
+	double total_ns = 0.0;
+	for (size_t q = 0; q < nr_quanta; ++q) {
+		// publishing is the control side's cost, only the quanta are timed
+		if (q % quanta_per_change == 0)
+			mixer.set_matrix(gains[(q / quanta_per_change) % 2]);
+		auto start = std::chrono::steady_clock::now();
+		mixer.process_detached(bufs.in.data(), bufs.out.data(), quantum);
+		total_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+	return total_ns / nr_quanta;
+}
+
+int main()
+{
+	Buffers bufs;
+	const double period_ns = 1e9 * quantum / sample_rate;
+
+	force_isa(Isa::Scalar);
+	run_settled(dense_matrix(1.0F), bufs);
+	std::vector<std::vector<float>> ref = bufs.out_bufs;
+
+	std::printf("detected: %s, %u x %u, quantum of %zu frames (%.0f us)\n", isa_name(detect_isa()),
+			nr_inputs, nr_outputs, quantum, period_ns / 1000.0);
+	std::printf("%-8s %12s %8s %12s %8s %12s %8s %10s\n", "isa", "dense ns", "%", "sparse ns", "%",
+			"ramping ns", "%", "max diff");
+	for (Isa isa : {Isa::Scalar, Isa::Sse2, Isa::Avx2, Isa::Avx512, Isa::Neon}) {
+		if (!force_isa(isa))
+			continue;
+
+		double dense_ns = run_settled(dense_matrix(1.0F), bufs);
+		double diff = 0.0;
+		for (unsigned int o = 0; o < nr_outputs; ++o)
+			for (size_t i = 0; i < quantum; ++i)
+				diff = std::fmax(diff, std::fabs(bufs.out_bufs[o][i] - ref[o][i]));
+		double sparse_ns = run_settled(sparse_matrix(), bufs);
+		double ramping_ns = run_ramping(bufs);
+
+		std::printf("%-8s %12.1f %8.3f %12.1f %8.3f %12.1f %8.3f %10.2e\n", isa_name(isa),
+				dense_ns, 100.0 * dense_ns / period_ns, sparse_ns, 100.0 * sparse_ns / period_ns,
+				ramping_ns, 100.0 * ramping_ns / period_ns, diff);
+	}
+}
@@ -0,0 +1,83 @@
+#include <audioeq/offline_render.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+
+/* Offline rendering of a 10-band curve over a few minutes of stereo: the chunked parallel render
+ * against the serial one, per number of threads, with the largest difference between them.
+ * With fewer cores than threads the time shows the extra work of the chunked passes instead of
+ * the speedup. */
+
+using aeq::OfflineRenderer;
+using aeq::PresetBand;
+using aeq::dsp::FilterType;
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_channels = 2;
+constexpr size_t nr_frames = size_t(sample_rate) * 180;
+
+static const PresetBand bands[] = {
+	{uint32_t(FilterType::HighPass),	20.0F,		0.707F,	0.0F},
+	{uint32_t(FilterType::Peaking),		30.0F,		4.0F,	6.0F},
+	{uint32_t(FilterType::LowShelf),	80.0F,		0.707F,	3.0F},
+	{uint32_t(FilterType::Peaking),		250.0F,		1.0F,	-2.0F},
+	{uint32_t(FilterType::Peaking),		500.0F,		2.0F,	1.5F},
+	{uint32_t(FilterType::Notch),		1000.0F,	8.0F,	0.0F},
+	{uint32_t(FilterType::Peaking),		3000.0F,	1.5F,	-3.0F},
+	{uint32_t(FilterType::Peaking),		6000.0F,	1.0F,	2.0F},
+	{uint32_t(FilterType::HighShelf),	10000.0F,	0.707F,	-4.0F},
+	{uint32_t(FilterType::LowPass),		20000.0F,	0.707F,	0.0F},
+};
+
+int main()
+{
+	std::mt19937 rng {1234};
+	std::uniform_real_distribution<float> dist {-0.5F, 0.5F};
+	std::vector<std::vector<float>> input(nr_channels, std::vector<float>(nr_frames));
+	for (auto& channel : input)
+		for (auto& x : channel)
+			x = dist(rng);
+	std::vector<std::vector<float>> reference(nr_channels, std::vector<float>(nr_frames));
+	std::vector<std::vector<float>> output(nr_channels, std::vector<float>(nr_frames));
+
+	std::vector<const float *> in_ptrs;
+	std::vector<float *> ref_ptrs, out_ptrs;
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		in_ptrs.push_back(input[ch].data());
+		ref_ptrs.push_back(reference[ch].data());
+		out_ptrs.push_back(output[ch].data());
+	}
+
+	OfflineRenderer serial {bands, std::size(bands), sample_rate, 1};
+	auto start = std::chrono::steady_clock::now();
+	serial.render_serial(in_ptrs.data(), ref_ptrs.data(), nr_channels, nr_frames);
+	double serial_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%u hardware threads, %zu s of %u channels\n", std::thread::hardware_concurrency(),
+			nr_frames / sample_rate, nr_channels);
+	std::printf("%-8s %10s %10s %12s %10s\n", "threads", "time s", "x realtime", "max diff", "differing");
+	std::printf("%-8s %10.3f %10.0f %12s %10s\n", "serial", serial_s, nr_frames / serial_s / sample_rate, "-", "-");
+	for (size_t nr_threads : {2, 4, 8, 16}) {
+		OfflineRenderer renderer {bands, std::size(bands), sample_rate, nr_threads};
+		start = std::chrono::steady_clock::now();
+		renderer.render(in_ptrs.data(), out_ptrs.data(), nr_channels, nr_frames);
+		double render_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		double max_diff = 0.0;
+		size_t nr_differing = 0;
+		for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+			for (size_t i = 0; i < nr_frames; ++i) {
+				max_diff = std::fmax(max_diff, std::fabs(output[ch][i] - reference[ch][i]));
+				nr_differing += output[ch][i] != reference[ch][i];
+			}
+		}
+		std::printf("%-8zu %10.3f %10.0f %12.2e %9.4f%%\n", nr_threads, render_s,
+				nr_frames / render_s / sample_rate, max_diff,
+				100.0 * nr_differing / (nr_frames * nr_channels));
+	}
+}
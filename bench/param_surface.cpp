@@ -0,0 +1,121 @@
+#include <audioeq/param_surface.h>
+#include <audioeq/filters/low_pass.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Control of a filter from another process through a memfd ParamSurface: a child process sweeps
+ * the cutoff of a detached stereo low pass at 1000 writes per second for a second, while the
+ * parent runs quanta back to back. Reports the cost of a write in the child, the cost the surface
+ * adds to a quantum with and without writes, and how often a quantum found a writer in the middle
+ * of an update. */
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_channels = 2;
+constexpr size_t quantum = 256;
+constexpr size_t nr_quanta = 200000;
+constexpr float final_cutoff = 5000.0F;
+constexpr size_t automation_rate = 1000;
+
+using Clock = std::chrono::steady_clock;
+
+static double run_quanta(aeq::Filter& filter, float *const *in, float *const *out, size_t n)
+{
+	auto start = Clock::now();
+	for (size_t i = 0; i < n; ++i)
+		filter.process_detached(in, out, quantum);
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+}
+
+/* Child side: the cost of back to back writes on a private surface, then automation at
+ * automation_rate writes per second on the shared one. */
+static int run_writer(const aeq::Filter& filter, int fd)
+{
+	{
+		aeq::ParamSurface scratch {filter};
+		aeq::ParamSurfaceClient client {scratch.get_fd()};
+		size_t nr_writes = 0;
+		auto start = Clock::now();
+		while (nr_writes < 10000000)
+			client.set_param(0, 100.0F + float(nr_writes++ % 10000));
+		double write_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / nr_writes;
+		std::printf("child: %.1f ns per write\n", write_ns);
+	}
+
+	aeq::ParamSurfaceClient client {fd};
+	size_t cutoff_idx;
+	if (!client.find_param("cutoff", cutoff_idx))
+		return 1;
+	auto next = Clock::now();
+	for (size_t i = 0; i < automation_rate; ++i) {
+		client.set_param(cutoff_idx, 100.0F + float(i % 10000));
+		next += std::chrono::microseconds(1000000 / automation_rate);
+		std::this_thread::sleep_until(next);
+	}
+	client.set_param(cutoff_idx, final_cutoff);
+	std::fflush(stdout);
+	return 0;
+}
+
+int main()
+{
+	aeq::filters::LowPassFilter filter {1000.0F, sample_rate, nr_channels};
+	filter.init_detached();
+
+	std::vector<std::vector<float>> in_bufs(nr_channels, std::vector<float>(quantum, 0.25F));
+	std::vector<std::vector<float>> out_bufs(nr_channels, std::vector<float>(quantum));
+	std::vector<float *> in, out;
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		in.push_back(in_bufs[ch].data());
+		out.push_back(out_bufs[ch].data());
+	}
+
+	double plain_ns = run_quanta(filter, in.data(), out.data(), nr_quanta);
+
+	aeq::ParamSurface surface {filter};
+	filter.attach_param_surface(&surface);
+	double idle_ns = run_quanta(filter, in.data(), out.data(), nr_quanta);
+
+	std::fflush(stdout);
+	pid_t child = fork();
+	if (child < 0) {
+		std::perror("fork");
+		return 1;
+	}
+	if (child == 0)
+		_exit(run_writer(filter, surface.get_fd()));
+
+	size_t nr_busy_quanta = 0;
+	double busy_ns = 0.0;
+	int status;
+	while (waitpid(child, &status, WNOHANG) == 0) {
+		busy_ns += run_quanta(filter, in.data(), out.data(), 1000) * 1000;
+		nr_busy_quanta += 1000;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		std::fprintf(stderr, "writer failed\n");
+		return 1;
+	}
+	// the last write of the child lands in the next quantum
+	filter.process_detached(in.data(), out.data(), quantum);
+
+	aeq::ParamSurfaceClient view {surface.get_fd()};
+	aeq::ParamSurfaceStats stats = view.get_stats();
+	std::vector<float> input_peaks, output_peaks;
+	view.read_meters(input_peaks, output_peaks);
+
+	std::printf("%-24s %10s\n", "quantum of 256 frames", "ns");
+	std::printf("%-24s %10.1f\n", "no surface", plain_ns);
+	std::printf("%-24s %10.1f\n", "surface, no writes", idle_ns);
+	std::printf("%-24s %10.1f\n", "surface, child writing", busy_ns / nr_busy_quanta);
+	std::printf("updates taken %llu of %zu, torn reads %llu of %zu quanta while writing\n",
+			(unsigned long long)stats.nr_param_updates, automation_rate + 1,
+			(unsigned long long)stats.nr_torn_reads, nr_busy_quanta);
+	std::printf("final cutoff %.0f (written %.0f), input peak %.3f, output peak %.3f\n",
+			filter.get_params()[0].def, final_cutoff, input_peaks[0], output_peaks[0]);
+}
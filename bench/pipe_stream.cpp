@@ -0,0 +1,77 @@
+#include <audioeq/pipe_stream.h>
+#include <audioeq/filters/low_pass.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+/* Throughput of PipeStream through the low pass filter, stereo 48 kHz, per sample format:
+ * a thread writes the input into a pipe and another drains the output pipe, as in
+ * `producer | audioeq --pipe | consumer`. */
+
+using aeq::dsp::PcmFormat;
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_channels = 2;
+constexpr size_t nr_frames = size_t(sample_rate) * 600;
+constexpr size_t write_size = 1 << 16;
+
+int main()
+{
+	std::mt19937 rng {1234};
+	std::uniform_int_distribution<int> dist {0, 255};
+	std::vector<uint8_t> data(nr_frames * nr_channels * sizeof(float));
+	for (auto& byte : data)
+		byte = uint8_t(dist(rng));
+
+	std::printf("%-6s %12s %12s\n", "format", "MB/s", "x realtime");
+	for (PcmFormat format : {PcmFormat::F32, PcmFormat::S16, PcmFormat::S32}) {
+		const size_t size = nr_frames * nr_channels * aeq::dsp::get_sample_size(format);
+		// random bytes as float are partly NaN and Inf, use a valid signal
+		if (format == PcmFormat::F32) {
+			float *samples = reinterpret_cast<float *>(data.data());
+			for (size_t i = 0; i < nr_frames * nr_channels; ++i)
+				samples[i] = (data[i] - 128) / 128.0F;
+		}
+
+		int in_pipe[2], out_pipe[2];
+		if (pipe(in_pipe) < 0 || pipe(out_pipe) < 0)
+			return 1;
+
+		aeq::filters::LowPassFilter filter {2000.0F, sample_rate, nr_channels};
+		filter.init_detached();
+		aeq::PipeStream stream {filter, format, nr_channels};
+
+		auto start = std::chrono::steady_clock::now();
+		std::thread producer([&] {
+			for (size_t offset = 0; offset < size; ) {
+				ssize_t ret = write(in_pipe[1], data.data() + offset, std::min(write_size, size - offset));
+				if (ret <= 0)
+					break;
+				offset += ret;
+			}
+			close(in_pipe[1]);
+		});
+		std::thread consumer([&] {
+			std::vector<uint8_t> sink(write_size);
+			while (read(out_pipe[0], sink.data(), sink.size()) > 0)
+				;
+		});
+		uint64_t nr_streamed = stream.run(in_pipe[0], out_pipe[1]);
+		close(out_pipe[1]);
+		producer.join();
+		consumer.join();
+		double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		close(in_pipe[0]);
+		close(out_pipe[0]);
+
+		if (nr_streamed != nr_frames)
+			std::printf("streamed %llu of %zu frames\n", (unsigned long long)nr_streamed, nr_frames);
+		std::printf("%-6s %12.0f %12.0f\n", aeq::dsp::pcm_format_name(format), size / s / 1e6,
+				nr_frames / s / sample_rate);
+	}
+}
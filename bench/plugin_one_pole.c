@@ -0,0 +1,68 @@
+#include <audioeq/plugin.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+/* Plugin stage for bench_plugin_swap: a one-pole low pass at CUTOFF_HZ, built in two versions
+ * differing in the cutoff to stand for an upgrade. */
+
+#ifndef CUTOFF_HZ
+#define CUTOFF_HZ 1000.0
+#endif
+
+struct one_pole {
+	unsigned int nr_channels;
+	float alpha;
+	float last_outs[];
+};
+
+static void *create(int sample_rate, unsigned int nr_channels, size_t max_quantum)
+{
+	// the state is per channel only, whatever the quantum
+	(void)max_quantum;
+	struct one_pole *stage = calloc(1, sizeof(*stage) + nr_channels * sizeof(float));
+	if (stage == NULL)
+		return NULL;
+	stage->nr_channels = nr_channels;
+	stage->alpha = (float)(1.0 - exp(-2.0 * M_PI * CUTOFF_HZ / sample_rate));
+	return stage;
+}
+
+static void destroy(void *instance)
+{
+	free(instance);
+}
+
+static void process(void *instance, const float *const *in, float *const *out, size_t nr_samples)
+{
+	struct one_pole *stage = instance;
+	for (unsigned int ch = 0; ch < stage->nr_channels; ++ch) {
+		float y = stage->last_outs[ch];
+		for (size_t i = 0; i < nr_samples; ++i) {
+			y += stage->alpha * (in[ch][i] - y);
+			out[ch][i] = y;
+		}
+		stage->last_outs[ch] = y;
+	}
+}
+
+static void reset(void *instance)
+{
+	struct one_pole *stage = instance;
+	for (unsigned int ch = 0; ch < stage->nr_channels; ++ch)
+		stage->last_outs[ch] = 0.0f;
+}
+
+static const struct aeq_plugin_stage descriptor = {
+	.abi_version = AEQ_PLUGIN_ABI_VERSION,
+	.name = "one-pole",
+	.create = create,
+	.destroy = destroy,
+	.process = process,
+	.reset = reset,
+};
+
+__attribute__((visibility("default"))) const struct aeq_plugin_stage *aeq_plugin_stage(void)
+{
+	return &descriptor;
+}
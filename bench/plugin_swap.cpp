@@ -0,0 +1,158 @@
+#include <audioeq/filters/plugin.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+/* Upgrades of a plugin stage in a running stereo filter: two versions of a one-pole low pass
+ * module are swapped in turns while a sine is processed. Reports the time to load a module off
+ * the RT thread, the cost of quanta during a crossfade, the largest sample to sample step of the
+ * output, with the crossfade against a hard switch (the click an upgrade would make), and the
+ * output peak during the fades against the one in between (the level bump an upgrade would make).
+ * Also rebuilds a module in place over the path it was loaded from, which must load as new code. */
+
+using aeq::filters::PluginFilter;
+using Clock = std::chrono::steady_clock;
+
+constexpr int sample_rate = 48000;
+constexpr unsigned int nr_channels = 2;
+constexpr size_t quantum = 256;
+constexpr size_t nr_swaps = 40;
+constexpr size_t quanta_per_swap = 100;
+constexpr double sine_freq = 440.0;
+
+static const char *const modules[] = {AEQ_PLUGIN_V1, AEQ_PLUGIN_V2};
+
+struct SwapResult {
+	double load_ms;
+	double steady_ns;
+	double fade_ns;
+	float max_step;
+	float fade_peak;
+	float steady_peak;
+};
+
+/* Process quanta of a sine from given sample position, returns the largest step of the output.
+ * Raises peak to the output peak if given. */
+static float run(PluginFilter& filter, size_t& pos, size_t nr_quanta, float& last, double *ns = nullptr,
+		float *peak = nullptr)
+{
+	std::vector<std::vector<float>> in_bufs(nr_channels, std::vector<float>(quantum));
+	std::vector<std::vector<float>> out_bufs(nr_channels, std::vector<float>(quantum));
+	float *in[nr_channels], *out[nr_channels];
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		in[ch] = in_bufs[ch].data();
+		out[ch] = out_bufs[ch].data();
+	}
+
+	float max_step = 0.0F;
+	double total_ns = 0.0;
+	for (size_t q = 0; q < nr_quanta; ++q) {
+		for (unsigned int ch = 0; ch < nr_channels; ++ch)
+			for (size_t i = 0; i < quantum; ++i)
+				in[ch][i] = 0.5F * float(std::sin(2.0 * M_PI * sine_freq * (pos + i) / sample_rate));
+		pos += quantum;
+
+		auto start = Clock::now();
+		filter.process_detached(in, out, quantum);
+		total_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		for (size_t i = 0; i < quantum; ++i) {
+			max_step = std::fmax(max_step, std::fabs(out[0][i] - last));
+			last = out[0][i];
+			if (peak)
+				*peak = std::fmax(*peak, std::fabs(out[0][i]));
+		}
+	}
+	if (ns)
+		*ns = total_ns / nr_quanta;
+	return max_step;
+}
+
+static SwapResult measure(float crossfade_ms)
+{
+	PluginFilter filter {sample_rate, nr_channels, crossfade_ms};
+	filter.init_detached();
+	size_t pos = 0;
+	float last = 0.0F;
+
+	filter.load(modules[0]);
+	run(filter, pos, quanta_per_swap, last);
+
+	SwapResult result {};
+	// the fade of 20 ms spans 4 quanta of 256 frames at 48 kHz
+	const size_t fade_quanta = size_t(std::ceil(crossfade_ms * sample_rate / 1000.0 / quantum));
+	for (size_t swap = 1; swap <= nr_swaps; ++swap) {
+		auto start = Clock::now();
+		filter.load(modules[swap % 2]);
+		result.load_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		double ns;
+		if (fade_quanta > 0) {
+			result.max_step = std::fmax(result.max_step, run(filter, pos, fade_quanta, last, &ns,
+					&result.fade_peak));
+			result.fade_ns += ns;
+		}
+		result.max_step = std::fmax(result.max_step, run(filter, pos, quanta_per_swap - fade_quanta, last, &ns,
+				&result.steady_peak));
+		result.steady_ns += ns;
+	}
+	result.load_ms /= nr_swaps;
+	result.steady_ns /= nr_swaps;
+	result.fade_ns /= nr_swaps;
+	if (filter.get_nr_swaps() != nr_swaps + 1)
+		std::fprintf(stderr, "only %llu swaps done\n", (unsigned long long)filter.get_nr_swaps());
+	return result;
+}
+
+/* Output peak of a module on the sine, after the first second. */
+static float peak_of(PluginFilter& filter, const char *path)
+{
+	filter.load(path);
+	size_t pos = 0;
+	float last = 0.0F;
+	run(filter, pos, sample_rate / quantum, last);
+
+	std::vector<float> in(quantum), out(quantum);
+	float *in_ptrs[nr_channels] = {in.data(), in.data()}, *out_ptrs[nr_channels] = {out.data(), out.data()};
+	float peak = 0.0F;
+	for (size_t q = 0; q < sample_rate / quantum; ++q) {
+		for (size_t i = 0; i < quantum; ++i)
+			in[i] = 0.5F * float(std::sin(2.0 * M_PI * sine_freq * (pos + i) / sample_rate));
+		pos += quantum;
+		filter.process_detached(in_ptrs, out_ptrs, quantum);
+		for (float x : out)
+			peak = std::fmax(peak, std::fabs(x));
+	}
+	return peak;
+}
+
+int main()
+{
+	// the input is read through the sine generator, the steady output step is the reference
+	const float sine_step = float(0.5 * 2.0 * M_PI * sine_freq / sample_rate);
+
+	std::printf("%-12s %10s %12s %12s %10s %10s %12s\n", "", "load ms", "quantum ns", "fading ns", "max step",
+			"fade peak", "steady peak");
+	for (float crossfade_ms : {20.0F, 0.0F}) {
+		SwapResult r = measure(crossfade_ms);
+		std::printf("%-12s %10.3f %12.1f %12.1f %10.4f %10.4f %12.4f\n",
+				crossfade_ms > 0.0F ? "crossfade" : "hard switch",
+				r.load_ms, r.steady_ns, r.fade_ns, r.max_step, r.fade_peak, r.steady_peak);
+	}
+	std::printf("sine step %.4f\n", sine_step);
+
+	// install v2 over a copy of v1 in place, like a rebuild writing the same file
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "aeq_bench_plugin.so";
+	std::filesystem::copy_file(modules[0], path, std::filesystem::copy_options::overwrite_existing);
+	PluginFilter filter {sample_rate, 1, 20.0F};
+	filter.init_detached();
+	float v1_peak = peak_of(filter, path.c_str());
+	std::filesystem::copy_file(modules[1], path, std::filesystem::copy_options::overwrite_existing);
+	float v2_peak = peak_of(filter, path.c_str());
+	std::filesystem::remove(path);
+	std::printf("rebuilt in place: output peak %.4f before, %.4f after (%s)\n", v1_peak, v2_peak,
+			v1_peak != v2_peak ? "new code" : "STALE CODE");
+}
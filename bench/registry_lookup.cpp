@@ -0,0 +1,110 @@
+#include <audioeq/registry_model.h>
+
+#include <pipewire/pipewire.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Lookup cost of nodes by name and of ports by (node, name, direction) through the registry
+ * model's indices, against scanning the listed nodes as callers had to before. */
+
+using aeq::Node;
+using aeq::Port;
+using aeq::PortDirection;
+using aeq::RegistryModel;
+
+constexpr size_t nr_ports_per_node = 8;
+constexpr size_t nr_lookups = 20000;
+
+static const char *port_names[] = {"playback_FL", "playback_FR", "playback_RL", "playback_RR"};
+
+static void add_global(RegistryModel& model, uint32_t id, const char *type,
+		std::vector<std::pair<std::string, std::string>> props)
+{
+	std::vector<spa_dict_item> items;
+	for (const auto& [key, value] : props)
+		items.push_back(SPA_DICT_ITEM_INIT(key.c_str(), value.c_str()));
+	spa_dict dict = SPA_DICT_INIT(items.data(), uint32_t(items.size()));
+	model.on_global(id, type, &dict);
+}
+
+template<typename F>
+static double time_lookups(F&& lookup)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t nr_found = 0;
+	for (size_t i = 0; i < nr_lookups; ++i)
+		nr_found += lookup(i) != nullptr;
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (nr_found != nr_lookups)
+		std::fprintf(stderr, "only %zu of %zu lookups found\n", nr_found, nr_lookups);
+	return secs / nr_lookups * 1e9;
+}
+
+int main()
+{
+	std::printf("%8s %8s %16s %16s %16s %16s\n", "nodes", "ports",
+			"name scan ns", "name index ns", "port scan ns", "port index ns");
+
+	for (size_t nr_nodes : {100, 1000, 10000}) {
+		RegistryModel model;
+		std::vector<std::string> node_names;
+		uint32_t id = 100;
+		for (size_t node = 0; node < nr_nodes; ++node) {
+			uint32_t node_id = id++;
+			node_names.push_back("alsa_output.card" + std::to_string(node) + ".analog-surround");
+			add_global(model, node_id, PW_TYPE_INTERFACE_Node, {
+					{PW_KEY_NODE_NAME, node_names.back()},
+					{PW_KEY_MEDIA_CLASS, "Audio/Sink"}});
+			for (size_t port = 0; port < nr_ports_per_node; ++port) {
+				bool input = port < nr_ports_per_node / 2;
+				add_global(model, id++, PW_TYPE_INTERFACE_Port, {
+						{PW_KEY_PORT_NAME, port_names[port % 4]},
+						{PW_KEY_PORT_DIRECTION, input ? "in" : "out"},
+						{PW_KEY_NODE_ID, std::to_string(node_id)}});
+			}
+		}
+
+		std::mt19937 rng {7};
+		std::vector<size_t> targets(nr_lookups);
+		for (auto& target : targets)
+			target = rng() % nr_nodes;
+
+		std::vector<Node *> nodes;
+		auto scan_node = [&](size_t i) -> Node *
+		{
+			nodes.clear();
+			model.list_nodes(nodes);
+			for (Node *node : nodes) {
+				if (node->get_name() == node_names[targets[i]])
+					return node;
+			}
+			return nullptr;
+		};
+		auto scan_port = [&](size_t i) -> Port *
+		{
+			Node *node = scan_node(i);
+			for (size_t p = 0; node && p < node->get_nr_o_ports(); ++p) {
+				if (node->get_o_port(p).get_name() == port_names[i % 4])
+					return &node->get_o_port(p);
+			}
+			return nullptr;
+		};
+
+		double name_scan = time_lookups(scan_node);
+		double name_index = time_lookups([&](size_t i) { return model.find_node_by_name(node_names[targets[i]]); });
+		double port_scan = time_lookups(scan_port);
+		double port_index = time_lookups([&](size_t i)
+		{
+			Node *node = model.find_node_by_name(node_names[targets[i]]);
+			return model.find_port(node->get_id(), port_names[i % 4], PortDirection::Output);
+		});
+
+		std::printf("%8zu %8zu %16.1f %16.1f %16.1f %16.1f\n", nr_nodes, nr_nodes * nr_ports_per_node,
+				name_scan, name_index, port_scan, port_index);
+	}
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <audioeq/utils/string_pool.h>
+
+#include "heap_count.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Memory and wrap throughput of registry names kept as per-object std::string copies versus
+ * handles into a shared StringPool, on a synthetic graph of 10k ports.
+ * The wrappers mirror the name-carrying part of Node and Port, Core cannot be fed without a
+ * PipeWire daemon. */
+
+using aeq::utils::InternedString;
+using aeq::utils::StringPool;
+
+enum class Direction { Input, Output };
+
+struct CopiedNode {
+	uint32_t id;
+	std::string name;
+	std::string description;
+};
+
+struct CopiedPort {
+	uint32_t id;
+	std::string name;
+	Direction direction;
+};
+
+struct InternedNode {
+	uint32_t id;
+	InternedString name;
+	InternedString description;
+};
+
+struct InternedPort {
+	uint32_t id;
+	InternedString name;
+	Direction direction;
+};
+
+struct GlobalProps {
+	uint32_t id;
+	bool is_node;
+	std::string name;
+	std::string description;
+	const char *direction;
+};
+
+constexpr size_t nr_ports = 10000;
+constexpr size_t nr_rounds = 20;
+
+static const char *channels[] = {"FL", "FR", "FC", "LFE", "RL", "RR", "SL", "SR"};
+
+/* Cards with a sink and a source each, 8 channel ports per node, named the way PipeWire does. */
+static std::vector<GlobalProps> make_graph()
+{
+	std::vector<GlobalProps> globals;
+	uint32_t id = 100;
+	for (size_t card = 0; globals.size() < nr_ports * 9 / 8; ++card) {
+		for (bool sink : {true, false}) {
+			std::string card_name = "pci-0000_" + std::to_string(card % 4) + "_1f." + std::to_string(card % 8);
+			globals.push_back({id++, true,
+					(sink ? "alsa_output." : "alsa_input.") + card_name + ".analog-surround-71",
+					sink ? "Built-in Audio Analog Surround 7.1" : "Built-in Audio Analog Stereo",
+					nullptr});
+			for (const char *channel : channels) {
+				globals.push_back({id++, false, std::string(sink ? "playback_" : "capture_") + channel, "",
+						sink ? "in" : "out"});
+				if (sink)
+					globals.push_back({id++, false, std::string("monitor_") + channel, "", "out"});
+			}
+		}
+	}
+	return globals;
+}
+
+template<typename F>
+static void run(const char *label, const std::vector<GlobalProps>& globals, F&& wrap_all)
+{
+	double best_secs = 1e9;
+	size_t bytes = 0;
+	for (size_t round = 0; round < nr_rounds; ++round) {
+		size_t heap_before = heap_bytes;
+		auto start = std::chrono::steady_clock::now();
+		bytes = wrap_all() - heap_before;
+		best_secs = std::min(best_secs, std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - start).count());
+	}
+	std::printf("%-10s %14.2f %14zu\n", label, globals.size() / best_secs / 1e6, bytes);
+}
+
+int main()
+{
+	std::vector<GlobalProps> globals = make_graph();
+	size_t nr_port_globals = 0;
+	for (const auto& global : globals)
+		nr_port_globals += !global.is_node;
+	std::printf("%zu globals, %zu ports\n", globals.size(), nr_port_globals);
+	std::printf("%-10s %14s %14s\n", "names", "Mglobals/s", "heap bytes");
+
+	run("copied", globals, [&globals]()
+	{
+		std::unordered_map<uint32_t, std::unique_ptr<CopiedNode>> nodes;
+		std::unordered_map<uint32_t, std::unique_ptr<CopiedPort>> ports;
+		for (const auto& g : globals) {
+			if (g.is_node) {
+				nodes[g.id] = std::unique_ptr<CopiedNode>(new CopiedNode{g.id, g.name.c_str(), g.description.c_str()});
+			} else {
+				Direction direction = std::string(g.direction) == "in" ? Direction::Input : Direction::Output;
+				ports[g.id] = std::unique_ptr<CopiedPort>(new CopiedPort{g.id, g.name.c_str(), direction});
+			}
+		}
+		return heap_bytes;
+	});
+
+	run("interned", globals, [&globals]()
+	{
+		StringPool names;
+		std::unordered_map<uint32_t, std::unique_ptr<InternedNode>> nodes;
+		std::unordered_map<uint32_t, std::unique_ptr<InternedPort>> ports;
+		for (const auto& g : globals) {
+			if (g.is_node) {
+				nodes[g.id] = std::unique_ptr<InternedNode>(new InternedNode{g.id,
+						names.intern(g.name.c_str()), names.intern(g.description.c_str())});
+			} else {
+				Direction direction = std::strcmp(g.direction, "in") == 0 ? Direction::Input : Direction::Output;
+				ports[g.id] = std::unique_ptr<InternedPort>(new InternedPort{g.id,
+						names.intern(g.name.c_str()), direction});
+			}
+		}
+		return heap_bytes;
+	});
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include <audioeq/registry_recording.h>
+
+#include "heap_count.h"
+
+#include <pipewire/pipewire.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <random>
+#include <string>
+
+/* Replay throughput and peak memory of RegistryModel.
+ * Without arguments a synthetic graph of about 100k objects is added in random order (ports
+ * before their nodes, links before their ports) and then removed in random order.
+ * With a path, a recording made by a live session is replayed instead. */
+
+using aeq::RegistryModel;
+using aeq::RegistryRecording;
+
+constexpr size_t nr_nodes = 8000;
+constexpr size_t nr_ports_per_node = 8;
+constexpr size_t nr_links = 28000;
+
+static const char *channels[] = {"FL", "FR", "RL", "RR"};
+
+static void add_global(std::vector<RegistryRecording::Event>& events, uint32_t id, const char *type,
+		std::vector<std::pair<std::string, std::string>> props)
+{
+	events.push_back({RegistryRecording::Event::Kind::Global, id, type, std::move(props)});
+}
+
+static RegistryRecording make_synthetic_recording()
+{
+	std::mt19937 rng {42};
+	std::vector<RegistryRecording::Event> adds;
+	std::vector<uint32_t> i_ports, o_ports;
+	uint32_t id = 100;
+
+	for (size_t node = 0; node < nr_nodes; ++node) {
+		uint32_t node_id = id++;
+		add_global(adds, node_id, PW_TYPE_INTERFACE_Node, {
+				{PW_KEY_NODE_NAME, "client_" + std::to_string(node % 500) + ".stream"},
+				{PW_KEY_NODE_DESCRIPTION, "Synthetic stream"},
+				{PW_KEY_MEDIA_CLASS, node % 2 ? "Stream/Output/Audio" : "Stream/Input/Audio"}});
+		for (size_t port = 0; port < nr_ports_per_node; ++port) {
+			bool input = port < nr_ports_per_node / 2;
+			uint32_t port_id = id++;
+			(input ? i_ports : o_ports).push_back(port_id);
+			add_global(adds, port_id, PW_TYPE_INTERFACE_Port, {
+					{PW_KEY_PORT_NAME, std::string(input ? "input_" : "output_") + channels[port % 4]},
+					{PW_KEY_PORT_DIRECTION, input ? "in" : "out"},
+					{PW_KEY_NODE_ID, std::to_string(node_id)}});
+		}
+	}
+	for (size_t link = 0; link < nr_links; ++link) {
+		add_global(adds, id++, PW_TYPE_INTERFACE_Link, {
+				{PW_KEY_LINK_OUTPUT_PORT, std::to_string(o_ports[rng() % o_ports.size()])},
+				{PW_KEY_LINK_INPUT_PORT, std::to_string(i_ports[rng() % i_ports.size()])}});
+	}
+
+	std::vector<RegistryRecording::Event> removes;
+	for (const auto& event : adds)
+		removes.push_back({RegistryRecording::Event::Kind::GlobalRemove, event.id, {}, {}});
+
+	std::shuffle(adds.begin(), adds.end(), rng);
+	std::shuffle(removes.begin(), removes.end(), rng);
+
+	// round trip through the recording API, as a live session would record it
+	RegistryRecording recording;
+	std::vector<spa_dict_item> items;
+	for (const auto& event : adds) {
+		items.clear();
+		for (const auto& [key, value] : event.props)
+			items.push_back(SPA_DICT_ITEM_INIT(key.c_str(), value.c_str()));
+		spa_dict props = SPA_DICT_INIT(items.data(), uint32_t(items.size()));
+		recording.record_global(event.id, event.type.c_str(), &props);
+	}
+	for (const auto& event : removes)
+		recording.record_global_remove(event.id);
+	return recording;
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		RegistryRecording recording = argc > 1 ? RegistryRecording(argv[1]) : make_synthetic_recording();
+
+		size_t nr_events = recording.get_nr_events();
+		size_t heap_before = heap_bytes;
+		peak_heap_bytes = heap_bytes;
+
+		size_t nr_end_objects = 0;
+		size_t heap_after = 0;
+		double secs;
+		{
+			RegistryModel model;
+			auto start = std::chrono::steady_clock::now();
+			recording.replay(model);
+			secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			nr_end_objects = model.get_nr_nodes() + model.get_nr_ports() + model.get_nr_links();
+			heap_after = heap_bytes;
+		}
+
+		std::printf("events:            %zu\n", nr_events);
+		std::printf("objects at end:    %zu\n", nr_end_objects);
+		std::printf("replay:            %.2f Mevents/s\n", nr_events / secs / 1e6);
+		std::printf("peak model heap:   %.1f MiB\n", (peak_heap_bytes - heap_before) / 1048576.0);
+		// the synthetic run adds everything before removing anything
+		if (argc <= 1) {
+			size_t nr_peak_objects = nr_nodes * (1 + nr_ports_per_node) + nr_links;
+			std::printf("objects at peak:   %zu (%.0f bytes/object)\n", nr_peak_objects,
+					double(peak_heap_bytes - heap_before) / nr_peak_objects);
+		}
+		std::printf("model heap at end: %zd bytes\n", ssize_t(heap_after - heap_before));
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
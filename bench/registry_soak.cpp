@@ -0,0 +1,218 @@
+#include <audioeq/registry_recording.h>
+
+#include "heap_count.h"
+
+#include <pipewire/pipewire.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Soak test of RegistryModel under endless client churn, e.g. browser tabs and calls coming and
+ * going for days. A few devices stay while short-lived clients, each with a unique name, add and
+ * remove their node, ports and links. Every client's events come in random order, so links are
+ * often removed before their ports appear and ports before their node does.
+ * The events are replayed in epochs, the model heap and the cost per event are sampled after
+ * each one. Fails if the heap grows or the cost drifts once the first epochs warmed up the
+ * tables. The number of events, 8M by default, may be passed as argument. */
+
+using aeq::RegistryModel;
+using aeq::RegistryRecording;
+
+constexpr size_t nr_epochs = 32;
+constexpr size_t nr_warmup_epochs = 4;
+constexpr size_t nr_live_clients = 512;
+constexpr size_t nr_devices = 8;
+constexpr size_t nr_client_ports = 4;
+/* Growth of the peak model heap, and drift of the cost per event, tolerated after warm up. */
+constexpr double max_heap_growth = 1.10;
+constexpr double max_cost_drift = 1.50;
+
+static const char *channels[] = {"FL", "FR"};
+
+struct Step {
+	bool remove;
+	uint32_t id;
+	const char *type;
+	std::vector<std::pair<std::string, std::string>> props;
+};
+
+/* A client's events still to be sent. */
+struct Client {
+	std::vector<Step> steps;
+	size_t next = 0;
+};
+
+class Churn {
+public:
+	explicit Churn(uint32_t first_id) : next_id(first_id) {}
+
+	/* Devices the clients link to, added once and never removed. */
+	void add_devices(RegistryRecording& recording)
+	{
+		for (size_t dev = 0; dev < nr_devices; ++dev) {
+			uint32_t node_id = next_id++;
+			bool sink = dev % 2 == 0;
+			record(recording, {false, node_id, PW_TYPE_INTERFACE_Node, {
+					{PW_KEY_NODE_NAME, "alsa_card" + std::to_string(dev) + (sink ? ".sink" : ".source")},
+					{PW_KEY_NODE_DESCRIPTION, "Built-in Audio"},
+					{PW_KEY_MEDIA_CLASS, sink ? "Audio/Sink" : "Audio/Source"}}});
+			for (const char *channel : channels) {
+				uint32_t port_id = next_id++;
+				(sink ? device_i_ports : device_o_ports).push_back(port_id);
+				record(recording, {false, port_id, PW_TYPE_INTERFACE_Port, {
+						{PW_KEY_PORT_NAME, std::string(sink ? "playback_" : "capture_") + channel},
+						{PW_KEY_PORT_DIRECTION, sink ? "in" : "out"},
+						{PW_KEY_NODE_ID, std::to_string(node_id)}}});
+			}
+		}
+		clients.resize(nr_live_clients);
+		for (Client& client : clients)
+			new_client(client);
+	}
+
+	/* Record the next nr_events events of randomly picked clients, replacing those done. */
+	void next_events(RegistryRecording& recording, size_t nr_events)
+	{
+		for (size_t i = 0; i < nr_events; ++i) {
+			Client& client = clients[rng() % clients.size()];
+			record(recording, client.steps[client.next++]);
+			if (client.next == client.steps.size())
+				new_client(client);
+		}
+	}
+private:
+	/* A playback or capture stream with a unique name, its ports and their links to a device.
+	 * Each object appears twice in a shuffled script, the first time it is added and the
+	 * second time removed, so the adds and removes of a client interleave at random. */
+	void new_client(Client& client)
+	{
+		std::vector<Step> adds;
+		uint32_t node_id = next_id++;
+		bool playback = rng() % 2 == 0;
+		adds.push_back({false, node_id, PW_TYPE_INTERFACE_Node, {
+				{PW_KEY_NODE_NAME, "firefox.tab-" + std::to_string(nr_clients++)},
+				{PW_KEY_NODE_DESCRIPTION, playback ? "Playback" : "Capture"},
+				{PW_KEY_MEDIA_CLASS, playback ? "Stream/Output/Audio" : "Stream/Input/Audio"}}});
+		for (size_t port = 0; port < nr_client_ports; ++port) {
+			uint32_t port_id = next_id++;
+			adds.push_back({false, port_id, PW_TYPE_INTERFACE_Port, {
+					{PW_KEY_PORT_NAME, std::string(playback ? "output_" : "input_") + channels[port % 2]},
+					{PW_KEY_PORT_DIRECTION, playback ? "out" : "in"},
+					{PW_KEY_NODE_ID, std::to_string(node_id)}}});
+			std::vector<uint32_t>& device_ports = playback ? device_i_ports : device_o_ports;
+			uint32_t device_port_id = device_ports[rng() % device_ports.size()];
+			adds.push_back({false, next_id++, PW_TYPE_INTERFACE_Link, {
+					{PW_KEY_LINK_OUTPUT_PORT, std::to_string(playback ? port_id : device_port_id)},
+					{PW_KEY_LINK_INPUT_PORT, std::to_string(playback ? device_port_id : port_id)}}});
+		}
+
+		std::vector<size_t> order;
+		for (size_t i = 0; i < adds.size(); ++i)
+			order.insert(order.end(), {i, i});
+		std::shuffle(order.begin(), order.end(), rng);
+
+		client.steps.clear();
+		client.next = 0;
+		std::vector<bool> added(adds.size(), false);
+		for (size_t i : order) {
+			if (added[i])
+				client.steps.push_back({true, adds[i].id, nullptr, {}});
+			else
+				client.steps.push_back(adds[i]);
+			added[i] = true;
+		}
+	}
+
+	void record(RegistryRecording& recording, const Step& step)
+	{
+		if (step.remove) {
+			recording.record_global_remove(step.id);
+			return;
+		}
+		items.clear();
+		for (const auto& [key, value] : step.props)
+			items.push_back(SPA_DICT_ITEM_INIT(key.c_str(), value.c_str()));
+		spa_dict props = SPA_DICT_INIT(items.data(), uint32_t(items.size()));
+		recording.record_global(step.id, step.type, &props);
+	}
+
+	std::mt19937 rng {42};
+	uint32_t next_id;
+	size_t nr_clients = 0;
+	std::vector<uint32_t> device_i_ports;
+	std::vector<uint32_t> device_o_ports;
+	std::vector<Client> clients;
+	std::vector<spa_dict_item> items;
+};
+
+int main(int argc, char *argv[])
+{
+	try {
+		size_t nr_events = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8'000'000;
+		size_t nr_epoch_events = std::max<size_t>(1, nr_events / nr_epochs);
+
+		RegistryModel model;
+		Churn churn {100};
+		RegistryRecording recording;
+		// only the model allocates while replaying, so the heap deltas of the replays are its heap
+		size_t model_heap = 0;
+		auto replay = [&]() {
+			size_t heap_before = heap_bytes;
+			auto start = std::chrono::steady_clock::now();
+			recording.replay(model);
+			double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			model_heap += heap_bytes - heap_before;
+			return secs;
+		};
+
+		churn.add_devices(recording);
+		replay();
+
+		std::vector<size_t> epoch_heaps;
+		std::vector<double> epoch_costs;
+		std::printf("epoch   objects   model heap   ns/event\n");
+		for (size_t epoch = 0; epoch < nr_epochs; ++epoch) {
+			recording.clear();
+			churn.next_events(recording, nr_epoch_events);
+			double secs = replay();
+			size_t nr_objects = model.get_nr_nodes() + model.get_nr_ports() + model.get_nr_links();
+			epoch_heaps.push_back(model_heap);
+			epoch_costs.push_back(secs * 1e9 / nr_epoch_events);
+			std::printf("%5zu %9zu %10.1f KiB %10.1f\n", epoch, nr_objects, model_heap / 1024.0,
+					epoch_costs.back());
+		}
+
+		// the live graph size wanders a bit, compare the peaks of each half after warm up
+		size_t half = nr_warmup_epochs + (nr_epochs - nr_warmup_epochs) / 2;
+		auto first_heaps = std::max_element(epoch_heaps.begin() + nr_warmup_epochs, epoch_heaps.begin() + half);
+		auto last_heaps = std::max_element(epoch_heaps.begin() + half, epoch_heaps.end());
+		std::sort(epoch_costs.begin() + nr_warmup_epochs, epoch_costs.begin() + half);
+		std::sort(epoch_costs.begin() + half, epoch_costs.end());
+		double first_cost = epoch_costs[(nr_warmup_epochs + half) / 2];
+		double last_cost = epoch_costs[(half + nr_epochs) / 2];
+
+		std::printf("events:            %zu\n", nr_epoch_events * nr_epochs);
+		std::printf("peak model heap:   %.1f KiB -> %.1f KiB\n", *first_heaps / 1024.0, *last_heaps / 1024.0);
+		std::printf("median ns/event:   %.1f -> %.1f\n", first_cost, last_cost);
+
+		bool failed = false;
+		if (*last_heaps > *first_heaps * max_heap_growth) {
+			std::fprintf(stderr, "model heap keeps growing under churn\n");
+			failed = true;
+		}
+		if (last_cost > first_cost * max_cost_drift) {
+			std::fprintf(stderr, "cost per event keeps growing under churn\n");
+			failed = true;
+		}
+		return failed ? 1 : 0;
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,149 @@
+#include <audioeq/thread_settings.h>
+#include <audioeq/filters/low_pass.h>
+#include <audioeq/utils/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+/* Timing of a periodic callback under background load, with default scheduling against
+ * SCHED_FIFO, CPU affinity and locked memory. The callback wakes every quantum of 64 frames at
+ * 48 kHz and runs a stereo low pass over it, the way a data thread would. The load is a
+ * utils::ThreadPool, its workers pinned away from the callback's CPU in the second run through
+ * the Worker thread settings, mapping, touching and unmapping memory as fast as they can.
+ * Reports how late the callback woke up, in percentiles, and how many quanta it missed. */
+
+constexpr int sample_rate = 48000;
+constexpr size_t quantum = 64;
+constexpr auto period = std::chrono::nanoseconds(1000000000LL * quantum / sample_rate);
+constexpr size_t nr_periods = 5000;
+constexpr size_t load_buffer_size = 16 << 20;
+
+struct Result {
+	std::vector<int64_t> lateness_ns;
+	size_t nr_missed = 0;
+	int err = 0;
+};
+
+static void add_ns(timespec& t, int64_t ns)
+{
+	t.tv_nsec += ns;
+	while (t.tv_nsec >= 1000000000) {
+		t.tv_nsec -= 1000000000;
+		++t.tv_sec;
+	}
+}
+
+static int64_t diff_ns(const timespec& a, const timespec& b)
+{
+	return (a.tv_sec - b.tv_sec) * 1000000000LL + (a.tv_nsec - b.tv_nsec);
+}
+
+static void run_callback(const aeq::ThreadSettings& settings, Result& result)
+{
+	result.err = aeq::apply_thread_settings(settings);
+
+	aeq::filters::LowPassFilter filter {1000.0F, sample_rate, 2};
+	filter.init_detached();
+	std::vector<float> left(quantum, 0.25F), right(quantum, -0.25F);
+	float *bufs[] = {left.data(), right.data()};
+
+	result.lateness_ns.reserve(nr_periods);
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	for (size_t i = 0; i < nr_periods; ++i) {
+		add_ns(deadline, period.count());
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		const int64_t late = diff_ns(now, deadline);
+		result.lateness_ns.push_back(late);
+		filter.process_detached(bufs, bufs, quantum);
+
+		// a wakeup later than a whole period missed the quanta in between
+		if (late >= period.count()) {
+			result.nr_missed += late / period.count();
+			while (diff_ns(now, deadline) >= period.count())
+				add_ns(deadline, period.count());
+		}
+	}
+}
+
+static Result measure(const aeq::ThreadSettings& callback_settings, size_t nr_load_threads)
+{
+	std::atomic<bool> stop {false};
+	// the pool starts its workers with the Worker settings, the calling thread isn't one
+	auto pool = std::make_unique<aeq::utils::ThreadPool>(nr_load_threads + 1);
+	std::thread load([&]
+	{
+		pool->parallel_for(nr_load_threads + 1, [&](size_t i)
+		{
+			if (i == 0)
+				return;
+			while (!stop.load(std::memory_order_relaxed)) {
+				auto buf = std::make_unique<char[]>(load_buffer_size);
+				std::memset(buf.get(), int(i), load_buffer_size);
+			}
+		});
+	});
+
+	Result result;
+	std::thread callback(run_callback, std::cref(callback_settings), std::ref(result));
+	callback.join();
+	stop = true;
+	load.join();
+	return result;
+}
+
+static void print(const char *name, Result& result)
+{
+	std::vector<int64_t>& late = result.lateness_ns;
+	std::sort(late.begin(), late.end());
+	auto pct = [&](double p) { return double(late[size_t(p * (late.size() - 1))]) / 1000.0; };
+	std::printf("%-10s %10.1f %10.1f %10.1f %10.1f %8zu  %s\n", name, pct(0.5), pct(0.99), pct(0.999),
+			double(late.back()) / 1000.0, result.nr_missed, result.err ? std::strerror(result.err) : "");
+}
+
+int main()
+{
+	const unsigned int nr_cpus = std::max(1U, std::thread::hardware_concurrency());
+	const unsigned int rt_cpu = nr_cpus - 1;
+	const size_t nr_load_threads = std::max(2U, nr_cpus);
+
+	std::printf("%u cpus, %zu load threads, period %.0f us\n", nr_cpus, nr_load_threads, period.count() / 1000.0);
+	std::printf("%-10s %10s %10s %10s %10s %8s\n", "late us", "p50", "p99", "p99.9", "max", "missed");
+
+	Result plain = measure(aeq::ThreadSettings(), nr_load_threads);
+	print("default", plain);
+
+	aeq::ThreadSettings rt;
+	rt.cpus = {rt_cpu};
+	rt.fifo_priority = 80;
+	rt.prefault_stack_size = 256 << 10;
+	// with a single cpu the load shares it, SCHED_FIFO alone keeps it off the callback
+	aeq::ThreadSettings workers;
+	for (unsigned int cpu = 0; cpu < nr_cpus; ++cpu) {
+		if (cpu != rt_cpu || nr_cpus == 1)
+			workers.cpus.push_back(cpu);
+	}
+	aeq::set_thread_settings(aeq::ThreadRole::Worker, workers);
+	const char *lock_err = "";
+	try {
+		aeq::lock_memory();
+	} catch (const aeq::ThreadSettingsErr& e) {
+		lock_err = e.what();
+	}
+	Result fifo = measure(rt, nr_load_threads);
+	print("fifo", fifo);
+	if (*lock_err)
+		std::printf("%s\n", lock_err);
+	if (int err = aeq::get_thread_settings_error(aeq::ThreadRole::Worker))
+		std::printf("worker settings: %s\n", std::strerror(err));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "err.h"
+#include "utils/spsc_ring.h"
+
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aeq {
+
+/* Analysis tap that can be attached to a filter's input or output.
+ * The RT thread only copies each channel's block into a wait-free SPSC ring and drops data
+ * when the analysis thread falls behind. The analysis thread runs Hann-windowed FFTs,
+ * peak/RMS meters and log-frequency decimation of the spectrum for display clients.
+ * This class is not intended to be movable/copiable. */
+class AnalysisTap {
+public:
+	struct Levels {
+		float peak = 0.0F;
+		float rms = 0.0F;
+	};
+
+	/* fft_size must be a power of two. max_block_size should be at least the largest
+	 * quantum of the graph, so that every quantum is a single ring slot. */
+	AnalysisTap(unsigned int nr_channels, int sample_rate,
+			size_t fft_size = 2048, size_t nr_display_bins = 64,
+			size_t max_block_size = 8192, size_t nr_blocks = 16);
+	~AnalysisTap();
+
+	AnalysisTap(const AnalysisTap&) = delete;
+	AnalysisTap& operator=(const AnalysisTap&) = delete;
+	AnalysisTap(AnalysisTap&&) = delete;
+	AnalysisTap& operator=(AnalysisTap&&) = delete;
+
+	/* Copy a block of samples of a channel into the ring. RT-safe, never blocks. */
+	void push(unsigned int channel, const float *data, size_t nr_samples) noexcept;
+
+	/* Get the latest decimated magnitude spectrum of a channel in dBFS. */
+	void get_spectrum(unsigned int channel, std::vector<float>& spectrum) const;
+	/* Get the latest peak and RMS levels of a channel (linear). */
+	Levels get_levels(unsigned int channel) const;
+
+	/* Get number of blocks dropped because the analysis thread fell behind. */
+	uint64_t get_nr_dropped() const;
+	unsigned int get_nr_channels() const;
+private:
+	struct Channel {
+		std::unique_ptr<utils::SPSCBlockRing<float>> ring;
+
+		std::vector<float> frame;
+		size_t frame_fill = 0;
+
+		float peak = 0.0F;
+		float mean_square = 0.0F;
+
+		std::vector<float> spectrum;
+		Levels levels;
+	};
+
+	void run();
+	void analyze_block(Channel& channel, const float *data, size_t nr_samples);
+	void analyze_frame(Channel& channel);
+	void fft();
+
+	unsigned int nr_channels;
+	int sample_rate;
+	size_t fft_size;
+	size_t nr_display_bins;
+
+	std::vector<Channel> channels;
+
+	std::vector<float> window;
+	std::vector<size_t> bit_reversed;
+	std::vector<std::complex<float>> twiddles;
+	std::vector<std::complex<float>> fft_buf;
+	std::vector<float> magnitudes;
+	std::vector<size_t> display_bin_edges;
+
+	std::atomic<uint64_t> nr_dropped {0};
+	std::atomic<bool> running {true};
+	mutable std::mutex display_mutex;
+	std::thread analysis_thread;
+};
+
+struct AnalysisTapErr : AudioEqErr {
+	AnalysisTapErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
@@ -2,4 +2,11 @@
 
 #include "objects.h"
 #include "core.h"
+#include "registry_recording.h"
+#include "filter_host.h"
+#include "preset.h"
+#include "pipe_stream.h"
+#include "param_surface.h"
+#include "plugin_stage.h"
+#include "thread_settings.h"
 #include "err.h"
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "err.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace aeq {
+
+/* Streams what a filter received and produced into a 32-bit float WAV file, for debugging.
+ * The RT thread only interleaves each quantum into a preallocated lock-free ring and drops whole
+ * quanta when the ring is full, counting them as overruns. A writer thread writes the ring
+ * straight to disk in large aligned chunks, with O_DIRECT when the filesystem supports it,
+ * so captures do not fill the page cache.
+ * Channels are the filter's inputs followed by its outputs. The WAV sizes are written on
+ * destruction. This class is not intended to be movable/copiable. */
+class CaptureTap {
+public:
+	/* ring_ms is the audio the ring holds before quanta are dropped, which should cover the
+	 * longest write stall expected from the disk. */
+	CaptureTap(const char *path, unsigned int nr_channels, int sample_rate, unsigned int ring_ms = 2000);
+	~CaptureTap();
+
+	CaptureTap(const CaptureTap&) = delete;
+	CaptureTap& operator=(const CaptureTap&) = delete;
+	CaptureTap(CaptureTap&&) = delete;
+	CaptureTap& operator=(CaptureTap&&) = delete;
+
+	/* Reserve room for a quantum of nr_frames frames. Returns false and counts an overrun if the
+	 * ring is full, then the quantum must not be written. RT-safe, never blocks. */
+	bool reserve(size_t nr_frames) noexcept;
+	/* Write one channel of the reserved quantum, nullptr writes silence. RT-safe. */
+	void write_channel(unsigned int channel, const float *data) noexcept;
+	/* Hand the reserved quantum over to the writer thread. RT-safe. */
+	void commit() noexcept;
+
+	/* Get number of quanta dropped because the ring was full. */
+	uint64_t get_nr_overruns() const;
+	/* Get number of frames dropped because the ring was full. */
+	uint64_t get_nr_dropped_frames() const;
+	/* Get number of audio bytes written to the file so far. */
+	uint64_t get_nr_bytes_written() const;
+	/* Get number of failed writes. Data of a failed write is lost. */
+	uint64_t get_nr_write_errors() const;
+	/* Whether the file is written with O_DIRECT. */
+	bool is_direct() const;
+	unsigned int get_nr_channels() const;
+
+	/* Size and alignment of each write. */
+	static constexpr size_t chunk_size = 1 << 20;
+private:
+	void run();
+	/* Write every complete chunk of the ring. Returns whether anything was written. */
+	bool write_chunks();
+	/* Write the last partial chunk and the final WAV header. */
+	void finish();
+	void write_header(uint64_t nr_data_bytes);
+
+	int fd = -1;
+	bool direct = false;
+	unsigned int nr_channels;
+	int sample_rate;
+
+	/* Ring of interleaved samples, a multiple of chunk_size bytes and aligned for O_DIRECT. */
+	float *ring = nullptr;
+	size_t ring_size = 0;
+	size_t reserved_frames = 0;
+	size_t reserved_at = 0;
+
+	alignas(64) std::atomic<uint64_t> write_idx {0};
+	alignas(64) std::atomic<uint64_t> read_idx {0};
+
+	std::atomic<uint64_t> nr_overruns {0};
+	std::atomic<uint64_t> nr_dropped_frames {0};
+	std::atomic<uint64_t> nr_bytes_written {0};
+	std::atomic<uint64_t> nr_write_errors {0};
+
+	std::atomic<bool> running {true};
+	std::thread writer_thread;
+};
+
+struct CaptureTapErr : AudioEqErr {
+	CaptureTapErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
@@ -5,10 +5,14 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "objects.h"
 #include "filter.h"
 #include "err.h"
+#include "registry_model.h"
+#include "registry_recording.h"
+#include "routing.h"
 #include "utils/defer.h"
 
 namespace aeq {
@@ -18,21 +22,6 @@ namespace aeq {
  * as well as creating and deleting new ones.
  * This class is not intended to be movable/copiable. */
 class Core {
-	struct LinkInfo {
-		ID_Ptr<Port> i_port;
-		ID_Ptr<Port> o_port;
-	};
-
-	struct RegistryObjects {
-		std::unordered_map<uint32_t, std::unique_ptr<Node>> nodes;
-		std::unordered_map<uint32_t, std::unique_ptr<Port>> ports;
-
-		std::unordered_map<uint32_t, LinkInfo> links;
-
-		std::unordered_map<uint32_t, std::vector<Port *>>   nodeless_ports;
-		std::unordered_map<uint32_t, std::vector<LinkInfo>> portless_links;
-	};
-
 	template<typename T> struct T_deleter {
 		void operator()(T *);
 	};
@@ -42,6 +31,14 @@ class Core {
 	struct RegistryEventUserData {
 		Core *self;
 	};
+
+	/* User data of a link proxy requested by the routing rules. */
+	struct PendingLinkData {
+		Core *self;
+		pw_proxy *proxy;
+		uint64_t link_key;
+		spa_hook listener;
+	};
 public:
 	Core(int &argc, char **&argv);
 	~Core();
@@ -60,6 +57,12 @@ public:
 
 	/* List all currently available nodes. */
 	void list_nodes(std::vector<Node *>& nodes) const;
+	/* Call f(Node&) for every node, without collecting them first. */
+	template<typename F>
+	void for_each_node(F&& f) const;
+	/* Call f(Node&) for every node of given media class. */
+	template<typename F>
+	void for_each_node_of_class(std::string_view media_class, F&& f) const;
 
 	/* Link two ports. Returns a link id. */
 	uint32_t link_ports(Port& o_port, Port& i_port);
@@ -69,20 +72,51 @@ public:
 	/* Initialize Filter with an actual backend. */
 	void init_filter(Filter& filter, const char *name);
 
+	/* Run func synchronously on the realtime data thread, serialized with all process callbacks.
+	 * Used to publish state to the RT side without locks or allocations on it. */
+	void invoke_on_data_loop(void (*func)(void *), void *data);
+
+	/* Record all registry events into recording from now on, nullptr stops recording.
+	 * The recording is written on the loop thread, only touch it while not recording. */
+	void set_recording(RegistryRecording *recording);
+
+	/* Replace the automatic routing rules. Nodes already present are routed by the new rules too.
+	 * Links are only ever added by the rules, never removed. Ports are linked by the channel
+	 * suffix of their names, like FL of "output_FL", or in the order they appeared if the
+	 * channels of a node don't all match. */
+	void set_routing_rules(std::vector<RoutingRule> rules);
+	std::vector<RoutingRule> get_routing_rules() const;
+
 	/* Find node with given id. */
 	Node *find_node(uint32_t id) const;
+	/* Find the first node with given name. */
+	Node *find_node_by_name(std::string_view name) const;
 	/* Find port with given id. */
 	Port *find_port(uint32_t id) const;
+	/* Find port of a node by its name and direction. */
+	Port *find_port(uint32_t node_id, std::string_view name, PortDirection direction) const;
 private:
 	void setup_registry_events() noexcept;
 
-	void wrap_node(uint32_t id, const spa_dict *props);
-	void wrap_port(uint32_t id, const spa_dict *props);
-	void wrap_link(uint32_t id, const spa_dict *props);
-
-	bool try_unwrap_node(uint32_t id);
-	bool try_unwrap_port(uint32_t id);
-	bool try_unwrap_link(uint32_t id);
+	/* Update routing state for a new global. */
+	void route_global(uint32_t id, const char *type, const spa_dict *props);
+	/* Match a node against the routing rules. */
+	void route_node(Node& node);
+	/* Recheck the nodes routed to a node of given name, which got new ports. */
+	void mark_routed_to(const std::string& target_name);
+	void mark_routing_dirty(uint32_t node_id);
+	/* Create the missing links of all nodes marked dirty. Runs once per loop iteration,
+	 * so the links of a node and its ports appearing together are created as one batch. */
+	void flush_routing();
+	/* Pair the output ports of a node with the input ports of a target, channel by channel. */
+	static void pair_channels(const Node& node, const Node& target, std::vector<std::pair<Port *, Port *>>& pairs);
+
+	/* Create a link proxy with user data of given size, nullptr on failure. */
+	pw_proxy *create_link(const Port& o_port, const Port& i_port, size_t user_data_size);
+	/* Request a link for the routing rules, pending until it appears in the registry or fails. */
+	void request_link(const Port& o_port, const Port& i_port, uint64_t link_key);
+	/* Drop the pending links to or from a port that went away, so they can be requested again. */
+	void forget_pending_links(uint32_t port_id);
 
 	void do_roundtrip();
 
@@ -96,7 +130,20 @@ private:
 	RegistryEventUserData reud;
 	spa_hook registry_listener;
 
-	RegistryObjects registry_objects;
+	RegistryModel model;
+	RegistryRecording *recording = nullptr;
+
+	RoutingRules routing_rules;
+	/* Rules matched by each node matching any. */
+	std::unordered_map<uint32_t, std::vector<size_t>> routed_nodes;
+	/* Routed nodes to create missing links for on the next flush. */
+	std::unordered_set<uint32_t> dirty_routed_nodes;
+	/* Links requested but not seen in the registry yet, as output port id << 32 | input port id,
+	 * to the id of their proxy. */
+	std::unordered_map<uint64_t, uint32_t> pending_links;
+	/* Proxies of the links requested by the rules which still exist, destroyed before the core. */
+	std::unordered_set<PendingLinkData *> routed_links;
+	spa_source *routing_event = nullptr;
 
 	static void on_global(void *data, uint32_t id,
 			uint32_t permissions,
@@ -104,10 +151,27 @@ private:
 			uint32_t version,
 			const spa_dict *props);
 	static void on_global_remove(void *data, uint32_t id);
+	static void on_routing_event(void *data, uint64_t count);
+	static void on_pending_link_removed(void *data);
+	static void on_pending_link_destroy(void *data);
+	static void on_pending_link_error(void *data, int seq, int res, const char *message);
 
 	static pw_registry_events registry_events;
+	static pw_proxy_events pending_link_events;
 };
 
+template<typename F>
+void Core::for_each_node(F&& f) const
+{
+	model.for_each_node(std::forward<F>(f));
+}
+
+template<typename F>
+void Core::for_each_node_of_class(std::string_view media_class, F&& f) const
+{
+	model.for_each_node_of_class(media_class, std::forward<F>(f));
+}
+
 struct CoreErr : AudioEqErr {
 	CoreErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
 };
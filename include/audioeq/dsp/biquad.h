@@ -0,0 +1,219 @@
+#pragma once
+
+#include "coeffs.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace aeq::dsp {
+
+/* Precision of the recursive state of a biquad stage, independent of the f32 I/O buffers. */
+enum class StatePrecision : uint8_t {
+	F32,
+	F64,
+	/* f32 direct form I with coefficients kept precise near z = 1 and all rounding errors fed
+	 * into the next sample. f32 state and lanes, far less noise than F32 for low frequency poles. */
+	F32ErrorFeedback,
+};
+
+/* Pick a state precision for a stage: low frequencies relative to the sample rate put the poles
+ * close to z = 1, where f32 state loses the most precision. */
+StatePrecision recommend_precision(float freq, int sample_rate);
+
+/* Biquad coefficients in the precision the kernel runs at. */
+template<typename T>
+struct Biquad {
+	T b0 = 1, b1 = 0, b2 = 0;
+	T a1 = 0, a2 = 0;
+
+	Biquad() = default;
+	explicit Biquad(const BiquadCoeffs& c)
+		: b0(T(c.b0)), b1(T(c.b1)), b2(T(c.b2)), a1(T(c.a1)), a2(T(c.a2)) {}
+};
+
+/* State of a transposed direct form II biquad. */
+template<typename T>
+struct BiquadState {
+	T z1 = 0;
+	T z2 = 0;
+};
+
+/* State of an error feedback direct form I biquad. */
+struct BiquadEFState {
+	float x1 = 0, x2 = 0;
+	float y1 = 0, y2 = 0;
+	float err = 0;
+};
+
+/* Run one transposed direct form II biquad over a block, computing in State precision.
+ * in and out may alias. */
+template<typename Sample, typename State>
+inline void process_biquad(const Biquad<State>& c, BiquadState<State>& s,
+		const Sample *in, Sample *out, size_t nr_samples)
+{
+	State z1 = s.z1, z2 = s.z2;
+	for (size_t i = 0; i < nr_samples; ++i) {
+		const State x = in[i];
+		const State y = c.b0 * x + z1;
+		z1 = c.b1 * x - c.a1 * y + z2;
+		z2 = c.b2 * x - c.a2 * y;
+		out[i] = Sample(y);
+	}
+	s.z1 = z1;
+	s.z2 = z2;
+}
+
+/* Error feedback f32 biquad coefficients. Poles and zeros near z = 1 are where f32 coefficients
+ * round them away the most, so the coefficients are kept as their distance to the double root at
+ * z = 1: a1 = d1 - 2, a2 = d2 + 1, b1 = e1 - 2 * b0 and b2 = e2 + b0. */
+struct BiquadEF {
+	float b0 = 1, e1 = 2, e2 = -1;
+	float d1 = 2, d2 = -1;
+
+	BiquadEF() = default;
+	explicit BiquadEF(const BiquadCoeffs& c)
+		: b0(float(c.b0)), e1(float(c.b1 + 2.0 * c.b0)), e2(float(c.b2 - c.b0)),
+		d1(float(c.a1 + 2.0)), d2(float(c.a2 - 1.0)) {}
+};
+
+namespace detail {
+
+/* s + e == a + b exactly. */
+inline void two_sum(float a, float b, float& s, float& e)
+{
+	s = a + b;
+	const float b_virtual = s - a;
+	e = (a - (s - b_virtual)) + (b - b_virtual);
+}
+
+/* Add the product c * x to acc, collecting the rounding errors of the product and the sum. */
+inline void add_product(float& acc, float& err, float c, float x)
+{
+	const float p = c * x;
+	float e;
+	two_sum(acc, p, acc, e);
+	err += e + std::fma(c, x, -p);
+}
+
+}
+
+/* Run one error feedback f32 direct form I biquad over a block. in and out may alias.
+ * Every rounding error of an output sample is collected and fed into the next one, so the error
+ * reaches the poles through a zero at DC instead of the full resonant gain of low frequency poles.
+ * Costs about 2.5x f32 when std::fma maps to an instruction (-mfma), about 7x with the default
+ * flags, where it is a libm call. Needs strict IEEE float evaluation (no -ffast-math). */
+template<typename Sample>
+inline void process_biquad_ef(const BiquadEF& c, BiquadEFState& s,
+		const Sample *in, Sample *out, size_t nr_samples)
+{
+	float x1 = s.x1, x2 = s.x2, y1 = s.y1, y2 = s.y2, err = s.err;
+	for (size_t i = 0; i < nr_samples; ++i) {
+		const float x = in[i];
+		float acc, next_err = 0.0F, e;
+
+		// (2 * y1 - y2) - d1 * y1 - d2 * y2
+		detail::two_sum(2.0F * y1, -y2, acc, e);
+		next_err += e;
+		detail::add_product(acc, next_err, -c.d1, y1);
+		detail::add_product(acc, next_err, -c.d2, y2);
+
+		// b0 * (x - 2 * x1 + x2) + e1 * x1 + e2 * x2
+		float d2x, d2x_err;
+		detail::two_sum(x, -2.0F * x1, d2x, e);
+		detail::two_sum(d2x, x2, d2x, d2x_err);
+		next_err += c.b0 * (e + d2x_err);
+		detail::add_product(acc, next_err, c.b0, d2x);
+		detail::add_product(acc, next_err, c.e1, x1);
+		detail::add_product(acc, next_err, c.e2, x2);
+
+		// what the previous sample rounded off
+		detail::two_sum(acc, err, acc, e);
+		next_err += e;
+
+		const float y = acc;
+		err = next_err;
+
+		x2 = x1;
+		x1 = x;
+		y2 = y1;
+		y1 = y;
+		out[i] = Sample(y);
+	}
+	s.x1 = x1; s.x2 = x2;
+	s.y1 = y1; s.y2 = y2;
+	s.err = err;
+}
+
+/* One biquad stage with a runtime selected state precision. */
+struct BiquadStage {
+	StatePrecision precision = StatePrecision::F32;
+	Biquad<float> f32;
+	Biquad<double> f64;
+	BiquadEF ef;
+
+	BiquadStage() = default;
+	BiquadStage(const BiquadCoeffs& c, StatePrecision precision)
+		: precision(precision), f32(c), f64(c), ef(c) {}
+};
+
+/* State of a BiquadStage of any precision. Zero is the initial state of every precision. */
+union BiquadStageState {
+	BiquadState<float> f32;
+	BiquadState<double> f64;
+	BiquadEFState ef;
+
+	BiquadStageState() : ef() {}
+};
+
+/* Whether every value of the state of a stage is within threshold of zero. */
+inline bool is_state_below(const BiquadStage& stage, const BiquadStageState& s, float threshold)
+{
+	switch (stage.precision) {
+	case StatePrecision::F32:
+		return std::fabs(s.f32.z1) <= threshold && std::fabs(s.f32.z2) <= threshold;
+	case StatePrecision::F64:
+		return std::fabs(s.f64.z1) <= threshold && std::fabs(s.f64.z2) <= threshold;
+	case StatePrecision::F32ErrorFeedback:
+		return std::fabs(s.ef.x1) <= threshold && std::fabs(s.ef.x2) <= threshold
+			&& std::fabs(s.ef.y1) <= threshold && std::fabs(s.ef.y2) <= threshold;
+	}
+	return false;
+}
+
+/* Run a stage over a block. in and out may alias. */
+template<typename Sample>
+inline void process_stage(const BiquadStage& stage, BiquadStageState& s,
+		const Sample *in, Sample *out, size_t nr_samples)
+{
+	switch (stage.precision) {
+	case StatePrecision::F32:
+		process_biquad(stage.f32, s.f32, in, out, nr_samples);
+		break;
+	case StatePrecision::F64:
+		process_biquad(stage.f64, s.f64, in, out, nr_samples);
+		break;
+	case StatePrecision::F32ErrorFeedback:
+		process_biquad_ef(stage.ef, s.ef, in, out, nr_samples);
+		break;
+	}
+}
+
+/* Run a cascade of stages over a block, each stage in place on out. in and out may alias. */
+template<typename Sample>
+inline void process_cascade(const BiquadStage *stages, BiquadStageState *states, size_t nr_stages,
+		const Sample *in, Sample *out, size_t nr_samples)
+{
+	if (nr_stages == 0) {
+		if (in != out) {
+			for (size_t i = 0; i < nr_samples; ++i)
+				out[i] = in[i];
+		}
+		return;
+	}
+	process_stage(stages[0], states[0], in, out, nr_samples);
+	for (size_t stage = 1; stage < nr_stages; ++stage)
+		process_stage(stages[stage], states[stage], out, out, nr_samples);
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "audioeq/err.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace aeq::dsp {
+
+enum class FilterType {
+	OnePoleLowPass,
+	LowPass,
+	HighPass,
+	BandPass,
+	Notch,
+	Peaking,
+	LowShelf,
+	HighShelf,
+	AllPass,
+};
+
+/* Biquad coefficients normalized so that a0 is 1.
+ * Kept in double so that f64 state kernels don't inherit float rounding of the design. */
+struct BiquadCoeffs {
+	double b0 = 1.0, b1 = 0.0, b2 = 0.0;
+	double a1 = 0.0, a2 = 0.0;
+};
+
+/* Exact design with the usual transcendental math (RBJ cookbook biquads, RC one-pole low pass).
+ * q and gain_db are ignored by the types that don't use them. */
+BiquadCoeffs design(FilterType type, float freq, float q, float gain_db, int sample_rate);
+
+/* Magnitude response of a biquad in dB at given frequency, floored at -120 dB. */
+double magnitude_db(const BiquadCoeffs& coeffs, double freq, int sample_rate);
+
+/* Lookup table of coefficients of one filter type, Q, gain and sample rate over frequency.
+ * Frequencies are split into octaves starting at min_freq, each octave holding points_per_octave
+ * linearly spaced points, so finding the position of a frequency needs only frexp and no logarithm.
+ * The octave nyquist falls in holds the points below it and a last one at nyquist.
+ * Coefficients are linearly interpolated between neighbouring points. */
+class CoefficientTable {
+public:
+	struct AccuracyReport {
+		size_t nr_probes = 0;
+		double max_coeff_err = 0.0;
+		double max_response_err_db = 0.0;
+		double mean_response_err_db = 0.0;
+	};
+
+	static constexpr float min_freq = 8.0F;
+	static constexpr size_t points_per_octave = 64;
+
+	CoefficientTable(FilterType type, float q, float gain_db, int sample_rate);
+
+	/* Interpolated coefficients at given frequency. Frequencies outside
+	 * [min_freq, max_freq), max_freq being nyquist, are designed exactly. */
+	BiquadCoeffs lookup(float freq) const;
+
+	/* Compare interpolated against exact design at nr_probes log-spaced frequencies.
+	 * Responses are compared down to -80 dB, so that the depth of a notch doesn't dominate. */
+	AccuracyReport measure_accuracy(size_t nr_probes = 4096) const;
+
+	float get_max_freq() const;
+private:
+	FilterType type;
+	float q;
+	float gain_db;
+	int sample_rate;
+	float max_freq;
+	/* Frequency of the last point before the one at nyquist. */
+	float last_grid_freq = 0.0F;
+
+	std::vector<BiquadCoeffs> points;
+};
+
+/* Thread-safe cache of coefficient tables keyed by filter type, Q, gain and sample rate.
+ * A table is built once on first request, so parameter changes cost a table lookup afterwards. */
+class CoefficientCache {
+	struct Key {
+		FilterType type;
+		float q;
+		float gain_db;
+		int sample_rate;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+public:
+	/* Get the table for given parameters, building it if not cached yet. Not RT-safe. */
+	std::shared_ptr<const CoefficientTable> get_table(FilterType type, float q, float gain_db, int sample_rate);
+
+	size_t get_nr_tables() const;
+
+	/* Cache shared by the whole process. */
+	static CoefficientCache& shared();
+private:
+	mutable std::mutex mutex;
+	std::unordered_map<Key, std::shared_ptr<const CoefficientTable>, KeyHash> tables;
+};
+
+struct CoeffsErr : AudioEqErr {
+	CoeffsErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "coeffs.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace aeq::dsp {
+
+/* Independent biquads run side by side, one per lane, over interleaved data.
+ * All lanes advance together sample by sample, so the loop over lanes vectorizes whatever mix
+ * of channels and filters the lanes hold. Computes in T precision with the kernels of
+ * dsp::kernels(). */
+template<typename T>
+class BiquadBank {
+public:
+	BiquadBank() = default;
+	explicit BiquadBank(size_t nr_lanes);
+
+	void set_lane(size_t lane, const BiquadCoeffs& c);
+	void reset();
+	/* Whether the state of every lane is within threshold of zero. */
+	bool is_state_below(T threshold) const;
+
+	/* Run every lane over nr_samples frames, sample i of lane l being data[i * stride + l]. */
+	void process(T *data, size_t stride, size_t nr_samples);
+
+	size_t get_nr_lanes() const;
+private:
+	std::vector<T> b0, b1, b2, a1, a2;
+	std::vector<T> z1, z2;
+};
+
+/* Linkwitz-Riley 24 dB/oct crossover splitting channels into phase-coherent bands: the sum of
+ * all bands is an allpass of the input.
+ * Built as a tree: every split runs its low and high pass side by side on the high band of the
+ * previous split, so the sections common to the upper bands are computed once. Each lower band
+ * is then delayed by the allpasses of the splits above it to stay in phase. */
+template<typename T>
+class LRCrossover {
+public:
+	static constexpr size_t min_bands = 2;
+	static constexpr size_t max_bands = 6;
+
+	/* freqs are the strictly increasing crossover frequencies, one less than bands. */
+	LRCrossover(const std::vector<float>& freqs, int sample_rate, unsigned int nr_channels);
+
+	/* in holds nr_channels buffers, nullptr reading as silence. out holds nr_bands x nr_channels
+	 * buffers, band after band, nullptr ones are skipped. An output may alias an input. */
+	void process(const float *const *in, float *const *out, size_t nr_samples);
+	void reset();
+	/* Whether the state of every section is within threshold of zero. */
+	bool is_state_below(float threshold) const;
+
+	size_t get_nr_bands() const;
+	unsigned int get_nr_channels() const;
+
+	/* Frames processed at a time, keeping the interleaved scratch space in cache. */
+	static constexpr size_t block_size = 256;
+private:
+	void process_block(const float *const *in, float *const *out, size_t offset, size_t nr_samples);
+
+	struct Split {
+		/* Lanes are channel * 2 + 0 for the low pass and channel * 2 + 1 for the high pass. */
+		BiquadBank<T> first;
+		BiquadBank<T> second;
+	};
+
+	unsigned int nr_channels;
+	size_t nr_bands;
+
+	std::vector<Split> splits;
+	/* allpasses[j - 1] is the allpass of split j, run on the bands below it, lane band * nr_channels + channel. */
+	std::vector<BiquadBank<T>> allpasses;
+
+	/* block_size x (2 * nr_channels) */
+	std::vector<T> split_buf;
+	/* block_size x ((nr_bands - 1) * nr_channels) */
+	std::vector<T> band_buf;
+};
+
+struct CrossoverErr : AudioEqErr {
+	CrossoverErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
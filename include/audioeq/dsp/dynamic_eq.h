@@ -0,0 +1,90 @@
+#pragma once
+
+#include "crossover.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace aeq::dsp {
+
+/* Bell band whose gain follows the level within the band. */
+struct DynamicBand {
+	float freq = 1000.0F;
+	float q = 1.0F;
+	/* Band level above which the gain starts to move. */
+	float threshold_db = -30.0F;
+	/* The gain moves by 1 - 1 / ratio dB per dB of band level above threshold, ratio at least 1. */
+	float ratio = 4.0F;
+	/* Furthest gain, negative cuts loud bands (de-essing, taming resonances), positive boosts them. */
+	float range_db = -12.0F;
+	float attack_ms = 5.0F;
+	float release_ms = 80.0F;
+};
+
+/* Dynamic equalizer: bell bands whose gain is driven by envelope followers on the band itself.
+ * Every band is a constant peak band pass added to the dry signal: y = x + sum (g - 1) * bp(x),
+ * which is a bell of gain g at the band frequency. The band pass output is at the same time the
+ * detector input and the signal the gain is applied to, so detection costs no extra filter, and
+ * a gain change only moves the mix coefficient g - 1: the coefficients of the bell are linear in
+ * it, so it is interpolated sample by sample instead of redesigning the bell.
+ * Bands run in parallel on the dry signal, so the band passes of all bands and channels run side
+ * by side in one BiquadBank and the followers vectorize across the same lanes. Overlapping bands
+ * add up their gains rather than multiplying them like a cascade would. */
+template<typename T>
+class DynamicEq {
+public:
+	static constexpr size_t max_bands = 8;
+	/* Frames processed at a time, keeping the interleaved scratch space in cache. */
+	static constexpr size_t block_size = 256;
+	/* Frames between gain updates, the mix coefficients ramp linearly in between. */
+	static constexpr size_t control_interval = 32;
+
+	DynamicEq(const std::vector<DynamicBand>& bands, int sample_rate, unsigned int nr_channels);
+
+	/* in and out hold nr_channels buffers. nullptr inputs read as silence, nullptr outputs are
+	 * skipped. An output may alias its input. */
+	void process(const float *const *in, float *const *out, size_t nr_samples);
+	void reset();
+	/* Whether the band passes, envelopes and mix coefficients are all within threshold of zero. */
+	bool is_state_below(float threshold) const;
+
+	/* Replace the settings of a band, clamped into their valid ranges. RT-safe, the band keeps
+	 * its state. */
+	void set_band(size_t band, const DynamicBand& settings);
+	const DynamicBand& get_band(size_t band) const;
+
+	/* Gain of a band and channel in dB at the last processed sample. Not thread-safe against process. */
+	float get_gain_db(size_t band, unsigned int channel) const;
+
+	size_t get_nr_bands() const;
+	unsigned int get_nr_channels() const;
+private:
+	void process_block(const float *const *in, float *const *out, size_t offset, size_t nr_samples);
+	/* Set the lanes of a band up from its settings. */
+	void configure_band(size_t band);
+	/* Gain of a lane in dB for given envelope. */
+	T gain_db(size_t lane, T env) const;
+
+	unsigned int nr_channels;
+	size_t nr_bands;
+	int sample_rate;
+	std::vector<DynamicBand> bands;
+
+	/* Lane band * nr_channels + channel. */
+	BiquadBank<T> band_passes;
+	/* Per lane. */
+	std::vector<T> attack_coeffs;
+	std::vector<T> release_coeffs;
+	std::vector<T> envs;
+	std::vector<T> mixes;
+	std::vector<T> mix_steps;
+
+	/* block_size x (nr_bands * nr_channels) */
+	std::vector<T> band_buf;
+};
+
+struct DynamicEqErr : AudioEqErr {
+	DynamicEqErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
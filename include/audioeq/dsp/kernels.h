@@ -0,0 +1,87 @@
+#pragma once
+
+#include "pcm.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aeq::dsp {
+
+/* Instruction set levels the DSP kernels are built for. One binary carries every level of its
+ * architecture and picks the best one the host supports at startup. */
+enum class Isa : uint8_t {
+	/* Reference kernels, plain serial loops for the baseline of the architecture. */
+	Scalar,
+	/* x86-64 baseline, 4 floats per vector. */
+	Sse2,
+	/* AVX2 with FMA, 8 floats per vector. */
+	Avx2,
+	/* AVX-512F, 16 floats per vector. */
+	Avx512,
+	/* AArch64 baseline, 4 floats per vector. */
+	Neon,
+};
+
+/* Arguments of the biquad bank kernel, see BiquadBank. */
+template<typename T>
+struct BiquadBankArgs {
+	const T *b0, *b1, *b2, *a1, *a2;
+	T *z1, *z2;
+	size_t nr_lanes;
+};
+
+/* Nonzero entry of a mixing matrix. Sample i of a kernel call is weighted by gain + (i + 1) * step,
+ * so a gain change ramps over the call. */
+struct MixEntry {
+	uint32_t input;
+	float gain;
+	float step;
+};
+
+/* Arguments of the matrix mixer kernel, see MatrixMixerFilter. Output o is the sum of the weighted
+ * inputs of entries[starts[o]] up to entries[starts[o + 1]], excluded, and silence without entries. */
+struct MixMatrixArgs {
+	const float *const *in;
+	float *const *out;
+	const MixEntry *entries;
+	const uint32_t *starts;
+	size_t nr_outputs;
+};
+
+/* Kernels of one instruction set level. */
+struct Kernels {
+	Isa isa;
+	/* One-pole low pass y += alpha * (x - y) starting from last_out, which is updated.
+	 * in and out may alias. */
+	void (*one_pole_low_pass)(const float *in, float *out, size_t nr_samples, float alpha, float& last_out);
+	/* Run every lane over nr_samples frames, sample i of lane l being data[i * stride + l]. */
+	void (*biquad_bank_f32)(const BiquadBankArgs<float>& args, float *data, size_t stride, size_t nr_samples);
+	void (*biquad_bank_f64)(const BiquadBankArgs<double>& args, double *data, size_t stride, size_t nr_samples);
+	/* Split nr_frames interleaved frames of nr_channels samples into one float buffer per channel. */
+	void (*deinterleave)(PcmFormat format, const void *in, float *const *out, unsigned int nr_channels,
+			size_t nr_frames);
+	/* Merge one float buffer per channel into interleaved frames, clipping integer formats. */
+	void (*interleave)(PcmFormat format, const float *const *in, void *out, unsigned int nr_channels,
+			size_t nr_frames);
+	/* Mix samples offset to offset + nr_samples of the inputs into the same samples of the outputs.
+	 * Null outputs are skipped, no output may alias an input. */
+	void (*mix_matrix)(const MixMatrixArgs& args, size_t offset, size_t nr_samples);
+};
+
+/* Kernels in use, the best level of the host unless overridden by the AUDIOEQ_ISA environment
+ * variable (scalar, sse2, avx2, avx512 or neon) at first call or by force_isa. RT-safe. */
+const Kernels& kernels();
+
+/* Best level supported by the host. */
+Isa detect_isa();
+/* Whether the host can run the kernels of given level. */
+bool is_isa_supported(Isa isa);
+/* Switch all kernels to given level, e.g. to compare against the reference in tests or
+ * benchmarks. Returns false and keeps the current kernels if the host can't run the level. */
+bool force_isa(Isa isa);
+
+const char *isa_name(Isa isa);
+/* Parse an isa_name, returns false if unknown. */
+bool parse_isa(const char *name, Isa& isa);
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aeq::dsp {
+
+/* Sample formats of raw interleaved PCM streams, in native endianness. Integer samples map
+ * full scale to [-1, 1), floats are taken as they are. */
+enum class PcmFormat : uint8_t {
+	F32,
+	S16,
+	S32,
+};
+
+/* Size of one sample of given format in bytes. */
+size_t get_sample_size(PcmFormat format);
+
+const char *pcm_format_name(PcmFormat format);
+/* Parse a pcm_format_name (f32, s16 or s32), returns false if unknown. */
+bool parse_pcm_format(const char *name, PcmFormat& format);
+
+}
@@ -1,16 +1,59 @@
 #pragma once
 
 #include "objects.h"
+#include "analysis_tap.h"
+#include "capture_tap.h"
+#include "param_surface.h"
 #include "err.h"
 
 #include <pipewire/pipewire.h>
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace aeq {
 
+class Core;
+class FilterHost;
+
+enum class TapPoint { Input, Output };
+
+/* What a filter outputs while its DSP is bypassed because of silence. */
+enum class BypassMode { Zero, PassThrough };
+
+/* Timing of a quantum, from the driver of the graph. Detached filters count the position from
+ * their first quantum and know neither time nor rate. */
+struct ProcessClock {
+	/* Time of the start of the quantum in ns, 0 if detached. */
+	uint64_t nsec = 0;
+	/* Position of the first frame of the quantum, in frames of the driver. */
+	uint64_t position = 0;
+	/* Sample rate of the driver, 0 if detached. */
+	uint32_t rate = 0;
+	/* Rate of the driver relative to its nominal rate. */
+	double rate_diff = 1.0;
+};
+
+/* All buffers of a quantum, one per port in the order the ports were added, resolved once.
+ * Every pointer is valid: missing inputs read silence and missing outputs write into scratch
+ * space, which all missing outputs of a filter share. Inputs and outputs of the same index may
+ * alias for in-place capable filters only. */
+struct ProcessBlock {
+	const float *const *in;
+	float *const *out;
+	size_t nr_inputs;
+	size_t nr_outputs;
+	size_t nr_samples;
+	ProcessClock clock;
+};
+
 /* Filter class abstraction over pipewire filter.
  * The base class of all kinds of audio filters. */
 class Filter {
 	friend class Core;
+	friend class FilterHost;
 	/* Audio port type with no actual data (user data from pipewire perspective) required so far.
 	 * Pointer to this type is used as a reference to a pw_filter port obtained by pw_filter_add_port. */
 	struct AudioPort {};
@@ -20,20 +63,91 @@ class Filter {
 	};
 public:
 	Filter() = default;
-	~Filter();
+	virtual ~Filter();
 
 	Filter(Filter &&) = delete;
 	Filter& operator=(Filter &&) = delete;
 	Filter(const Filter&) = delete;
 	Filter& operator=(const Filter&) = delete;
+
+	/* Attach an analysis tap to the filter's input or output, or detach it by passing nullptr.
+	 * The tap should have as many channels as there are ports at that point and must outlive
+	 * the filter or be detached while the filter is disconnected. */
+	void attach_tap(TapPoint point, AnalysisTap *tap);
+	/* Attach a capture of the filter's inputs and outputs, or detach it by passing nullptr.
+	 * The capture should have as many channels as there are input and output ports together
+	 * and outlives the filter or is detached while the filter is disconnected. */
+	void attach_capture(CaptureTap *capture);
+	/* Attach a surface exposing the parameters and port peaks of the filter to other processes,
+	 * or detach it by passing nullptr. The surface must have been created for this filter and
+	 * outlives the filter or is detached while the filter is disconnected. */
+	void attach_param_surface(ParamSurface *surface);
+
+	/* Parameters other processes may set through a ParamSurface, with their current values as
+	 * defaults. None by default. */
+	virtual std::vector<ParamInfo> get_params() const;
+
+	/* Enable or disable silence detection. Once a processed quantum had all inputs, outputs and
+	 * the filter state (see is_state_below) within threshold, further silent quanta skip
+	 * on_process and output zeros or the input,
+	 * until the first quantum whose input exceeds the threshold, which is processed again. */
+	void set_silence_detection(bool enabled, float threshold = 1e-6F,
+			BypassMode mode = BypassMode::Zero);
+	/* Get number of quanta on_process ran for. */
+	uint64_t get_nr_processed_quanta() const;
+	/* Get number of quanta skipped because of silence. */
+	uint64_t get_nr_skipped_quanta() const;
+
+	/* Set the filter up without pipewire, e.g. to run it over a file or a pipe. Creates the same
+	 * ports as core_init would, none of which appears in a graph. */
+	void init_detached();
+	/* Run one quantum of a detached filter over one buffer per input and output port, in the
+	 * order the ports were added. Buffers of the same index may alias. Quanta longer than
+	 * max_quantum run in chunks of it. Taps, capture and silence detection apply as in a graph. */
+	void process_detached(float *const *in, float *const *out, size_t nr_samples);
+
+	size_t get_nr_input_ports() const;
+	size_t get_nr_output_ports() const;
+
+	/* Largest quantum the framework preallocates scratch space for. */
+	static constexpr size_t max_quantum = 8192;
 protected:
 	/* Initialize core with pw_filter. */
 	virtual void core_init(pw_filter *filter);
 
+	/* Process a quantum, whose buffers and clock get_process_block returns. Filters running one
+	 * kernel over all their channels derive from BlockFilter instead. */
 	virtual void on_process(size_t nr_samples) = 0;
 
+	/* In-place contract: a filter returning true must produce correct output when the input
+	 * and output buffers of the same channel index are the same memory, and must keep its
+	 * state in the filter object rather than in the output buffer.
+	 * Filters returning false are handed a private copy of any input aliased by its output.
+	 * Only process_detached may alias, pw_filter gives every port a buffer of its own. */
+	virtual bool is_inplace_capable() const noexcept;
+
+	/* Buffers and clock of the quantum being processed. Valid during on_process. */
+	const ProcessBlock& get_process_block() const;
+
+	/* Reset the internal DSP state to zero. Called when the filter goes idle on silence,
+	 * so that processing resumes from the same state a silent input would have decayed to. */
+	virtual void reset_state() noexcept;
+	/* Whether the internal DSP state decayed to within threshold of zero, so that reset_state
+	 * loses nothing audible. Silent output alone doesn't tell, a stage with latency or a slow
+	 * filter may still hold a tail. Filters that can't tell return false, the default, and then
+	 * never go idle. Called on the RT thread. */
+	virtual bool is_state_below(float threshold) const noexcept;
+
+	/* Set a parameter of get_params to a value within its range. Called on the RT thread at the
+	 * start of a quantum, once per changed parameter. */
+	virtual void set_param(size_t index, float value);
+
 	void connect();
 	void disconnect();
+	/* Take the filter out of the graph, or out of its host, and wait until the data thread is
+	 * done with it. Subclasses whose destructors free what process uses, e.g. unload code,
+	 * call it first, as ~Filter only runs once they are gone. Not RT-safe. */
+	void stop_processing();
 
 	void add_audio_port(PortDirection direction, const char *name);
 	void rem_audio_port(AudioPort *port);
@@ -46,7 +160,67 @@ protected:
 private:
 	void setup_filter_events();
 
+	/* Run one quantum: resolve buffers, then run_chunks. A host runs its filters from the chunk
+	 * at given offset into the quantum. */
+	void process_quantum(size_t nr_samples, const ProcessClock& clock, size_t offset = 0);
+	/* Run the resolved buffers of a quantum through run_quantum in chunks of at most max_quantum. */
+	void run_chunks(size_t nr_samples, const ProcessClock& clock);
+	/* Feed taps and call the subclass on_process on the resolved buffers. */
+	void run_quantum(size_t nr_samples);
+
+	/* Resolve all port buffers of the current quantum once, into the quantum buffers. */
+	void resolve_buffers(size_t nr_samples);
+	/* Copy aliased inputs into scratch space unless the filter is in-place capable. */
+	void unalias_buffers(size_t nr_samples);
+	/* Fill the process block from the resolved buffers. */
+	void prepare_block(size_t nr_samples);
+	/* Write silence or the input into the outputs instead of running on_process. */
+	void bypass(size_t nr_samples);
+	/* Copy the buffers of the current quantum into the tap attached at given point. */
+	void feed_tap(TapPoint point, const std::vector<float *>& buffers, size_t nr_samples);
+	/* Write the buffers of the current quantum into the reserved capture, starting at given channel. */
+	static void feed_capture(CaptureTap& capture, const std::vector<float *>& buffers,
+			unsigned int first_channel);
+
 	pw_filter *filter = nullptr;
+	Core *core = nullptr;
+
+	/* Set up by init_detached, the ports are then placeholders owned by detached_ports. */
+	bool detached = false;
+	std::vector<std::unique_ptr<AudioPort>> detached_ports;
+
+	/* Host sharing its pw_filter with this filter, if any, and the prefix of the port names. */
+	FilterHost *host = nullptr;
+	std::string port_prefix;
+
+	/* Port buffers of the whole quantum, then of the chunk being run. */
+	std::vector<float *> i_quantum_buffers;
+	std::vector<float *> o_quantum_buffers;
+	std::vector<float *> i_buffers;
+	std::vector<float *> o_buffers;
+	std::vector<std::vector<float>> alias_scratch;
+
+	ProcessBlock block {};
+	std::vector<const float *> block_in;
+	std::vector<float *> block_out;
+	/* Written instead of missing outputs. */
+	std::vector<float> discard;
+	/* Offset of the chunk being run into its quantum. */
+	size_t chunk_offset = 0;
+	/* Frames run by a detached filter so far. */
+	uint64_t detached_position = 0;
+
+	std::atomic<AnalysisTap *> taps[2] = {nullptr, nullptr};
+	std::atomic<CaptureTap *> capture {nullptr};
+	std::atomic<ParamSurface *> param_surface {nullptr};
+
+	std::atomic<bool> silence_detection {false};
+	std::atomic<float> silence_threshold {1e-6F};
+	std::atomic<BypassMode> bypass_mode {BypassMode::Zero};
+	/* Whether the last processed quantum was silent, so silent quanta can be skipped. */
+	bool idle = false;
+	std::atomic<uint64_t> nr_processed_quanta {0};
+	std::atomic<uint64_t> nr_skipped_quanta {0};
 
 	spa_hook filter_listener;
 	FilterEventsUserData feud;
@@ -57,6 +231,20 @@ private:
 };
 
 
+/* Base of filters running one kernel over a whole quantum. Derived implements
+ *   void process(const ProcessBlock& block);
+ * called for every quantum on_process would be, directly rather than through a virtual, so that
+ * it can be inlined into the dispatch. */
+template<typename Derived>
+class BlockFilter : public Filter {
+protected:
+	void on_process(size_t nr_samples) final
+	{
+		static_cast<Derived *>(this)->process(get_process_block());
+	}
+};
+
+
 struct FilterErr : AudioEqErr {
 	FilterErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "filter.h"
+#include "err.h"
+
+#include <vector>
+
+namespace aeq {
+
+/* Filter that hosts many independent filter instances on its single pw_filter.
+ * Each hosted filter adds its ports to the shared pw_filter as its own port group,
+ * named with the given prefix, and is processed from the host's single process callback.
+ * Adding and removing instances allocates only on the calling thread; the new dispatch list
+ * is swapped in on the data thread. The host must outlive the filters it hosts, and a hosted
+ * filter must be removed with remove_filter before it is destroyed: by the time ~Filter runs,
+ * the derived part the data thread calls into is already gone, so ~Filter aborts if still hosted. */
+class FilterHost : public Filter {
+public:
+	FilterHost() = default;
+	~FilterHost();
+
+	/* Initialize given filter on this host's pw_filter with ports named "<name>:<port>". */
+	void add_filter(Filter& filter, const char *name);
+	/* Stop processing given filter and remove its ports. Once it returns the data thread no
+	 * longer runs the filter, so it may be destroyed. */
+	void remove_filter(Filter& filter);
+
+	/* Get number of hosted filters. */
+	size_t get_nr_filters() const;
+protected:
+	void on_process(size_t nr_samples) override;
+private:
+	/* Publish the hosted list as the new dispatch list, sorted so that instances of the same
+	 * type, and thus running the same kernel, are processed back to back. */
+	void publish();
+
+	/* Hosted filters, owned by the control side. */
+	std::vector<Filter *> hosted;
+	/* Dispatch list, only touched by the data thread once the filter is connected. */
+	std::vector<Filter *> dispatch;
+};
+
+struct FilterHostErr : FilterErr {
+	FilterHostErr(FilterErr&& base) : FilterErr(std::move(base)) {}
+};
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "audioeq/filter.h"
+#include "audioeq/dsp/crossover.h"
+
+#include <memory>
+#include <vector>
+
+namespace aeq::filters {
+
+/* Linkwitz-Riley crossover splitting every input channel into 2 to max_bands bands, each band
+ * having its own group of output ports. The bands sum back to an allpass of the input.
+ * All bands and channels are computed together, see dsp::LRCrossover. */
+class CrossoverFilter : public BlockFilter<CrossoverFilter> {
+	friend class BlockFilter<CrossoverFilter>;
+public:
+	static constexpr size_t max_bands = dsp::LRCrossover<float>::max_bands;
+
+	/* freqs are the strictly increasing crossover frequencies, one less than bands. */
+	CrossoverFilter(int sample_rate, unsigned int nr_channels, const std::vector<float>& freqs);
+
+	void core_init(pw_filter *filter) override;
+
+	size_t get_nr_bands() const;
+private:
+	void process(const ProcessBlock& block);
+	bool is_inplace_capable() const noexcept override;
+	void reset_state() noexcept override;
+	bool is_state_below(float threshold) const noexcept override;
+
+	unsigned int nr_channels;
+	size_t nr_bands;
+
+	/* Only one is set, f64 when the lowest crossover needs the precision. */
+	std::unique_ptr<dsp::LRCrossover<float>> crossover_f32;
+	std::unique_ptr<dsp::LRCrossover<double>> crossover_f64;
+};
+
+struct CrossoverFilterErr : FilterErr {
+	CrossoverFilterErr(FilterErr&& base) : FilterErr(std::move(base)) {}
+};
+
+}
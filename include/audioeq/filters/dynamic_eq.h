@@ -0,0 +1,46 @@
+#pragma once
+
+#include "audioeq/filter.h"
+#include "audioeq/dsp/dynamic_eq.h"
+
+#include <memory>
+#include <vector>
+
+namespace aeq::filters {
+
+/* Dynamic equalizer with up to max_bands bell bands whose gain follows the level within the
+ * band, e.g. for de-essing or taming resonances. All bands and channels are computed together,
+ * see dsp::DynamicEq. */
+class DynamicEqFilter : public BlockFilter<DynamicEqFilter> {
+	friend class BlockFilter<DynamicEqFilter>;
+public:
+	static constexpr size_t max_bands = dsp::DynamicEq<float>::max_bands;
+
+	DynamicEqFilter(int sample_rate, unsigned int nr_channels, const std::vector<dsp::DynamicBand>& bands);
+
+	void core_init(pw_filter *filter) override;
+
+	size_t get_nr_bands() const;
+
+	/* "b<band>-freq", "-q", "-threshold", "-ratio", "-range", "-attack" and "-release" of every
+	 * band, in the units of dsp::DynamicBand. */
+	std::vector<ParamInfo> get_params() const override;
+private:
+	void process(const ProcessBlock& block);
+	bool is_inplace_capable() const noexcept override;
+	void reset_state() noexcept override;
+	bool is_state_below(float threshold) const noexcept override;
+	void set_param(size_t index, float value) override;
+
+	unsigned int nr_channels;
+
+	/* Only one is set, f64 when the lowest frequency a band may be set to needs the precision. */
+	std::unique_ptr<dsp::DynamicEq<float>> eq_f32;
+	std::unique_ptr<dsp::DynamicEq<double>> eq_f64;
+};
+
+struct DynamicEqFilterErr : FilterErr {
+	DynamicEqFilterErr(FilterErr&& base) : FilterErr(std::move(base)) {}
+};
+
+}
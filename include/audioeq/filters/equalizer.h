@@ -0,0 +1,77 @@
+#pragma once
+
+#include "audioeq/filter.h"
+#include "audioeq/preset.h"
+#include "audioeq/dsp/biquad.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace aeq::filters {
+
+/* Parametric equalizer: a cascade of up to max_bands biquads per channel.
+ * A new curve (e.g. a whole preset) is prepared off the RT thread and published atomically.
+ * The RT thread then runs the old and the new curve side by side for a short equal-power
+ * crossfade and drops the old one, without allocations or locks. */
+class EqualizerFilter : public BlockFilter<EqualizerFilter> {
+	friend class BlockFilter<EqualizerFilter>;
+public:
+	static constexpr size_t max_bands = 16;
+
+	EqualizerFilter(int sample_rate, unsigned int nr_channels, float crossfade_ms = 20.0F);
+
+	void core_init(pw_filter *filter) override;
+
+	/* Switch to a new curve. Bands beyond max_bands are ignored. */
+	void set_curve(const PresetBand *bands, size_t nr_bands);
+	/* Switch to the curve of a preset. */
+	void load_preset(const Preset& preset);
+
+	/* Set the state precision of the stages of curves set from now on.
+	 * std::nullopt picks per stage with dsp::recommend_precision, which is the default. */
+	void set_state_precision(std::optional<dsp::StatePrecision> precision);
+private:
+	struct Curve {
+		size_t nr_bands = 0;
+		std::array<dsp::BiquadStage, max_bands> stages;
+		/* nr_channels x max_bands */
+		std::vector<dsp::BiquadStageState> states;
+	};
+
+	void process(const ProcessBlock& block);
+	bool is_inplace_capable() const noexcept override;
+	void reset_state() noexcept override;
+	bool is_state_below(float threshold) const noexcept override;
+
+	/* Take the latest published curve, if any. RT side only. */
+	void take_published_curve();
+
+	unsigned int nr_channels;
+	int sample_rate;
+
+	/* Four curves: one being written, one published, the active one and the fading one
+	 * (or a spare while no crossfade is running). Only indices move between the threads. */
+	std::array<Curve, 4> curves;
+	static constexpr int dirty_bit = 4;
+	std::atomic<int> published {2};
+	int writer_curve = 3;
+	int active_curve = 0;
+	int spare_curve = 1;
+	bool fading = false;
+	std::mutex writer_mutex;
+	std::optional<dsp::StatePrecision> state_precision;
+
+	std::vector<float> fade_in_gains;
+	std::vector<float> fade_out_gains;
+	size_t fade_pos = 0;
+	std::vector<float> fade_scratch;
+};
+
+struct EqualizerFilterErr : FilterErr {
+	EqualizerFilterErr(FilterErr&& base) : FilterErr(std::move(base)) {}
+};
+
+}
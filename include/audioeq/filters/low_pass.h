@@ -1,28 +1,44 @@
 #pragma once
 
 #include "audioeq/filter.h"
+#include "audioeq/dsp/coeffs.h"
 
 #include <atomic>
+#include <memory>
+#include <vector>
 
 namespace aeq::filters {
 
-class LowPassFilter : public Filter {
+class LowPassFilter : public BlockFilter<LowPassFilter> {
+	friend class BlockFilter<LowPassFilter>;
 public:
 	LowPassFilter(float cutoff_freq, int sample_rate, unsigned int nr_channels);
 
 	void core_init(pw_filter *filter) override;
 	void set_cutoff_freq(float cutoff_freq);
+
+	/* "cutoff" in Hz. */
+	std::vector<ParamInfo> get_params() const override;
 private:
-	void on_process(size_t nr_samples) override;
-	void single_channel_process(float *in_buf, float *out_buf, size_t nr_samples);
+	void process(const ProcessBlock& block);
+	bool is_inplace_capable() const noexcept override;
+	void reset_state() noexcept override;
+	bool is_state_below(float threshold) const noexcept override;
+	void set_param(size_t index, float value) override;
 
 	int nr_channels;
-	float cuttoff_freq;
+	/* Set by the control side and, through a parameter surface, by the RT thread. */
+	std::atomic<float> cuttoff_freq;
 	int sample_rate;
 
+	/* One-pole coefficients over frequency, shared by all filters of the same sample rate. */
+	std::shared_ptr<const dsp::CoefficientTable> alpha_table;
 	std::atomic<float> alpha;
+	/* Last output sample of each channel, the only state of the filter. */
+	std::vector<float> last_outs;
 
-	static float calc_alpha(float cuttoff_freq, int sample_rate);
+	static std::shared_ptr<const dsp::CoefficientTable> get_alpha_table(int sample_rate);
+	static float calc_alpha(float cuttoff_freq, const dsp::CoefficientTable& alpha_table);
 };
 
 struct LowPassFilterErr : FilterErr {
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "audioeq/filter.h"
+#include "audioeq/dsp/kernels.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace aeq::filters {
+
+/* Matrix mixer: every output is a weighted sum of the inputs, e.g. a downmix, a monitor feed or
+ * bus sends in one node instead of a link per route mixed by the graph.
+ * A new gain matrix is published atomically like the curves of EqualizerFilter, and the RT thread
+ * ramps every gain linearly to it over the smoothing time, so changes don't click. Only nonzero
+ * gains are mixed, a sparse matrix costs as much as its routes. */
+class MatrixMixerFilter : public BlockFilter<MatrixMixerFilter> {
+	friend class BlockFilter<MatrixMixerFilter>;
+public:
+	MatrixMixerFilter(int sample_rate, unsigned int nr_inputs, unsigned int nr_outputs,
+			float smoothing_ms = 10.0F);
+
+	void core_init(pw_filter *filter) override;
+
+	/* Set the gain of input to output, the others keep theirs. */
+	void set_gain(unsigned int output, unsigned int input, float gain);
+	/* Set all gains, nr_outputs rows of nr_inputs gains. */
+	void set_matrix(const std::vector<float>& gains);
+	/* Get the gains set last, which the RT thread may still be ramping to. */
+	std::vector<float> get_matrix() const;
+private:
+	void process(const ProcessBlock& block);
+	bool is_state_below(float threshold) const noexcept override;
+
+	/* Take the latest published matrix, if any, and start ramping to it. RT side only. */
+	void take_published_matrix();
+	/* Rebuild the entries from the current gains and the steps to the target ones. RT side only. */
+	void build_entries(size_t ramp_len);
+
+	unsigned int nr_inputs;
+	unsigned int nr_outputs;
+
+	/* Three matrices: one being written, one published and the target of the RT thread.
+	 * Only indices move between the threads. */
+	std::array<std::vector<float>, 3> matrices;
+	static constexpr int dirty_bit = 4;
+	std::atomic<int> published {1};
+	int writer_matrix = 2;
+	int target_matrix = 0;
+	/* Gains as set by the control side, the writer matrix is copied from it. */
+	std::vector<float> gains;
+	mutable std::mutex writer_mutex;
+
+	/* Gains the RT thread mixes with at the start of the next quantum. */
+	std::vector<float> current_gains;
+	std::vector<dsp::MixEntry> entries;
+	/* nr_outputs + 1 */
+	std::vector<uint32_t> starts;
+	size_t ramp_len;
+	size_t ramp_left = 0;
+};
+
+struct MatrixMixerFilterErr : FilterErr {
+	MatrixMixerFilterErr(FilterErr&& base) : FilterErr(std::move(base)) {}
+};
+
+}
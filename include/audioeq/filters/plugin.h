@@ -0,0 +1,71 @@
+#pragma once
+
+#include "audioeq/filter.h"
+#include "audioeq/plugin_stage.h"
+#include "audioeq/utils/spsc_ring.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace aeq::filters {
+
+/* Filter running a DSP stage from a plugin module, which can be upgraded while running.
+ * A new stage is loaded and prepared off the RT thread and published atomically. The RT thread
+ * then runs the old and the new stage side by side for a short equal-gain crossfade and hands
+ * the old one back to be unloaded off the RT thread. The pw_filter, its ports and its links stay
+ * as they are, so an upgrade neither renegotiates the graph nor drops out.
+ * Passes the input through until the first stage is loaded. */
+class PluginFilter : public BlockFilter<PluginFilter> {
+	friend class BlockFilter<PluginFilter>;
+public:
+	PluginFilter(int sample_rate, unsigned int nr_channels, float crossfade_ms = 20.0F);
+	~PluginFilter();
+
+	void core_init(pw_filter *filter) override;
+
+	/* Load a stage from a plugin module and swap it in. A stage loaded earlier that the RT
+	 * thread didn't take yet is dropped. Not RT-safe. */
+	void load(const char *path);
+
+	/* Get number of swaps whose crossfade completed. */
+	uint64_t get_nr_swaps() const;
+private:
+	void process(const ProcessBlock& block);
+	void reset_state() noexcept override;
+
+	/* Take the latest loaded stage, if any. RT side only. */
+	void take_pending_stage();
+	/* Run a stage, or pass through without one. */
+	void run_stage(PluginStage *stage, const float *const *in, float *const *out, size_t nr_samples);
+	/* Hand a stage back to the control side to be unloaded. RT side only. */
+	void retire(PluginStage *stage);
+	/* Unload the stages handed back. Control side only. */
+	void collect_retired();
+
+	unsigned int nr_channels;
+	int sample_rate;
+
+	std::mutex loader_mutex;
+	std::atomic<PluginStage *> pending {nullptr};
+	/* Only touched by the RT thread. */
+	PluginStage *active = nullptr;
+	PluginStage *fading = nullptr;
+	bool is_fading = false;
+	utils::SPSCBlockRing<PluginStage *> retired;
+	std::atomic<uint64_t> nr_swaps {0};
+
+	std::vector<float> fade_in_gains;
+	std::vector<float> fade_out_gains;
+	size_t fade_pos = 0;
+
+	/* Output of the fading stage, max_quantum per channel. */
+	std::vector<float> scratch;
+	std::vector<float *> fade_bufs;
+};
+
+struct PluginFilterErr : FilterErr {
+	PluginFilterErr(FilterErr&& base) : FilterErr(std::move(base)) {}
+};
+
+}
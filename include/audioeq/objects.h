@@ -5,11 +5,13 @@
 #include <vector>
 #include <algorithm>
 
+#include "utils/string_pool.h"
+
 namespace aeq {
 
 /* Base wrapper class for pipewire objects. */
 class Object {
-	friend class Core;
+	friend class RegistryModel;
 public:
 	Object(const Object&) = delete;
 	Object& operator=(const Object&) = delete;
@@ -44,7 +46,7 @@ class Port;
 
 /* Node wrapper. Stores its input and output ports. */
 class Node : public Object {
-	friend class Core;
+	friend class RegistryModel;
 public:
 	/* Get input port at given index. */
 	Port& get_i_port(int index) const;
@@ -58,10 +60,15 @@ public:
 
 	const std::string& get_name() const;
 	const std::string& get_descripiton() const;
+	/* Name handle, equal for nodes of equal names from the same Core. */
+	utils::InternedString get_interned_name() const;
+	/* Media class, e.g. "Audio/Sink" or "Stream/Output/Audio". Empty if not set. */
+	const std::string& get_media_class() const;
 
 protected:
-	Node(Object&& object, std::string_view name, std::string_view description = "")
-		: Object(std::move(object)), name(name), description(description) {}
+	Node(Object&& object, utils::InternedString name, utils::InternedString description = {},
+			utils::InternedString media_class = {})
+		: Object(std::move(object)), name(name), description(description), media_class(media_class) {}
 
 	void add_port(Port& port);
 	void rem_port(Port& port);
@@ -69,15 +76,16 @@ protected:
 	std::vector<Port *> i_ports;
 	std::vector<Port *> o_ports;
 private:
-	std::string name;
-	std::string description;
+	utils::InternedString name;
+	utils::InternedString description;
+	utils::InternedString media_class;
 };
 
 enum class PortDirection { Input, Output };
 
 /* Port wrapper. Stores its direction, owner and the linked ports. */
 class Port : public Object {
-	friend class Core;
+	friend class RegistryModel;
 	using LinkedPortIt = std::vector<ID_Ptr<Port>>::iterator;
 public:
 	/* Get ID of a linked port at given index. */
@@ -88,6 +96,8 @@ public:
 	size_t get_nr_linked_ports() const;
 
 	const std::string& get_name() const;
+	/* Name handle, equal for ports of equal names from the same Core. */
+	utils::InternedString get_interned_name() const;
 	PortDirection get_direction() const;
 
 	/* Get ID of its Node owner. */
@@ -95,7 +105,7 @@ public:
 	/* Get pointer to its Node owner. */
 	Node *get_owner() const;
 private:
-	Port(Object&& object, std::string_view name, PortDirection direction)
+	Port(Object&& object, utils::InternedString name, PortDirection direction)
 		: Object(std::move(object)), name(name), direction(direction) {}
 
 	void link_to(Port& other);
@@ -110,7 +120,7 @@ private:
 	void set_owner(Node& owner);
 	void unown();
 
-	std::string name;
+	utils::InternedString name;
 	PortDirection direction;
 
 	ID_Ptr<Node> owner;
@@ -146,12 +156,22 @@ inline size_t Node::get_nr_o_ports() const
 
 inline const std::string& Node::get_name() const
 {
-	return name;
+	return name.get();
 }
 
 inline const std::string& Node::get_descripiton() const
 {
-	return description;
+	return description.get();
+}
+
+inline utils::InternedString Node::get_interned_name() const
+{
+	return name;
+}
+
+inline const std::string& Node::get_media_class() const
+{
+	return media_class.get();
 }
 
 
@@ -171,6 +191,11 @@ inline size_t Port::get_nr_linked_ports() const
 }
 
 inline const std::string& Port::get_name() const
+{
+	return name.get();
+}
+
+inline utils::InternedString Port::get_interned_name() const
 {
 	return name;
 }
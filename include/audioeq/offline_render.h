@@ -0,0 +1,69 @@
+#pragma once
+
+#include "err.h"
+#include "preset.h"
+#include "dsp/biquad.h"
+#include "utils/thread_pool.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace aeq {
+
+/* Renders an EQ curve over whole signals held in memory, e.g. long archives being mastered,
+ * using all cores. The curve runs with f64 state, independent of any pipewire graph.
+ *
+ * A signal is split into chunks of chunk_size samples, rendered in three passes:
+ *  1. in parallel, every chunk from zero state, keeping the state it ends in;
+ *  2. serially, the true state at the start of every chunk. The curve is linear, so it is the
+ *     start state of the previous chunk carried over the chunk by the transition matrix of the
+ *     curve raised to chunk_size, plus the end state of the previous chunk from pass 1;
+ *  3. in parallel, the response to its true start state added into every chunk. It decays
+ *     like the impulse response, so it stops once the state is below decay_threshold.
+ * The output stays within one float rounding of render_serial where the correction ran, and
+ * within decay_threshold times the gain of the curve past it.
+ * This class is not intended to be movable/copiable. */
+class OfflineRenderer {
+public:
+	static constexpr size_t default_chunk_size = 1 << 18;
+	static constexpr double decay_threshold = 1e-15;
+
+	/* nr_threads counts the calling thread, 0 picks the number of hardware threads. */
+	OfflineRenderer(const PresetBand *bands, size_t nr_bands, int sample_rate,
+			size_t nr_threads = 0, size_t chunk_size = default_chunk_size);
+
+	OfflineRenderer(const OfflineRenderer&) = delete;
+	OfflineRenderer& operator=(const OfflineRenderer&) = delete;
+	OfflineRenderer(OfflineRenderer&&) = delete;
+	OfflineRenderer& operator=(OfflineRenderer&&) = delete;
+
+	/* Render nr_channels signals of nr_frames samples each. in and out may alias. */
+	void render(const float *const *in, float *const *out, unsigned int nr_channels, size_t nr_frames);
+	/* Render on the calling thread in one pass, the reference of render. */
+	void render_serial(const float *const *in, float *const *out, unsigned int nr_channels,
+			size_t nr_frames) const;
+
+	size_t get_nr_threads() const;
+	size_t get_chunk_size() const;
+private:
+	/* Run the curve from given state, which is updated. in and out may alias, in nullptr is
+	 * silence and then the response is added into out. */
+	void run(dsp::BiquadState<double> *state, const float *in, float *out, size_t nr_samples) const;
+	/* Add the response to a start state into out until it decays. */
+	void add_state_response(dsp::BiquadState<double> *state, float *out, size_t nr_samples) const;
+
+	size_t get_state_size() const;
+
+	std::vector<dsp::Biquad<double>> stages;
+	size_t chunk_size;
+	/* Transition matrix of the curve over chunk_size silent samples, state size squared. */
+	std::vector<double> chunk_transition;
+
+	utils::ThreadPool pool;
+};
+
+struct OfflineRenderErr : AudioEqErr {
+	OfflineRenderErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "err.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aeq {
+
+class Filter;
+
+/* Description of a filter parameter settable through a ParamSurface. */
+struct ParamInfo {
+	std::string name;
+	float min;
+	float max;
+	/* Value at the time the surface is created. */
+	float def;
+};
+
+/* Layout of a parameter surface segment shared between processes. Holds only plain data and
+ * lock-free atomics of plain types, so every process of the architecture sees the same layout.
+ * Any change of it bumps layout_version. */
+struct ParamSurfaceLayout {
+	static constexpr uint32_t magic_value = 0x50514541; // "AEQP"
+	static constexpr uint32_t layout_version = 1;
+	static constexpr size_t max_params = 64;
+	static constexpr size_t max_meters = 64;
+	static constexpr size_t name_size = 32;
+
+	struct Param {
+		char name[name_size];
+		float min;
+		float max;
+		float def;
+	};
+
+	/* Written once before the segment is shared. */
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nr_params;
+	uint32_t nr_input_meters;
+	uint32_t nr_output_meters;
+	Param params[max_params];
+
+	/* Seqlock of values, odd while a writer updates them. */
+	alignas(64) std::atomic<uint32_t> params_seq;
+	std::atomic<float> values[max_params];
+
+	/* Seqlock of meters, written by the RT thread once per quantum. */
+	alignas(64) std::atomic<uint32_t> meters_seq;
+	/* Peak of every input port over the last quantum, then of every output port. */
+	std::atomic<float> meters[max_meters];
+
+	alignas(64) std::atomic<uint64_t> nr_processed_quanta;
+	std::atomic<uint64_t> nr_skipped_quanta;
+	std::atomic<uint64_t> nr_param_updates;
+	/* Quanta that found a writer in the middle of an update and left it for the next quantum. */
+	std::atomic<uint64_t> nr_torn_reads;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free
+		&& std::atomic<float>::is_always_lock_free, "Shared atomics must be lock-free.");
+
+/* Parameters, port meters and stats of a filter in a shared memory segment, so that UI and
+ * automation processes control the filter with plain loads and stores, no syscall per update.
+ * Parameter writes are published by a seqlock: a writer makes the sequence odd, stores the values
+ * and makes it even again, writers serializing on the sequence. Once per quantum the RT thread
+ * takes the values if the sequence is even and the same before and after its copy, otherwise it
+ * tries again at the next quantum, so it never waits for a writer. Meters are published the same
+ * way the other direction.
+ * The segment is a POSIX shared memory object of given name, or an anonymous sealed memfd handed
+ * to other processes by its file descriptor. Values read from it are clamped to the ranges of the
+ * parameters, as other processes are not trusted to respect them.
+ * Attach it with Filter::attach_param_surface. This class is not intended to be movable/copiable. */
+class ParamSurface {
+public:
+	/* Create a surface for the parameters and ports of an initialized filter. shm_name is like
+	 * "/audioeq-eq", nullptr creates a memfd. */
+	explicit ParamSurface(const Filter& filter, const char *shm_name = nullptr);
+	~ParamSurface();
+
+	ParamSurface(const ParamSurface&) = delete;
+	ParamSurface& operator=(const ParamSurface&) = delete;
+	ParamSurface(ParamSurface&&) = delete;
+	ParamSurface& operator=(ParamSurface&&) = delete;
+
+	int get_fd() const;
+	/* Name of the shared memory object, empty for a memfd. */
+	const std::string& get_name() const;
+	size_t get_nr_params() const;
+
+	/* Take the parameters written since the last poll. Returns the mask of the changed ones,
+	 * whose values are then read with get_value. RT side only, RT-safe. */
+	uint64_t poll();
+	float get_value(size_t index) const;
+
+	/* Measure the input peaks of a quantum before processing may overwrite the inputs in place,
+	 * then publish them with the output peaks. RT side only, RT-safe. */
+	void measure_inputs(const std::vector<float *>& inputs, size_t nr_samples);
+	void publish_meters(const std::vector<float *>& outputs, size_t nr_samples);
+	void publish_stats(uint64_t nr_processed_quanta, uint64_t nr_skipped_quanta);
+private:
+	int fd = -1;
+	std::string name;
+	ParamSurfaceLayout *layout = nullptr;
+
+	/* Counts and ranges as created. The segment is writable by other processes, so the RT side
+	 * never takes them from there. */
+	size_t nr_params = 0;
+	size_t nr_input_meters = 0;
+	size_t nr_output_meters = 0;
+	float mins[ParamSurfaceLayout::max_params] = {};
+	float maxs[ParamSurfaceLayout::max_params] = {};
+
+	/* RT side copy of the parameters and the sequence it was taken at. */
+	uint32_t last_seq = 0;
+	float values[ParamSurfaceLayout::max_params] = {};
+	/* Input peaks, then output peaks of the current quantum. */
+	float peaks[ParamSurfaceLayout::max_meters] = {};
+};
+
+/* Counters of a surface, see ParamSurfaceLayout. */
+struct ParamSurfaceStats {
+	uint64_t nr_processed_quanta;
+	uint64_t nr_skipped_quanta;
+	uint64_t nr_param_updates;
+	uint64_t nr_torn_reads;
+};
+
+/* Control side of a ParamSurface, in any process. This class is not intended to be movable/copiable. */
+class ParamSurfaceClient {
+public:
+	/* Open a surface by the name of its shared memory object. */
+	explicit ParamSurfaceClient(const char *shm_name);
+	/* Map a surface from a file descriptor, e.g. a memfd passed over a unix socket. The
+	 * descriptor is duplicated, the caller keeps its own. */
+	explicit ParamSurfaceClient(int fd);
+	~ParamSurfaceClient();
+
+	ParamSurfaceClient(const ParamSurfaceClient&) = delete;
+	ParamSurfaceClient& operator=(const ParamSurfaceClient&) = delete;
+	ParamSurfaceClient(ParamSurfaceClient&&) = delete;
+	ParamSurfaceClient& operator=(ParamSurfaceClient&&) = delete;
+
+	size_t get_nr_params() const;
+	const ParamSurfaceLayout::Param& get_param_info(size_t index) const;
+	/* Find a parameter by name, returns false if there is none. */
+	bool find_param(std::string_view name, size_t& index) const;
+
+	/* Set parameters together, the RT thread takes all of them in the same quantum. Values are
+	 * clamped to the ranges of the parameters. */
+	void set_params(const size_t *indices, const float *values, size_t nr_values);
+	void set_param(size_t index, float value);
+	float get_param(size_t index) const;
+
+	/* Peaks of the input and output ports over the last processed quantum. */
+	void read_meters(std::vector<float>& input_peaks, std::vector<float>& output_peaks) const;
+	ParamSurfaceStats get_stats() const;
+private:
+	void map(int fd);
+
+	int fd = -1;
+	ParamSurfaceLayout *layout = nullptr;
+};
+
+struct ParamSurfaceErr : AudioEqErr {
+	ParamSurfaceErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
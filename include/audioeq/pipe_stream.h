@@ -0,0 +1,57 @@
+#pragma once
+
+#include "err.h"
+#include "filter.h"
+#include "dsp/pcm.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aeq {
+
+/* Streams raw interleaved PCM from one file descriptor through a detached filter into another,
+ * e.g. stdin to stdout in a shell pipeline. Whatever whole frames a read returns, up to
+ * nr_frames, are converted to float, processed in quanta of at most Filter::max_quantum and
+ * converted back in the same buffer. Pipes on either side are enlarged to pipe_size.
+ * This class is not intended to be movable/copiable. */
+class PipeStream {
+public:
+	static constexpr size_t default_nr_frames = 1 << 16;
+	static constexpr int pipe_size = 1 << 20;
+
+	/* filter must be detached, with nr_channels input and output ports. */
+	PipeStream(Filter& filter, dsp::PcmFormat format, unsigned int nr_channels,
+			size_t nr_frames = default_nr_frames);
+
+	PipeStream(const PipeStream&) = delete;
+	PipeStream& operator=(const PipeStream&) = delete;
+	PipeStream(PipeStream&&) = delete;
+	PipeStream& operator=(PipeStream&&) = delete;
+
+	/* Stream until end of input, a trailing partial frame is dropped. Returns the number of
+	 * frames streamed. */
+	uint64_t run(int in_fd, int out_fd);
+private:
+	/* Read at least min_size bytes unless input ends first, at most buf.size() - filled. */
+	size_t read_some(int fd, size_t filled, size_t min_size);
+	void write_all(int fd, const uint8_t *data, size_t size);
+	void process(size_t nr_frames);
+
+	Filter& filter;
+	dsp::PcmFormat format;
+	unsigned int nr_channels;
+	size_t nr_frames;
+	size_t frame_size;
+
+	std::vector<uint8_t> buf;
+	/* nr_channels x nr_frames */
+	std::vector<std::vector<float>> channels;
+	std::vector<float *> channel_ptrs;
+};
+
+struct PipeStreamErr : AudioEqErr {
+	PipeStreamErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
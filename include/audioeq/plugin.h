@@ -0,0 +1,38 @@
+#pragma once
+
+/* C ABI of DSP stage plugin modules, loaded by aeq::PluginStage.
+ * A module is a shared object exporting AEQ_PLUGIN_ENTRY, an aeq_plugin_stage_func returning the
+ * descriptor of its stage. Only plain C here, so that modules build with any compiler against
+ * nothing but this header. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AEQ_PLUGIN_ABI_VERSION 1
+#define AEQ_PLUGIN_ENTRY "aeq_plugin_stage"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct aeq_plugin_stage {
+	/* AEQ_PLUGIN_ABI_VERSION the module was built against. */
+	uint32_t abi_version;
+	const char *name;
+	/* Create an instance processing nr_channels channels in quanta of up to max_quantum samples,
+	 * allocating all it needs. Returns NULL on failure. Called off the RT thread. */
+	void *(*create)(int sample_rate, unsigned int nr_channels, size_t max_quantum);
+	/* Called off the RT thread. */
+	void (*destroy)(void *instance);
+	/* Process one quantum, one buffer per channel. in and out never alias. Called on the RT
+	 * thread, so it must not block, allocate or make syscalls. */
+	void (*process)(void *instance, const float *const *in, float *const *out, size_t nr_samples);
+	/* Clear the DSP state. Called on the RT thread. */
+	void (*reset)(void *instance);
+};
+
+typedef const struct aeq_plugin_stage *(*aeq_plugin_stage_func)(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "plugin.h"
+#include "err.h"
+
+#include <cstddef>
+
+namespace aeq {
+
+/* Instance of a DSP stage from a plugin module, see audioeq/plugin.h.
+ * The module is loaded from a private copy, so that a module rebuilt over the same path is new
+ * code to the dynamic linker even while the previous version is still loaded and running, and
+ * versions of a module don't share globals. The stage is prepared completely on construction,
+ * including one silent quantum that faults its code and data in, so that its first quantum on
+ * the RT thread is as fast as the following ones.
+ * This class is not intended to be movable/copiable. */
+class PluginStage {
+public:
+	PluginStage(const char *path, int sample_rate, unsigned int nr_channels, size_t max_quantum);
+	~PluginStage();
+
+	PluginStage(const PluginStage&) = delete;
+	PluginStage& operator=(const PluginStage&) = delete;
+	PluginStage(PluginStage&&) = delete;
+	PluginStage& operator=(PluginStage&&) = delete;
+
+	/* RT-safe as far as the module keeps its contract. in and out must not alias. */
+	inline void process(const float *const *in, float *const *out, size_t nr_samples)
+	{
+		desc->process(instance, in, out, nr_samples);
+	}
+	inline void reset()
+	{
+		desc->reset(instance);
+	}
+
+	const char *get_name() const;
+private:
+	// the copy stays open as long as the module is loaded, the dynamic linker tells modules apart
+	// by path and the path of an open copy is taken by no other
+	int copy_fd = -1;
+	void *handle = nullptr;
+	const aeq_plugin_stage *desc = nullptr;
+	void *instance = nullptr;
+};
+
+struct PluginStageErr : AudioEqErr {
+	PluginStageErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "err.h"
+#include "dsp/coeffs.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace aeq {
+
+/* One band of a preset, laid out exactly as stored in a preset file. */
+struct PresetBand {
+	uint32_t type;	// dsp::FilterType
+	float freq;
+	float q;
+	float gain_db;
+};
+
+/* View of a preset inside a mapped preset store. */
+struct Preset {
+	std::string_view name;
+	const PresetBand *bands;
+	size_t nr_bands;
+};
+
+/* Read-only store of presets memory-mapped from a compact binary file.
+ * Opening validates the layout and indexes the names, bands are never copied.
+ * File layout (native endianness):
+ *	header:  "AEQP", u32 version, u32 nr_presets, u32 nr_bands
+ *	entries: nr_presets x { char name[48], u32 first_band, u32 nr_bands }
+ *	bands:   nr_bands x PresetBand
+ * This class is not intended to be copiable. */
+class PresetStore {
+public:
+	struct PresetDesc {
+		std::string name;
+		std::vector<PresetBand> bands;
+	};
+
+	static constexpr uint32_t version = 1;
+	static constexpr size_t max_name_len = 47;
+
+	explicit PresetStore(const char *path);
+	~PresetStore();
+
+	PresetStore(const PresetStore&) = delete;
+	PresetStore& operator=(const PresetStore&) = delete;
+	PresetStore(PresetStore&&) = delete;
+	PresetStore& operator=(PresetStore&&) = delete;
+
+	/* Get number of presets. */
+	size_t get_nr_presets() const;
+	/* Get preset at given index. */
+	Preset get_preset(size_t index) const;
+	/* Find preset by name. Returns false if there is none. */
+	bool find_preset(std::string_view name, Preset& preset) const;
+
+	/* Write presets into a new preset file. */
+	static void save(const char *path, const std::vector<PresetDesc>& presets);
+private:
+	struct FileHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t nr_presets;
+		uint32_t nr_bands;
+	};
+
+	struct FileEntry {
+		char name[max_name_len + 1];
+		uint32_t first_band;
+		uint32_t nr_bands;
+	};
+
+	void *map = nullptr;
+	size_t map_size = 0;
+
+	const FileEntry *entries = nullptr;
+	const PresetBand *bands = nullptr;
+	size_t nr_presets = 0;
+
+	std::unordered_map<std::string_view, size_t> name_index;
+};
+
+struct PresetErr : AudioEqErr {
+	PresetErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
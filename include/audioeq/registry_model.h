@@ -0,0 +1,170 @@
+#pragma once
+
+#include <spa/utils/dict.h>
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "objects.h"
+#include "utils/string_pool.h"
+
+namespace aeq {
+
+/* Wrappers of the nodes, ports and links of a pipewire registry, built from its global and
+ * global_remove events. Events may come in any order: ports may appear before their node and
+ * links before their ports, the model reconciles them once the missing objects appear.
+ * Everything kept for an object, including what waits for missing objects, is reclaimed when
+ * the object is removed, so memory follows the live graph however long the session churns.
+ * Independent of a live daemon, so it can be driven by recorded or synthetic events.
+ * Not thread-safe, Core drives it from its loop thread.
+ * This class is not intended to be movable/copiable. */
+class RegistryModel {
+	struct LinkInfo {
+		uint32_t i_port_id;
+		uint32_t o_port_id;
+	};
+
+	struct RegistryObjects {
+		std::unordered_map<uint32_t, std::unique_ptr<Node>> nodes;
+		std::unordered_map<uint32_t, std::unique_ptr<Port>> ports;
+
+		std::unordered_map<uint32_t, LinkInfo> links;
+
+		std::unordered_map<uint32_t, std::vector<Port *>>   nodeless_ports;
+		std::unordered_map<uint32_t, std::vector<LinkInfo>> portless_links;
+	};
+
+	struct PortKey {
+		uint32_t owner_id;
+		utils::InternedString name;
+		PortDirection direction;
+
+		bool operator==(const PortKey& other) const
+		{
+			return owner_id == other.owner_id && name == other.name && direction == other.direction;
+		}
+	};
+
+	struct PortKeyHash {
+		size_t operator()(const PortKey& key) const
+		{
+			return (size_t(key.owner_id) * 0x9e3779b97f4a7c15ULL) ^ key.name.hash()
+				^ static_cast<size_t>(key.direction);
+		}
+	};
+
+	/* Secondary indices kept up to date with registry_objects. Names are interned, so the keys
+	 * hash and compare by identity. */
+	struct Indices {
+		/* Names and media classes are not unique, the nodes sharing one are in arrival order. */
+		std::unordered_map<utils::InternedString, std::vector<Node *>> nodes_by_name;
+		std::unordered_map<utils::InternedString, std::unordered_set<Node *>> nodes_by_media_class;
+		/* Ports by the id of their owner, indexed even before the owner node appears. */
+		std::unordered_map<PortKey, Port *, PortKeyHash> ports_by_key;
+	};
+public:
+	RegistryModel() = default;
+
+	RegistryModel(const RegistryModel&) = delete;
+	RegistryModel& operator=(const RegistryModel&) = delete;
+	RegistryModel(RegistryModel&&) = delete;
+	RegistryModel& operator=(RegistryModel&&) = delete;
+
+	/* Handle a new global object. Types other than nodes, ports and links are ignored. */
+	void on_global(uint32_t id, const char *type, const spa_dict *props);
+	/* Handle removal of a global object. Unknown ids are ignored. */
+	void on_global_remove(uint32_t id);
+
+	/* List all currently available nodes. */
+	void list_nodes(std::vector<Node *>& nodes) const;
+
+	/* Find node with given id. */
+	Node *find_node(uint32_t id) const;
+	/* Find the first node, in arrival order, with given name. */
+	Node *find_node_by_name(std::string_view name) const;
+	/* Find port with given id. */
+	Port *find_port(uint32_t id) const;
+	/* Find port of a node by its name and direction. */
+	Port *find_port(uint32_t node_id, std::string_view name, PortDirection direction) const;
+
+	/* Call f(Node&) for every node. */
+	template<typename F>
+	void for_each_node(F&& f) const;
+	/* Call f(Node&) for every node with given name. */
+	template<typename F>
+	void for_each_node_with_name(std::string_view name, F&& f) const;
+	/* Call f(Node&) for every node of given media class. */
+	template<typename F>
+	void for_each_node_of_class(std::string_view media_class, F&& f) const;
+
+	size_t get_nr_nodes() const;
+	size_t get_nr_ports() const;
+	size_t get_nr_links() const;
+private:
+	void wrap_node(uint32_t id, const spa_dict *props);
+	void wrap_port(uint32_t id, const spa_dict *props);
+	void wrap_link(uint32_t id, const spa_dict *props);
+
+	bool try_unwrap_node(uint32_t id);
+	bool try_unwrap_port(uint32_t id);
+	bool try_unwrap_link(uint32_t id);
+
+	void index_node(Node& node);
+	void unindex_node(Node& node);
+	void index_port(Port& port);
+	void unindex_port(Port& port);
+
+	/* Drop a removed port from the nodeless ports of its owner id. */
+	void forget_nodeless_port(Port& port);
+	/* Drop a removed link from the links waiting for given port id. */
+	void forget_portless_link(uint32_t port_id, const LinkInfo& link);
+
+	/* Release the names of an object being removed. */
+	void release_names(Node& node);
+	void release_names(Port& port);
+
+	/* Node and port names repeat a lot across a graph, they are stored once here and released
+	 * with the last object using them, so unique names of short-lived clients don't pile up. */
+	utils::StringPool names;
+	RegistryObjects registry_objects;
+	Indices indices;
+};
+
+
+template<typename F>
+void RegistryModel::for_each_node(F&& f) const
+{
+	for (const auto& id_node : registry_objects.nodes)
+		f(*id_node.second);
+}
+
+template<typename F>
+void RegistryModel::for_each_node_with_name(std::string_view name, F&& f) const
+{
+	utils::InternedString interned;
+	if (!names.find(name, interned))
+		return;
+	auto found_it = indices.nodes_by_name.find(interned);
+	if (found_it == indices.nodes_by_name.end())
+		return;
+	for (Node *node : found_it->second)
+		f(*node);
+}
+
+template<typename F>
+void RegistryModel::for_each_node_of_class(std::string_view media_class, F&& f) const
+{
+	utils::InternedString interned;
+	if (!names.find(media_class, interned))
+		return;
+	auto found_it = indices.nodes_by_media_class.find(interned);
+	if (found_it == indices.nodes_by_media_class.end())
+		return;
+	for (Node *node : found_it->second)
+		f(*node);
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <spa/utils/dict.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "err.h"
+#include "registry_model.h"
+
+namespace aeq {
+
+/* A stream of registry global and global_remove events, recorded from a live session
+ * (see Core::set_recording) or built synthetically, which can be saved, loaded and
+ * replayed into a RegistryModel.
+ * File layout (native endianness):
+ *	header: "AEQR", u32 version, u32 nr_events
+ *	events: nr_events x { u8 kind, u32 id, str type, u32 nr_props, nr_props x { str key, str value } }
+ *	str:    u32 size, size x char
+ * Removals carry an empty type and no props. */
+class RegistryRecording {
+public:
+	struct Event {
+		enum class Kind : uint8_t { Global, GlobalRemove };
+
+		Kind kind;
+		uint32_t id;
+		std::string type;
+		std::vector<std::pair<std::string, std::string>> props;
+	};
+
+	static constexpr uint32_t version = 1;
+
+	RegistryRecording() = default;
+	/* Load a recording from a file. */
+	explicit RegistryRecording(const char *path);
+
+	void record_global(uint32_t id, const char *type, const spa_dict *props);
+	void record_global_remove(uint32_t id);
+
+	/* Feed all events, in recorded order, into the model. */
+	void replay(RegistryModel& model) const;
+
+	void save(const char *path) const;
+	void clear();
+
+	size_t get_nr_events() const;
+	const Event& get_event(size_t index) const;
+private:
+	std::vector<Event> events;
+};
+
+struct RegistryRecordingErr : AudioEqErr {
+	RegistryRecordingErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace aeq {
+
+/* Automatic routing rule: the output ports of every node matching it are linked to the input
+ * ports of the target node of the same channel suffix, like "output_FL" to "playback_FL".
+ * If some output has no input of its channel, the i-th output is linked to the i-th input. */
+struct RoutingRule {
+	/* Nodes whose name starts with this prefix match, empty matches any name. */
+	std::string node_name_prefix;
+	/* Nodes of exactly this media class match, empty matches any media class. */
+	std::string media_class;
+	/* Name of the node whose inputs matching nodes get linked to. */
+	std::string target_node_name;
+};
+
+/* A set of routing rules compiled for matching nodes as they appear.
+ * Rules are indexed by their name prefix in a trie and by their media class in a hash table,
+ * so a node is only checked against the rules that can match it, not against all of them. */
+class RoutingRules {
+public:
+	RoutingRules() = default;
+	explicit RoutingRules(std::vector<RoutingRule> rules);
+
+	/* Append the indices of the rules matching a node, in ascending order. */
+	void match(std::string_view node_name, std::string_view media_class, std::vector<size_t>& matched) const;
+	/* Get the indices of the rules targeting a node of given name, nullptr if there are none. */
+	const std::vector<size_t> *find_targeting(const std::string& node_name) const;
+
+	const RoutingRule& get_rule(size_t index) const;
+	size_t get_nr_rules() const;
+	const std::vector<RoutingRule>& get_rules() const;
+private:
+	struct TrieNode {
+		/* (character, node index), sorted by character. */
+		std::vector<std::pair<char, uint32_t>> children;
+		/* Rules whose whole prefix ends at this node. */
+		std::vector<size_t> rules;
+	};
+
+	void add_to_trie(std::string_view prefix, size_t rule);
+
+	std::vector<RoutingRule> rules;
+
+	/* Rules with a name prefix, media class is checked after the prefix matched. */
+	std::vector<TrieNode> trie;
+	/* Rules with a media class and no name prefix. */
+	std::unordered_map<std::string, std::vector<size_t>> by_media_class;
+	/* Rules matching every node. */
+	std::vector<size_t> match_all;
+
+	std::unordered_map<std::string, std::vector<size_t>> by_target;
+};
+
+}
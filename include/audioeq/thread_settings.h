@@ -0,0 +1,56 @@
+#pragma once
+
+#include "err.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace aeq {
+
+/* Threads the library spawns, by what they do. */
+enum class ThreadRole : uint8_t {
+	/* Loop thread of Core, handling the registry, links and routing. */
+	Control,
+	/* Workers of utils::ThreadPool, e.g. of offline rendering. */
+	Worker,
+	/* Thread of an AnalysisTap. */
+	Analysis,
+	/* Writer thread of a CaptureTap. */
+	Capture,
+};
+
+/* Scheduling of a thread. The PipeWire data thread isn't the library's, its priority and
+ * affinity come from the PipeWire configuration. */
+struct ThreadSettings {
+	/* CPUs the thread may run on, any if empty. */
+	std::vector<unsigned int> cpus;
+	/* SCHED_FIFO priority from 1 to 99, 0 keeps the default policy. */
+	int fifo_priority = 0;
+	/* Bytes of stack touched at start, below the stack size of the thread, so that with memory
+	 * locked (see lock_memory) the thread doesn't fault growing its stack later. */
+	size_t prefault_stack_size = 0;
+};
+
+/* Set the settings threads of a role start with from now on, threads running keep theirs.
+ * Set them before creating the objects spawning the threads, e.g. Core. */
+void set_thread_settings(ThreadRole role, const ThreadSettings& settings);
+ThreadSettings get_thread_settings(ThreadRole role);
+
+/* Apply settings to the calling thread. Returns 0, or the errno of the first setting that
+ * failed, the others are applied regardless. */
+int apply_thread_settings(const ThreadSettings& settings) noexcept;
+/* Apply the settings of a role to the calling thread, which every thread the library spawns
+ * does first. A failure doesn't stop the thread, get_thread_settings_error reports it. */
+void apply_thread_settings(ThreadRole role) noexcept;
+/* errno of the last failure to apply the settings of a role, 0 if none failed. */
+int get_thread_settings_error(ThreadRole role);
+
+/* Lock all current and future pages of the process in memory. */
+void lock_memory();
+
+struct ThreadSettingsErr : AudioEqErr {
+	ThreadSettingsErr(AudioEqErr&& base) : AudioEqErr(std::move(base)) {}
+};
+
+}
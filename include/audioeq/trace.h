@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace aeq::trace {
+
+/* Low overhead timeline tracing of begin/end events.
+ * Each thread writes into its own preallocated ring of the latest events, without locks or
+ * allocations, so tracing is usable from the RT thread. Event names must be string literals or
+ * otherwise outlive the trace. Dumps are Chrome trace JSON, which Perfetto also opens. */
+
+enum class Phase : char {
+	Begin = 'B',
+	End = 'E',
+	Instant = 'i',
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+/* Enable or disable tracing. The per-thread rings are allocated on first enable. */
+void enable(bool enabled);
+
+inline bool is_enabled() noexcept
+{
+	return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/* Record an event on the calling thread's ring. Threads beyond the preallocated rings are dropped. */
+void emit(const char *name, Phase phase) noexcept;
+
+/* Write all recorded events as Chrome trace JSON. Best taken with tracing disabled,
+ * otherwise the oldest events of busy threads may be overwritten while being read. */
+void dump_chrome_json(std::ostream& os);
+
+/* Forget all recorded events. Only call with tracing disabled. */
+void clear();
+
+/* Emits a begin event on construction and the matching end event on destruction. */
+class Scope {
+public:
+	explicit Scope(const char *name) noexcept : name(is_enabled() ? name : nullptr)
+	{
+		if (this->name)
+			emit(this->name, Phase::Begin);
+	}
+
+	~Scope()
+	{
+		if (name)
+			emit(name, Phase::End);
+	}
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+private:
+	const char *name;
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+
+namespace aeq::utils
+{
+
+/* Wait-free single-producer single-consumer ring of fixed-size blocks.
+ * Each slot holds up to block_size elements, so pushing a block is a single memcpy.
+ * The producer never waits: if the ring is full the block is dropped and push returns false.
+ * The number of blocks is rounded up to a power of two. */
+template<typename T>
+class SPSCBlockRing
+{
+	static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
+public:
+	SPSCBlockRing(size_t nr_blocks, size_t block_size)
+		: nr_blocks(round_up_pow2(nr_blocks)), block_size(block_size),
+		storage(this->nr_blocks * block_size), sizes(this->nr_blocks) {}
+
+	SPSCBlockRing(const SPSCBlockRing&) = delete;
+	SPSCBlockRing& operator=(const SPSCBlockRing&) = delete;
+
+	/* Copy a block of at most block_size elements into the ring. Producer side only. */
+	inline bool push(const T *data, size_t size) noexcept
+	{
+		size_t w = write_idx.load(std::memory_order_relaxed);
+		if (w - read_idx.load(std::memory_order_acquire) == nr_blocks)
+			return false;
+		if (size > block_size)
+			size = block_size;
+		size_t slot = w & (nr_blocks - 1);
+		std::memcpy(&storage[slot * block_size], data, size * sizeof(T));
+		sizes[slot] = size;
+		write_idx.store(w + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Get the oldest block or nullptr if the ring is empty. Consumer side only. */
+	inline const T *front(size_t& size) const noexcept
+	{
+		size_t r = read_idx.load(std::memory_order_relaxed);
+		if (r == write_idx.load(std::memory_order_acquire))
+			return nullptr;
+		size_t slot = r & (nr_blocks - 1);
+		size = sizes[slot];
+		return &storage[slot * block_size];
+	}
+
+	/* Release the oldest block back to the producer. Consumer side only. */
+	inline void pop() noexcept
+	{
+		read_idx.store(read_idx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	inline size_t get_block_size() const noexcept { return block_size; }
+	inline size_t get_nr_blocks() const noexcept { return nr_blocks; }
+private:
+	static size_t round_up_pow2(size_t n)
+	{
+		size_t p = 1;
+		while (p < n)
+			p <<= 1;
+		return p;
+	}
+
+	size_t nr_blocks;
+	size_t block_size;
+	std::vector<T> storage;
+	std::vector<size_t> sizes;
+
+	alignas(64) std::atomic<size_t> write_idx {0};
+	alignas(64) std::atomic<size_t> read_idx {0};
+};
+
+} // namespace aeq::utils
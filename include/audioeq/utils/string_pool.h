@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aeq::utils {
+
+/* Handle to a string stored once in a StringPool.
+ * Handles from the same pool compare equal exactly when their strings do, by identity, as long
+ * as the strings are not released. */
+class InternedString {
+	friend class StringPool;
+public:
+	InternedString() : str(&empty()) {}
+
+	const std::string& get() const { return *str; }
+	std::string_view view() const { return *str; }
+
+	bool operator==(const InternedString& other) const { return str == other.str; }
+	bool operator!=(const InternedString& other) const { return str != other.str; }
+
+	/* Hash of the identity, for hash tables keyed by interned strings. */
+	size_t hash() const { return std::hash<const std::string *>()(str); }
+private:
+	explicit InternedString(const std::string *str) : str(str) {}
+
+	static const std::string& empty()
+	{
+		static const std::string empty_str;
+		return empty_str;
+	}
+
+	const std::string *str;
+};
+
+
+/* Stores every distinct string once and hands out InternedString handles to it.
+ * Every intern() takes a reference, release() drops one and the string is freed with its last
+ * reference, so the pool stays as large as the set of strings in use even when unique names
+ * keep coming and going. A released handle must not be used anymore: its storage is reused for
+ * the next new string. Strings never released are kept until the pool is destroyed.
+ * Not thread-safe. */
+class StringPool {
+	struct Entry {
+		std::string str;
+		uint64_t hash;
+		size_t nr_refs;
+	};
+public:
+	StringPool() = default;
+	StringPool(const StringPool&) = delete;
+	StringPool& operator=(const StringPool&) = delete;
+
+	InternedString intern(std::string_view str)
+	{
+		if (str.empty())
+			return InternedString();
+
+		if (2 * (nr_strings + 1) > slots.size())
+			grow();
+
+		// open addressing with linear probing, the table is at most half full
+		const uint64_t h = hash(str);
+		const size_t mask = slots.size() - 1;
+		for (size_t i = h & mask; ; i = (i + 1) & mask) {
+			Entry *slot = slots[i];
+			if (slot == nullptr) {
+				slots[i] = new_entry(str, h);
+				++nr_strings;
+				return InternedString(&slots[i]->str);
+			}
+			if (slot->hash == h && slot->str == str) {
+				++slot->nr_refs;
+				return InternedString(&slot->str);
+			}
+		}
+	}
+
+	/* Drop a reference taken by intern(). The empty string is never stored and is ignored. */
+	void release(InternedString interned)
+	{
+		if (interned.str == &InternedString::empty() || slots.empty())
+			return;
+
+		const size_t mask = slots.size() - 1;
+		size_t i = hash(*interned.str) & mask;
+		while (slots[i] != nullptr && &slots[i]->str != interned.str)
+			i = (i + 1) & mask;
+		Entry *entry = slots[i];
+		if (entry == nullptr || --entry->nr_refs > 0)
+			return;
+
+		// backward shift deletion, moves up the entries the freed slot would cut off from their home
+		for (size_t j = (i + 1) & mask; slots[j] != nullptr; j = (j + 1) & mask) {
+			size_t home = slots[j]->hash & mask;
+			if (((j - home) & mask) >= ((j - i) & mask)) {
+				slots[i] = slots[j];
+				i = j;
+			}
+		}
+		slots[i] = nullptr;
+		--nr_strings;
+
+		// deque elements never move, the entry is kept for the next new string
+		entry->str.clear();
+		free_entries.push_back(entry);
+	}
+
+	/* Find the handle of a string without interning it. Returns false if it isn't in the pool. */
+	bool find(std::string_view str, InternedString& interned) const
+	{
+		if (str.empty()) {
+			interned = InternedString();
+			return true;
+		}
+		if (slots.empty())
+			return false;
+
+		const uint64_t h = hash(str);
+		const size_t mask = slots.size() - 1;
+		for (size_t i = h & mask; slots[i] != nullptr; i = (i + 1) & mask) {
+			if (slots[i]->hash == h && slots[i]->str == str) {
+				interned = InternedString(&slots[i]->str);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* Number of distinct non-empty strings. */
+	size_t get_nr_strings() const { return nr_strings; }
+private:
+	/* FNV-1a, names are short and hashing them dominates lookups. */
+	static uint64_t hash(std::string_view str)
+	{
+		uint64_t h = 0xcbf29ce484222325ULL;
+		for (unsigned char c : str)
+			h = (h ^ c) * 0x100000001b3ULL;
+		return h ^ (h >> 32);
+	}
+
+	Entry *new_entry(std::string_view str, uint64_t h)
+	{
+		if (free_entries.empty())
+			return &entries.emplace_back(Entry {std::string(str), h, 1});
+		Entry *entry = free_entries.back();
+		free_entries.pop_back();
+		entry->str.assign(str);
+		entry->hash = h;
+		entry->nr_refs = 1;
+		return entry;
+	}
+
+	void grow()
+	{
+		std::vector<Entry *> old_slots(std::max<size_t>(64, slots.size() * 2), nullptr);
+		old_slots.swap(slots);
+		const size_t mask = slots.size() - 1;
+		for (Entry *entry : old_slots) {
+			if (entry == nullptr)
+				continue;
+			size_t i = entry->hash & mask;
+			while (slots[i] != nullptr)
+				i = (i + 1) & mask;
+			slots[i] = entry;
+		}
+	}
+
+	std::deque<Entry> entries;
+	std::vector<Entry *> free_entries;
+	std::vector<Entry *> slots;
+	size_t nr_strings = 0;
+};
+
+}
+
+namespace std {
+
+template<>
+struct hash<aeq::utils::InternedString> {
+	size_t operator()(const aeq::utils::InternedString& str) const { return str.hash(); }
+};
+
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "audioeq/thread_settings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aeq::utils
+{
+
+/* Fixed pool of worker threads running index ranges in parallel with work stealing.
+ * parallel_for deals [0, n) into one contiguous range per thread, each thread takes indices
+ * from the front of its own range and, once it's empty, steals from the back of the others.
+ * A range is a single 64-bit word, so taking and stealing are one compare-and-swap each.
+ * Not for RT threads: parallel_for blocks until all indices ran.
+ * This class is not intended to be movable/copiable. */
+class ThreadPool
+{
+	/* Packed [begin, end) of the indices left to a thread. */
+	struct alignas(64) Range {
+		std::atomic<uint64_t> bounds {0};
+	};
+public:
+	/* nr_threads counts the calling thread, 0 picks the number of hardware threads. */
+	explicit ThreadPool(size_t nr_threads = 0)
+	{
+		if (nr_threads == 0)
+			nr_threads = std::max(1U, std::thread::hardware_concurrency());
+		ranges = std::make_unique<Range[]>(nr_threads);
+		this->nr_threads = nr_threads;
+		for (size_t i = 1; i < nr_threads; ++i)
+			workers.emplace_back([this, i] { worker_main(i); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard lock {mutex};
+			stopping = true;
+		}
+		job_cv.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+	/* Call f(i) for every i in [0, n) on the pool and the calling thread, return once all
+	 * calls returned. n is at most 2^32 - 1. Calls of one parallel_for must not throw. */
+	void parallel_for(size_t n, const std::function<void(size_t)>& f)
+	{
+		if (n == 0)
+			return;
+
+		std::unique_lock lock {mutex};
+		for (size_t i = 0; i < nr_threads; ++i) {
+			uint64_t begin = n * i / nr_threads;
+			uint64_t end = n * (i + 1) / nr_threads;
+			ranges[i].bounds.store(begin | end << 32, std::memory_order_relaxed);
+		}
+		job = &f;
+		nr_left = n;
+		++generation;
+		lock.unlock();
+		job_cv.notify_all();
+
+		run_indices(0, f);
+
+		lock.lock();
+		done_cv.wait(lock, [this] { return nr_left == 0 && nr_running == 0; });
+		job = nullptr;
+	}
+
+	size_t get_nr_threads() const
+	{
+		return nr_threads;
+	}
+private:
+	void worker_main(size_t self)
+	{
+		apply_thread_settings(ThreadRole::Worker);
+		uint64_t seen_generation = 0;
+		std::unique_lock lock {mutex};
+		while (true) {
+			job_cv.wait(lock, [&] { return stopping || generation != seen_generation; });
+			if (stopping)
+				return;
+			seen_generation = generation;
+			// woken too late, the caller already ran all the indices
+			if (job == nullptr)
+				continue;
+			const std::function<void(size_t)> *f = job;
+			++nr_running;
+			lock.unlock();
+
+			run_indices(self, *f);
+
+			lock.lock();
+			--nr_running;
+			if (nr_left == 0 && nr_running == 0)
+				done_cv.notify_all();
+		}
+	}
+
+	void run_indices(size_t self, const std::function<void(size_t)>& f)
+	{
+		size_t nr_done = 0;
+		size_t index;
+		while (take_front(self, index) || steal(self, index)) {
+			f(index);
+			++nr_done;
+		}
+
+		std::lock_guard lock {mutex};
+		nr_left -= nr_done;
+		if (nr_left == 0 && nr_running == 0)
+			done_cv.notify_all();
+	}
+
+	bool take_front(size_t self, size_t& index)
+	{
+		std::atomic<uint64_t>& bounds = ranges[self].bounds;
+		uint64_t old_bounds = bounds.load(std::memory_order_relaxed);
+		while (true) {
+			uint64_t begin = old_bounds & 0xffffffff, end = old_bounds >> 32;
+			if (begin >= end)
+				return false;
+			if (bounds.compare_exchange_weak(old_bounds, (begin + 1) | end << 32,
+						std::memory_order_relaxed)) {
+				index = begin;
+				return true;
+			}
+		}
+	}
+
+	bool steal(size_t self, size_t& index)
+	{
+		for (size_t i = 1; i < nr_threads; ++i) {
+			std::atomic<uint64_t>& bounds = ranges[(self + i) % nr_threads].bounds;
+			uint64_t old_bounds = bounds.load(std::memory_order_relaxed);
+			while (true) {
+				uint64_t begin = old_bounds & 0xffffffff, end = old_bounds >> 32;
+				if (begin >= end)
+					break;
+				if (bounds.compare_exchange_weak(old_bounds, begin | (end - 1) << 32,
+							std::memory_order_relaxed)) {
+					index = end - 1;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	size_t nr_threads;
+	std::unique_ptr<Range[]> ranges;
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable job_cv;
+	std::condition_variable done_cv;
+	const std::function<void(size_t)> *job = nullptr;
+	uint64_t generation = 0;
+	size_t nr_left = 0;
+	size_t nr_running = 0;
+	bool stopping = false;
+};
+
+} // namespace aeq::utils
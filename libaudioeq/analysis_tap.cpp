@@ -0,0 +1,225 @@
+#include <audioeq/analysis_tap.h>
+#include <audioeq/thread_settings.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+namespace aeq {
+
+AnalysisTap::AnalysisTap(unsigned int nr_channels, int sample_rate,
+		size_t fft_size, size_t nr_display_bins,
+		size_t max_block_size, size_t nr_blocks)
+	: nr_channels(nr_channels), sample_rate(sample_rate),
+	fft_size(fft_size), nr_display_bins(nr_display_bins), channels(nr_channels)
+{
+	if (sample_rate <= 0)
+		throw AnalysisTapErr({"Non-positive sample rate."});
+	if (fft_size < 2 || (fft_size & (fft_size - 1)) != 0)
+		throw AnalysisTapErr({"FFT size must be a power of two."});
+	if (nr_display_bins == 0 || max_block_size == 0 || nr_blocks == 0)
+		throw AnalysisTapErr({"Invalid analysis tap dimensions."});
+
+	for (auto& channel : channels) {
+		channel.ring = std::make_unique<utils::SPSCBlockRing<float>>(nr_blocks, max_block_size);
+		channel.frame.resize(fft_size);
+		channel.spectrum.assign(nr_display_bins, -120.0F);
+	}
+
+	// Hann window
+	window.resize(fft_size);
+	for (size_t i = 0; i < fft_size; ++i)
+		window[i] = 0.5F - 0.5F * std::cos(2 * M_PI * i / fft_size);
+
+	// bit reversal permutation and twiddle factors of the radix-2 FFT
+	size_t nr_bits = 0;
+	while ((size_t(1) << nr_bits) < fft_size)
+		++nr_bits;
+	bit_reversed.resize(fft_size);
+	for (size_t i = 0; i < fft_size; ++i) {
+		size_t r = 0;
+		for (size_t b = 0; b < nr_bits; ++b)
+			r |= ((i >> b) & 1) << (nr_bits - 1 - b);
+		bit_reversed[i] = r;
+	}
+	twiddles.resize(fft_size / 2);
+	for (size_t i = 0; i < fft_size / 2; ++i)
+		twiddles[i] = std::polar(1.0F, float(-2 * M_PI * i / fft_size));
+	fft_buf.resize(fft_size);
+	magnitudes.resize(fft_size / 2);
+
+	// log-spaced display bins from 20 Hz up to nyquist, each covering at least one FFT bin
+	const double f_lo = 20.0;
+	const double f_hi = sample_rate / 2.0;
+	const double bin_hz = double(sample_rate) / fft_size;
+	display_bin_edges.resize(nr_display_bins + 1);
+	for (size_t i = 0; i <= nr_display_bins; ++i) {
+		double f = f_lo * std::pow(f_hi / f_lo, double(i) / nr_display_bins);
+		size_t edge = std::clamp<size_t>(size_t(f / bin_hz), 1, fft_size / 2);
+		if (i > 0 && edge <= display_bin_edges[i - 1])
+			edge = std::min(display_bin_edges[i - 1] + 1, fft_size / 2);
+		display_bin_edges[i] = edge;
+	}
+
+	analysis_thread = std::thread(&AnalysisTap::run, this);
+}
+
+
+AnalysisTap::~AnalysisTap()
+{
+	running = false;
+	if (analysis_thread.joinable())
+		analysis_thread.join();
+}
+
+
+void AnalysisTap::push(unsigned int channel, const float *data, size_t nr_samples) noexcept
+{
+	if (channel >= nr_channels)
+		return;
+	auto& ring = *channels[channel].ring;
+	const size_t block_size = ring.get_block_size();
+	while (nr_samples > 0) {
+		size_t n = std::min(nr_samples, block_size);
+		if (!ring.push(data, n)) {
+			nr_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		data += n;
+		nr_samples -= n;
+	}
+}
+
+
+void AnalysisTap::get_spectrum(unsigned int channel, std::vector<float>& spectrum) const
+{
+	if (channel >= nr_channels)
+		throw AnalysisTapErr({"Channel index out of range."});
+	std::lock_guard lock {display_mutex};
+	spectrum = channels[channel].spectrum;
+}
+
+
+AnalysisTap::Levels AnalysisTap::get_levels(unsigned int channel) const
+{
+	if (channel >= nr_channels)
+		throw AnalysisTapErr({"Channel index out of range."});
+	std::lock_guard lock {display_mutex};
+	return channels[channel].levels;
+}
+
+
+uint64_t AnalysisTap::get_nr_dropped() const
+{
+	return nr_dropped.load(std::memory_order_relaxed);
+}
+
+
+unsigned int AnalysisTap::get_nr_channels() const
+{
+	return nr_channels;
+}
+
+
+void AnalysisTap::run()
+{
+	using namespace std::chrono_literals;
+
+	apply_thread_settings(ThreadRole::Analysis);
+
+	while (running.load(std::memory_order_relaxed)) {
+		bool consumed = false;
+		for (auto& channel : channels) {
+			size_t nr_samples;
+			const float *data;
+			while ((data = channel.ring->front(nr_samples)) != nullptr) {
+				analyze_block(channel, data, nr_samples);
+				channel.ring->pop();
+				consumed = true;
+			}
+		}
+		// the RT side never signals, so poll at roughly display rate when idle
+		if (!consumed)
+			std::this_thread::sleep_for(10ms);
+	}
+}
+
+
+void AnalysisTap::analyze_block(Channel& channel, const float *data, size_t nr_samples)
+{
+	// meters: peak hold with decay and exponentially averaged mean square
+	float block_peak = 0.0F;
+	float block_sum_sq = 0.0F;
+	for (size_t i = 0; i < nr_samples; ++i) {
+		block_peak = std::max(block_peak, std::fabs(data[i]));
+		block_sum_sq += data[i] * data[i];
+	}
+	const float decay = std::exp(-float(nr_samples) / (0.3F * sample_rate));
+	channel.peak = std::max(block_peak, channel.peak * decay);
+	if (nr_samples > 0)
+		channel.mean_square = decay * channel.mean_square
+				    + (1.0F - decay) * (block_sum_sq / nr_samples);
+
+	{
+		std::lock_guard lock {display_mutex};
+		channel.levels = {channel.peak, std::sqrt(channel.mean_square)};
+	}
+
+	// accumulate frames with 50% overlap
+	while (nr_samples > 0) {
+		size_t n = std::min(nr_samples, fft_size - channel.frame_fill);
+		std::copy_n(data, n, channel.frame.begin() + channel.frame_fill);
+		channel.frame_fill += n;
+		data += n;
+		nr_samples -= n;
+
+		if (channel.frame_fill == fft_size) {
+			analyze_frame(channel);
+			std::copy(channel.frame.begin() + fft_size / 2, channel.frame.end(),
+					channel.frame.begin());
+			channel.frame_fill = fft_size / 2;
+		}
+	}
+}
+
+
+void AnalysisTap::analyze_frame(Channel& channel)
+{
+	for (size_t i = 0; i < fft_size; ++i)
+		fft_buf[bit_reversed[i]] = channel.frame[i] * window[i];
+	fft();
+
+	// magnitudes normalized so that a full scale sine reads 0 dBFS (Hann coherent gain is 0.5)
+	const float norm = 4.0F / fft_size;
+	for (size_t i = 0; i < fft_size / 2; ++i)
+		magnitudes[i] = std::abs(fft_buf[i]) * norm;
+
+	std::lock_guard lock {display_mutex};
+	for (size_t b = 0; b < nr_display_bins; ++b) {
+		float max_mag = 0.0F;
+		for (size_t i = display_bin_edges[b]; i < std::max(display_bin_edges[b + 1], display_bin_edges[b] + 1)
+				&& i < fft_size / 2; ++i)
+			max_mag = std::max(max_mag, magnitudes[i]);
+		channel.spectrum[b] = 20.0F * std::log10(std::max(max_mag, 1e-6F));
+	}
+}
+
+
+void AnalysisTap::fft()
+{
+	// iterative radix-2 decimation-in-time over bit-reversed input
+	for (size_t len = 2; len <= fft_size; len <<= 1) {
+		const size_t half = len / 2;
+		const size_t step = fft_size / len;
+		for (size_t i = 0; i < fft_size; i += len) {
+			for (size_t j = 0; j < half; ++j) {
+				std::complex<float> t = twiddles[j * step] * fft_buf[i + j + half];
+				fft_buf[i + j + half] = fft_buf[i + j] - t;
+				fft_buf[i + j] += t;
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,280 @@
+#include <audioeq/capture_tap.h>
+#include <audioeq/thread_settings.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace aeq {
+
+namespace {
+
+/* The WAV header is padded with a JUNK chunk so that the audio data starts aligned. */
+constexpr size_t header_size = 4096;
+
+void put_u16(char *&p, uint16_t value)
+{
+	std::memcpy(p, &value, sizeof(value));
+	p += sizeof(value);
+}
+
+void put_u32(char *&p, uint32_t value)
+{
+	std::memcpy(p, &value, sizeof(value));
+	p += sizeof(value);
+}
+
+void put_tag(char *&p, const char *tag)
+{
+	std::memcpy(p, tag, 4);
+	p += 4;
+}
+
+/* Write all of buf at offset, retrying short writes. */
+bool pwrite_all(int fd, const void *buf, size_t size, off_t offset)
+{
+	const char *data = static_cast<const char *>(buf);
+	while (size > 0) {
+		ssize_t ret = ::pwrite(fd, data, size, offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		data += ret;
+		size -= ret;
+		offset += ret;
+	}
+	return true;
+}
+
+}
+
+
+CaptureTap::CaptureTap(const char *path, unsigned int nr_channels, int sample_rate, unsigned int ring_ms)
+	: nr_channels(nr_channels), sample_rate(sample_rate)
+{
+	if (sample_rate <= 0)
+		throw CaptureTapErr({"Non-positive sample rate."});
+	if (nr_channels == 0)
+		throw CaptureTapErr({"Capture without channels."});
+
+	// ring of at least two chunks, a power of two so that indices wrap with a mask
+	size_t ring_bytes = size_t(ring_ms) * sample_rate / 1000 * nr_channels * sizeof(float);
+	size_t ring_alloc = 2 * chunk_size;
+	while (ring_alloc < ring_bytes)
+		ring_alloc <<= 1;
+	ring = static_cast<float *>(std::aligned_alloc(header_size, ring_alloc));
+	if (ring == nullptr)
+		throw CaptureTapErr({"Error: failed to allocate capture ring."});
+	// touch every page now, so the RT thread never faults them in
+	std::memset(ring, 0, ring_alloc);
+	ring_size = ring_alloc / sizeof(float);
+
+	fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		std::free(ring);
+		throw CaptureTapErr({"Error: failed to open capture file", errno});
+	}
+	write_header(0);
+
+	// not every filesystem supports O_DIRECT, fall back to buffered writes there
+	int flags = ::fcntl(fd, F_GETFL);
+	direct = flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_DIRECT) == 0;
+
+	writer_thread = std::thread(&CaptureTap::run, this);
+}
+
+
+CaptureTap::~CaptureTap()
+{
+	running = false;
+	if (writer_thread.joinable())
+		writer_thread.join();
+	finish();
+	::close(fd);
+	std::free(ring);
+}
+
+
+bool CaptureTap::reserve(size_t nr_frames) noexcept
+{
+	const size_t nr_samples = nr_frames * nr_channels;
+	const uint64_t w = write_idx.load(std::memory_order_relaxed);
+	const uint64_t r = read_idx.load(std::memory_order_acquire);
+	if (ring_size - (w - r) < nr_samples) {
+		reserved_frames = 0;
+		nr_overruns.fetch_add(1, std::memory_order_relaxed);
+		nr_dropped_frames.fetch_add(nr_frames, std::memory_order_relaxed);
+		return false;
+	}
+	reserved_frames = nr_frames;
+	reserved_at = w;
+	return true;
+}
+
+
+void CaptureTap::write_channel(unsigned int channel, const float *data) noexcept
+{
+	if (channel >= nr_channels)
+		return;
+	const size_t mask = ring_size - 1;
+	size_t idx = reserved_at + channel;
+	for (size_t i = 0; i < reserved_frames; ++i, idx += nr_channels)
+		ring[idx & mask] = data ? data[i] : 0.0F;
+}
+
+
+void CaptureTap::commit() noexcept
+{
+	if (reserved_frames == 0)
+		return;
+	write_idx.store(reserved_at + reserved_frames * nr_channels, std::memory_order_release);
+	reserved_frames = 0;
+}
+
+
+uint64_t CaptureTap::get_nr_overruns() const
+{
+	return nr_overruns.load(std::memory_order_relaxed);
+}
+
+
+uint64_t CaptureTap::get_nr_dropped_frames() const
+{
+	return nr_dropped_frames.load(std::memory_order_relaxed);
+}
+
+
+uint64_t CaptureTap::get_nr_bytes_written() const
+{
+	return nr_bytes_written.load(std::memory_order_relaxed);
+}
+
+
+uint64_t CaptureTap::get_nr_write_errors() const
+{
+	return nr_write_errors.load(std::memory_order_relaxed);
+}
+
+
+bool CaptureTap::is_direct() const
+{
+	return direct;
+}
+
+
+unsigned int CaptureTap::get_nr_channels() const
+{
+	return nr_channels;
+}
+
+
+void CaptureTap::run()
+{
+	using namespace std::chrono_literals;
+
+	apply_thread_settings(ThreadRole::Capture);
+
+	while (running.load(std::memory_order_relaxed)) {
+		// the RT side never signals, a chunk takes far longer than this to fill anyway
+		if (!write_chunks())
+			std::this_thread::sleep_for(5ms);
+	}
+}
+
+
+bool CaptureTap::write_chunks()
+{
+	constexpr size_t chunk_samples = chunk_size / sizeof(float);
+	const size_t mask = ring_size - 1;
+
+	uint64_t r = read_idx.load(std::memory_order_relaxed);
+	const uint64_t w = write_idx.load(std::memory_order_acquire);
+	bool written = false;
+
+	// r stays a multiple of the chunk, so a chunk never wraps around the ring
+	while (w - r >= chunk_samples) {
+		if (pwrite_all(fd, &ring[r & mask], chunk_size, header_size + r * sizeof(float)))
+			nr_bytes_written.fetch_add(chunk_size, std::memory_order_relaxed);
+		else
+			nr_write_errors.fetch_add(1, std::memory_order_relaxed);
+		r += chunk_samples;
+		read_idx.store(r, std::memory_order_release);
+		written = true;
+	}
+	return written;
+}
+
+
+void CaptureTap::finish()
+{
+	write_chunks();
+
+	// the tail is not a multiple of the alignment, so it's written buffered
+	if (direct) {
+		int flags = ::fcntl(fd, F_GETFL);
+		if (flags >= 0)
+			::fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+	}
+
+	const uint64_t r = read_idx.load(std::memory_order_relaxed);
+	const uint64_t w = write_idx.load(std::memory_order_acquire);
+	const size_t tail_bytes = (w - r) * sizeof(float);
+	if (tail_bytes > 0) {
+		if (pwrite_all(fd, &ring[r & (ring_size - 1)], tail_bytes, header_size + r * sizeof(float)))
+			nr_bytes_written.fetch_add(tail_bytes, std::memory_order_relaxed);
+		else
+			nr_write_errors.fetch_add(1, std::memory_order_relaxed);
+	}
+	read_idx.store(w, std::memory_order_release);
+
+	write_header(w * sizeof(float));
+}
+
+
+void CaptureTap::write_header(uint64_t nr_data_bytes)
+{
+	// sizes past the 4 GiB of RIFF are marked unknown, as most readers expect
+	const uint64_t riff_size = header_size - 8 + nr_data_bytes;
+	const uint32_t riff_size32 = riff_size > UINT32_MAX ? UINT32_MAX : uint32_t(riff_size);
+	const uint32_t data_size32 = nr_data_bytes > UINT32_MAX ? UINT32_MAX : uint32_t(nr_data_bytes);
+	const uint16_t block_align = nr_channels * sizeof(float);
+
+	std::vector<char> header(header_size, 0);
+	char *p = header.data();
+	put_tag(p, "RIFF");
+	put_u32(p, riff_size32);
+	put_tag(p, "WAVE");
+
+	put_tag(p, "fmt ");
+	put_u32(p, 18);
+	put_u16(p, 3);	// WAVE_FORMAT_IEEE_FLOAT
+	put_u16(p, nr_channels);
+	put_u32(p, sample_rate);
+	put_u32(p, uint32_t(sample_rate) * block_align);
+	put_u16(p, block_align);
+	put_u16(p, 32);
+	put_u16(p, 0);
+
+	put_tag(p, "fact");
+	put_u32(p, 4);
+	put_u32(p, data_size32 / block_align);
+
+	const size_t junk_size = header_size - (p - header.data()) - 16;
+	put_tag(p, "JUNK");
+	put_u32(p, junk_size);
+	p += junk_size;
+
+	put_tag(p, "data");
+	put_u32(p, data_size32);
+
+	if (!pwrite_all(fd, header.data(), header.size(), 0))
+		nr_write_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
@@ -1,10 +1,28 @@
 #include <audioeq/core.h>
+#include <audioeq/trace.h>
+#include <audioeq/thread_settings.h>
 
 #include <algorithm>
+#include <cstdlib>
+#include <string_view>
+#include <utility>
+
 
 
 namespace aeq {
 
+namespace {
+
+/* Channel of a port from the suffix of its name, like "FL" of "playback_FL". Empty if none. */
+std::string_view channel_of(const Port& port)
+{
+	std::string_view name = port.get_name();
+	size_t pos = name.rfind('_');
+	return pos == std::string_view::npos ? std::string_view() : name.substr(pos + 1);
+}
+
+}
+
 
 Core::Core(int &argc, char **&argv)
 {
@@ -33,6 +51,14 @@ Core::Core(int &argc, char **&argv)
 	int ret = pw_thread_loop_start(loop.get());
 	if (ret)
 		throw CoreErr({"Error: failed to start a loop.", errno});
+	// the loop thread is pipewire's, it picks up the settings from within
+	pw_loop_invoke(pw_thread_loop_get_loop(loop.get()),
+			[](spa_loop *, bool, uint32_t, const void *, size_t, void *) -> int
+			{
+				apply_thread_settings(ThreadRole::Control);
+				return 0;
+			},
+			SPA_ID_INVALID, nullptr, 0, true, nullptr);
 
 	this->deferred_deinit = std::move(deferred_deinit);
 	this->loop = std::move(loop);
@@ -43,6 +69,7 @@ Core::Core(int &argc, char **&argv)
 
 	lock_loop();
 	setup_registry_events();
+	routing_event = pw_loop_add_event(pw_thread_loop_get_loop(this->loop.get()), on_routing_event, this);
 	unlock_loop();
 	deferred_deinit.cancel();
 
@@ -82,6 +109,15 @@ void Core::T_deleter<pw_thread_loop>::operator()(pw_thread_loop *loop)
 
 Core::~Core()
 {
+	lock_loop();
+	if (routing_event)
+		pw_loop_destroy_source(pw_thread_loop_get_loop(loop.get()), routing_event);
+	// disconnecting the core would destroy them after the routing bookkeeping is gone
+	for (PendingLinkData *link_data : std::exchange(routed_links, {})) {
+		spa_hook_remove(&link_data->listener);
+		pw_proxy_destroy(link_data->proxy);
+	}
+	unlock_loop();
 	pw_thread_loop_stop(loop.get());
 }
 
@@ -106,18 +142,23 @@ void Core::wait_loop() const
 
 void Core::list_nodes(std::vector<Node *>& nodes) const
 {
-	std::transform(registry_objects.nodes.begin(),
-			registry_objects.nodes.end(),
-			std::back_inserter(nodes),
-			[](const auto& id_node) { return id_node.second.get(); });
+	model.list_nodes(nodes);
 }
 
 
 uint32_t Core::link_ports(Port& o_port, Port& i_port)
 {
+	trace::Scope trace_scope {"Core::link_ports"};
 	if (o_port.get_direction() != PortDirection::Output || i_port.get_direction() != PortDirection::Input)
 		throw CoreErr({"Error: wrong port given."});
 
+	pw_proxy *link = create_link(o_port, i_port, 0);
+	return link ? pw_proxy_get_id(link) : 0;
+}
+
+
+pw_proxy *Core::create_link(const Port& o_port, const Port& i_port, size_t user_data_size)
+{
 	pw_properties *props = pw_properties_new(nullptr, nullptr);
 	pw_properties_setf(props, PW_KEY_LINK_OUTPUT_PORT, "%d", o_port.get_id());
 	pw_properties_setf(props, PW_KEY_LINK_INPUT_PORT, "%d", i_port.get_id());
@@ -126,18 +167,15 @@ uint32_t Core::link_ports(Port& o_port, Port& i_port)
 				"link-factory",
 				PW_TYPE_INTERFACE_Link,
 				PW_VERSION_LINK,
-				&props->dict, 0));
-	if (link == nullptr) {
-		pw_properties_free(props);
-		return 0;
-	}
+				&props->dict, user_data_size));
 	pw_properties_free(props);
-	return pw_proxy_get_id(link);
+	return link;
 }
 
 
 void Core::unlink_ports(uint32_t link_id)
 {
+	trace::Scope trace_scope {"Core::unlink_ports"};
 	pw_proxy *link = static_cast<pw_proxy *>(pw_core_find_proxy(core.get(), link_id));
 	if (link)
 		pw_proxy_destroy(link);
@@ -159,25 +197,87 @@ void Core::init_filter(Filter& filter, const char *name)
 		pw_properties_free(props);
 		throw CoreErr({"Failed to create a pipewire filter.", errno});
 	}
+	filter.core = this;
 	filter.core_init(pipewire_filter);
 }
 
 
+void Core::invoke_on_data_loop(void (*func)(void *), void *data)
+{
+	struct Invocation {
+		void (*func)(void *);
+		void *data;
+	};
+
+	static const auto do_invoke = [](spa_loop *loop, bool async, uint32_t seq,
+			const void *data, size_t size, void *user_data) -> int
+	{
+		const Invocation *invocation = static_cast<const Invocation *>(data);
+		invocation->func(invocation->data);
+		return 0;
+	};
+
+	Invocation invocation {func, data};
+	pw_data_loop_invoke(pw_context_get_data_loop(context.get()), +do_invoke,
+			SPA_ID_INVALID, &invocation, sizeof(invocation), true, nullptr);
+}
+
+
+void Core::set_recording(RegistryRecording *recording)
+{
+	lock_loop();
+	this->recording = recording;
+	unlock_loop();
+}
+
+
+void Core::set_routing_rules(std::vector<RoutingRule> rules)
+{
+	lock_loop();
+	utils::Defer defer {[this](){unlock_loop();}};
+
+	routing_rules = RoutingRules(std::move(rules));
+	routed_nodes.clear();
+	dirty_routed_nodes.clear();
+	// proxies still in flight find no entry of theirs anymore
+	pending_links.clear();
+
+	std::vector<Node *> nodes;
+	model.list_nodes(nodes);
+	for (Node *node : nodes)
+		route_node(*node);
+}
+
+
+std::vector<RoutingRule> Core::get_routing_rules() const
+{
+	lock_loop();
+	utils::Defer defer {[this](){unlock_loop();}};
+	return routing_rules.get_rules();
+}
+
+
 Node *Core::find_node(uint32_t id) const
 {
-	auto found_it = registry_objects.nodes.find(id);
-	if (found_it == registry_objects.nodes.end())
-		return nullptr;
-	return found_it->second.get();
+	return model.find_node(id);
+}
+
+
+Node *Core::find_node_by_name(std::string_view name) const
+{
+	return model.find_node_by_name(name);
 }
 
 
 Port *Core::find_port(uint32_t id) const
 {
-	auto found_it = registry_objects.ports.find(id);
-	if (found_it == registry_objects.ports.end())
-		return nullptr;
-	return found_it->second.get();
+	return model.find_port(id);
+}
+
+
+Port *Core::find_port(uint32_t node_id, std::string_view name, PortDirection direction) const
+{
+	return model.find_port(node_id, name, direction);
 }
 
 
@@ -196,257 +296,225 @@ void Core::on_global(void *data, uint32_t id,
 		uint32_t version,
 		const spa_dict *props)
 {
+	trace::Scope trace_scope {"Core::on_global"};
 	RegistryEventUserData& reud = *static_cast<RegistryEventUserData *>(data);
-	std::string_view str_type {type};
-
-	if (str_type == PW_TYPE_INTERFACE_Node)
-		reud.self->wrap_node(id, props);
-	else if (str_type == PW_TYPE_INTERFACE_Port)
-		reud.self->wrap_port(id, props);
-	else if (str_type == PW_TYPE_INTERFACE_Link)
-		reud.self->wrap_link(id, props);
+	if (reud.self->recording)
+		reud.self->recording->record_global(id, type, props);
+	reud.self->model.on_global(id, type, props);
+	reud.self->route_global(id, type, props);
 }
 
 
 void Core::on_global_remove(void *data, uint32_t id)
 {
+	trace::Scope trace_scope {"Core::on_global_remove"};
 	RegistryEventUserData& reud = *static_cast<RegistryEventUserData *>(data);
-	if (reud.self->try_unwrap_node(id))
-		return;
-	if (reud.self->try_unwrap_port(id))
-		return;
-	if (reud.self->try_unwrap_link(id))
-		return;
+	if (reud.self->recording)
+		reud.self->recording->record_global_remove(id);
+	if (!reud.self->pending_links.empty()) {
+		// links requested to ports going away will never appear
+		if (reud.self->model.find_port(id)) {
+			reud.self->forget_pending_links(id);
+		} else if (Node *node = reud.self->model.find_node(id)) {
+			for (size_t i = 0; i < node->get_nr_i_ports(); ++i)
+				reud.self->forget_pending_links(node->get_i_port(i).get_id());
+			for (size_t i = 0; i < node->get_nr_o_ports(); ++i)
+				reud.self->forget_pending_links(node->get_o_port(i).get_id());
+		}
+	}
+	reud.self->model.on_global_remove(id);
+	if (reud.self->routed_nodes.erase(id))
+		reud.self->dirty_routed_nodes.erase(id);
 }
 
 
-void Core::wrap_node(uint32_t id, const spa_dict *props)
+void Core::on_routing_event(void *data, uint64_t count)
 {
-	// get node name
-	const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
-	if (name == nullptr)
-		name = "";
-	// get node description
-	const char *description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
-	if (description == nullptr)
-		description = "";
+	static_cast<Core *>(data)->flush_routing();
+}
 
-	// create the node wrapper and store it in registry_objects
-	Node *node = new Node(Object(id), name, description);
-	registry_objects.nodes[id] = std::unique_ptr<Node>(node);
 
-	// find ports that belong to this node but were found and wrapped before this node was found and wrapped
-	auto port_it = registry_objects.nodeless_ports.find(id);
-	if (port_it == registry_objects.nodeless_ports.end())
+void Core::route_global(uint32_t id, const char *type, const spa_dict *props)
+{
+	if (routing_rules.get_nr_rules() == 0)
 		return;
 
-	// set this wrapper node as an owner of these ports
-	std::vector<Port *>& ports = port_it->second;
-	for (auto port : ports) {
-		port->set_owner(*node);
-		node->add_port(*port);
-	}
-
-	// remove refs to these ports in nodeless_ports
-	registry_objects.nodeless_ports.erase(port_it);
-}
-
-
-void Core::wrap_port(uint32_t id, const spa_dict *props)
-{
-	// get port name
-	const char *name = spa_dict_lookup(props, PW_KEY_PORT_NAME);
-	if (name == nullptr)
-		name = "";
-	// get port direction
-	const char *str_direction = spa_dict_lookup(props, PW_KEY_PORT_DIRECTION);
-	if (str_direction == nullptr)
-		str_direction = "out";
-	PortDirection direction = std::string(str_direction) == "in" ?
-						PortDirection::Input : PortDirection::Output;
-
-	// create the port wrapper and store it in registry_objects
-	Port *port = new Port(Object(id), name, direction);
-	registry_objects.ports[id] = std::unique_ptr<Port>(port);
-
-	// get owner node id
-	const char *str_node_id = spa_dict_lookup(props, PW_KEY_NODE_ID);
-	uint32_t node_id = str_node_id ? ::atoi(str_node_id) : 0;
-
-	// find the node in the registry_objects
-	auto node_it = registry_objects.nodes.find(node_id);
-	if (node_it != registry_objects.nodes.end()) {
-		// if the node found, assign the node as owner of the port and add port to the node
-		Node *node = node_it->second.get();
-		port->set_owner(*node);
-		node->add_port(*port);
-	} else {
-		// if the node ain't found, assign only owner id to the port, node wrapper will be assigned later when found
-		port->set_owner_id(node_id);
-		// add port to the map of nodeless ports under the node id, so when the node appears it could find the ports it owns
-		registry_objects.nodeless_ports[node_id].push_back(port);
+	std::string_view str_type {type};
+	if (str_type == PW_TYPE_INTERFACE_Node) {
+		Node *node = model.find_node(id);
+		route_node(*node);
+		mark_routed_to(node->get_name());
+	} else if (str_type == PW_TYPE_INTERFACE_Port) {
+		Port *port = model.find_port(id);
+		if (routed_nodes.count(port->get_owner_id()))
+			mark_routing_dirty(port->get_owner_id());
+		else if (Node *owner = port->get_owner())
+			mark_routed_to(owner->get_name());
+	} else if (str_type == PW_TYPE_INTERFACE_Link && !pending_links.empty()) {
+		// a link requested by the rules is now in the registry
+		const char *str_o_port_id = spa_dict_lookup(props, PW_KEY_LINK_OUTPUT_PORT);
+		const char *str_i_port_id = spa_dict_lookup(props, PW_KEY_LINK_INPUT_PORT);
+		if (str_o_port_id && str_i_port_id)
+			pending_links.erase(uint64_t(::atoi(str_o_port_id)) << 32 | uint32_t(::atoi(str_i_port_id)));
 	}
+}
 
-	// find links that were missing this port to be 'complete' and were found and wrapped before this port was found and wrapped
-	auto portless_link_it = registry_objects.portless_links.find(id);
-	if (portless_link_it == registry_objects.portless_links.end())
-		return;
 
-	// resolve links
-	std::vector<LinkInfo>& portless_links = portless_link_it->second;
-	for (auto&& link : portless_links) {
-		if (direction == PortDirection::Input) {
-			// if this port is an input port, the other one is output port
-			if (link.o_port.ptr == nullptr)
-				// if the other port is missing like this one did, just link this port to an id without wrapper
-				port->link_to_id(link.o_port.id);
-			else
-				// otherwise the link will be complete now
-				port->link_to(*link.o_port.ptr);
-		} else {
-			// if this port is an output port, the other one is input port (same goes here as above)
-			if (link.i_port.ptr == nullptr)
-				port->link_to_id(link.i_port.id);
-			else
-				port->link_to(*link.i_port.ptr);
-		}
-	}
-	// this links aren't missing this port anymore, so remove them
-	registry_objects.portless_links.erase(portless_link_it);
-}
-
-
-void Core::wrap_link(uint32_t id, const spa_dict *props)
-{
-	const char *str_port_id;
-	// get output port id
-	str_port_id = spa_dict_lookup(props, PW_KEY_LINK_OUTPUT_PORT);
-	uint32_t o_port_id = str_port_id ? ::atoi(str_port_id) : 0;
-	// get input port id
-	str_port_id = spa_dict_lookup(props, PW_KEY_LINK_INPUT_PORT);
-	uint32_t i_port_id = str_port_id ? ::atoi(str_port_id) : 0;
-
-	// find the output port if present
-	Port *o_port;
-	auto o_port_it = registry_objects.ports.find(o_port_id);
-	if (o_port_it == registry_objects.ports.end())
-		o_port = nullptr;
-	else
-		o_port = o_port_it->second.get();
-
-	// find the input port if present
-	Port *i_port;
-	auto i_port_it = registry_objects.ports.find(i_port_id);
-	if (i_port_it == registry_objects.ports.end())
-		i_port = nullptr;
-	else
-		i_port = i_port_it->second.get();
-
-	// store the link info in the registry_objects
-	registry_objects.links[id] = {ID_Ptr(i_port_id, i_port), ID_Ptr(o_port_id, o_port)};
-
-	if (o_port && i_port) {
-		// if both ports present, fully link them
-		o_port->link_to(*i_port);
+void Core::route_node(Node& node)
+{
+	std::vector<size_t> matched;
+	routing_rules.match(node.get_name(), node.get_media_class(), matched);
+	if (matched.empty())
 		return;
-	}
-
-	if (o_port) {
-		// if input port is missing but output port isn't, link output port to an input port id
-		o_port->link_to_id(i_port_id);
-		// and store it in the portless_links map under the input port id
-		registry_objects.portless_links[i_port_id].push_back(
-				{ID_Ptr<Port>(i_port_id), ID_Ptr(o_port)});
-	}
+	routed_nodes[node.get_id()] = std::move(matched);
+	mark_routing_dirty(node.get_id());
+}
 
-	if (i_port) {
-		// if output port is missing but input port isn't, link input port to an output port id
-		i_port->link_to_id(o_port_id);
-		// and store it in the portless_links map under the output port id
-		registry_objects.portless_links[o_port_id].push_back(
-				{ID_Ptr(i_port), ID_Ptr<Port>(o_port_id)});
-	}
 
-	if (i_port != o_port)
+void Core::mark_routed_to(const std::string& target_name)
+{
+	const std::vector<size_t> *targeting = routing_rules.find_targeting(target_name);
+	if (targeting == nullptr)
 		return;
-
-	// if both ports are missing, store the link info under both input and output port IDs
-	registry_objects.portless_links[i_port_id].push_back(
-			{ID_Ptr<Port>(i_port_id), ID_Ptr<Port>(o_port_id)});
-	registry_objects.portless_links[o_port_id].push_back(
-			{ID_Ptr<Port>(i_port_id), ID_Ptr<Port>(o_port_id)});
+	for (const auto& [node_id, rules] : routed_nodes) {
+		bool routed_to = std::any_of(rules.begin(), rules.end(), [targeting](size_t rule)
+		{
+			return std::binary_search(targeting->begin(), targeting->end(), rule);
+		});
+		if (routed_to)
+			mark_routing_dirty(node_id);
+	}
 }
 
 
-bool Core::try_unwrap_node(uint32_t id)
+void Core::mark_routing_dirty(uint32_t node_id)
 {
-	// find the node
-	auto node_it = registry_objects.nodes.find(id);
-	if (node_it == registry_objects.nodes.end())
-		return false;
+	if (dirty_routed_nodes.empty() && routing_event)
+		pw_loop_signal_event(pw_thread_loop_get_loop(loop.get()), routing_event);
+	dirty_routed_nodes.insert(node_id);
+}
 
-	Node *node = node_it->second.get();
 
-	// unown all its ports
-	size_t num_ports = node->get_nr_i_ports();
-	for (size_t i = 0; i < num_ports; ++i) {
-		Port& port = node->get_i_port(i);
-		port.unown();
+void Core::flush_routing()
+{
+	trace::Scope trace_scope {"Core::flush_routing"};
+
+	std::vector<std::pair<Port *, Port *>> pairs;
+	for (uint32_t node_id : dirty_routed_nodes) {
+		Node *node = model.find_node(node_id);
+		auto routed_it = routed_nodes.find(node_id);
+		if (node == nullptr || routed_it == routed_nodes.end())
+			continue;
+
+		for (size_t rule : routed_it->second) {
+			Node *target = model.find_node_by_name(routing_rules.get_rule(rule).target_node_name);
+			if (target == nullptr || target == node)
+				continue;
+
+			pair_channels(*node, *target, pairs);
+			for (auto [o_port_ptr, i_port_ptr] : pairs) {
+				Port& o_port = *o_port_ptr;
+				Port& i_port = *i_port_ptr;
+				uint64_t link_key = uint64_t(o_port.get_id()) << 32 | i_port.get_id();
+				if (pending_links.count(link_key))
+					continue;
+
+				bool linked = false;
+				for (size_t l = 0; l < o_port.get_nr_linked_ports() && !linked; ++l)
+					linked = o_port.get_linked_port_id(l) == i_port.get_id();
+				if (linked)
+					continue;
+
+				request_link(o_port, i_port, link_key);
+			}
+		}
 	}
+	dirty_routed_nodes.clear();
+}
+
 
-	num_ports = node->get_nr_o_ports();
-	for (size_t i = 0; i < num_ports; ++i) {
-		Port& port = node->get_o_port(i);
-		port.unown();
+void Core::pair_channels(const Node& node, const Node& target, std::vector<std::pair<Port *, Port *>>& pairs)
+{
+	// by the channel in the port names, so that FL goes to FL whatever order the ports appeared in
+	pairs.clear();
+	bool by_channel = true;
+	for (size_t o = 0; o < node.get_nr_o_ports() && by_channel; ++o) {
+		Port& o_port = node.get_o_port(o);
+		std::string_view channel = channel_of(o_port);
+		Port *i_port = nullptr;
+		for (size_t i = 0; i < target.get_nr_i_ports() && !channel.empty() && !i_port; ++i) {
+			if (channel_of(target.get_i_port(i)) == channel)
+				i_port = &target.get_i_port(i);
+		}
+		by_channel = i_port != nullptr;
+		if (by_channel)
+			pairs.emplace_back(&o_port, i_port);
 	}
+	if (by_channel)
+		return;
 
-	// remove it from registry_objects
-	registry_objects.nodes.erase(node_it);
-	return true;
+	// otherwise in the order the ports appeared
+	pairs.clear();
+	size_t nr_links = std::min(node.get_nr_o_ports(), target.get_nr_i_ports());
+	for (size_t i = 0; i < nr_links; ++i)
+		pairs.emplace_back(&node.get_o_port(i), &target.get_i_port(i));
 }
 
 
-bool Core::try_unwrap_port(uint32_t id)
+void Core::request_link(const Port& o_port, const Port& i_port, uint64_t link_key)
 {
-	// find the port
-	auto port_it = registry_objects.ports.find(id);
-	if (port_it == registry_objects.ports.end())
-		return false;
+	pw_proxy *link = create_link(o_port, i_port, sizeof(PendingLinkData));
+	if (link == nullptr)
+		return;
 
-	Port *port = port_it->second.get();
+	auto *link_data = static_cast<PendingLinkData *>(pw_proxy_get_user_data(link));
+	link_data->self = this;
+	link_data->proxy = link;
+	link_data->link_key = link_key;
+	spa_zero(link_data->listener);
+	pw_proxy_add_listener(link, &link_data->listener, &pending_link_events, link_data);
+	routed_links.insert(link_data);
+	pending_links[link_key] = pw_proxy_get_id(link);
+}
 
-	// unlink from all its linked ports
-	size_t num_links = port->get_nr_linked_ports();
-	while (num_links > 0) {
-		auto linked_port = port->get_linked_port(--num_links);
-		if (linked_port) [[likely]]
-			linked_port->unlink_from(*port);
-	}
 
-	// remove it from registry_objects
-	registry_objects.ports.erase(port_it);
-	return true;
+void Core::forget_pending_links(uint32_t port_id)
+{
+	for (auto link_it = pending_links.begin(); link_it != pending_links.end();) {
+		if (uint32_t(link_it->first >> 32) == port_id || uint32_t(link_it->first) == port_id)
+			link_it = pending_links.erase(link_it);
+		else
+			++link_it;
+	}
 }
 
 
-bool Core::try_unwrap_link(uint32_t id)
+void Core::on_pending_link_removed(void *data)
 {
-	// find the link
-	auto link_it = registry_objects.links.find(id);
-	if (link_it == registry_objects.links.end())
-		return false;
+	// the link is gone from the server, or was never made, its proxy has nothing left to do
+	pw_proxy_destroy(static_cast<PendingLinkData *>(data)->proxy);
+}
 
-	LinkInfo& link = link_it->second;
 
-	// unlink its ports one from each other
-	if (link.i_port.ptr)
-		link.i_port.ptr->unlink_from_id(link.o_port.id);
-	else if (link.o_port.ptr)
-		link.o_port.ptr->unlink_from_id(link.i_port.id);
+void Core::on_pending_link_destroy(void *data)
+{
+	auto *link_data = static_cast<PendingLinkData *>(data);
+	spa_hook_remove(&link_data->listener);
+	link_data->self->routed_links.erase(link_data);
+	// a later request of the same ports has its own entry
+	auto link_it = link_data->self->pending_links.find(link_data->link_key);
+	if (link_it != link_data->self->pending_links.end() && link_it->second == pw_proxy_get_id(link_data->proxy))
+		link_data->self->pending_links.erase(link_it);
+}
+
 
-	// remove it from registry_objects
-	registry_objects.links.erase(link_it);
-	return true;
+void Core::on_pending_link_error(void *data, int seq, int res, const char *message)
+{
+	// failed to be created, may be requested again by the next flush
+	auto *link_data = static_cast<PendingLinkData *>(data);
+	auto link_it = link_data->self->pending_links.find(link_data->link_key);
+	if (link_it != link_data->self->pending_links.end() && link_it->second == pw_proxy_get_id(link_data->proxy))
+		link_data->self->pending_links.erase(link_it);
 }
 
 
@@ -489,4 +557,11 @@ pw_registry_events Core::registry_events = {
 	.global_remove = on_global_remove,
 };
 
+pw_proxy_events Core::pending_link_events = {
+	.version = PW_VERSION_PROXY_EVENTS,
+	.destroy = on_pending_link_destroy,
+	.removed = on_pending_link_removed,
+	.error = on_pending_link_error,
+};
+
 }
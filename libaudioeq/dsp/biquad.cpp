@@ -0,0 +1,14 @@
+#include <audioeq/dsp/biquad.h>
+
+
+namespace aeq::dsp {
+
+StatePrecision recommend_precision(float freq, int sample_rate)
+{
+	// below ~100 Hz at 48 kHz (~200 Hz at 96 kHz) f32 state noise and limit cycles become audible
+	if (sample_rate > 0 && freq < 0.002F * sample_rate)
+		return StatePrecision::F64;
+	return StatePrecision::F32;
+}
+
+}
@@ -0,0 +1,237 @@
+#include <audioeq/dsp/coeffs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <functional>
+
+
+namespace aeq::dsp {
+
+BiquadCoeffs design(FilterType type, float freq, float q, float gain_db, int sample_rate)
+{
+	if (sample_rate <= 0)
+		throw CoeffsErr({"Non-positive sample rate."});
+	if (freq <= 0.0F)
+		throw CoeffsErr({"Non-positive frequency."});
+
+	if (type == FilterType::OnePoleLowPass) {
+		double dt = 1.0 / sample_rate;
+		double rc = 1.0 / (2 * M_PI * freq);
+		double alpha = dt / (dt + rc);
+		return {alpha, 0.0, 0.0, alpha - 1.0, 0.0};
+	}
+
+	if (q <= 0.0F)
+		throw CoeffsErr({"Non-positive Q."});
+
+	const double w0 = 2 * M_PI * std::min<double>(freq, 0.49999 * sample_rate) / sample_rate;
+	const double cos_w0 = std::cos(w0);
+	const double alpha = std::sin(w0) / (2 * q);
+	const double A = std::pow(10.0, gain_db / 40.0);
+	const double sqrt_A_2alpha = 2 * std::sqrt(A) * alpha;
+
+	double b0, b1, b2, a0, a1, a2;
+	switch (type) {
+	case FilterType::LowPass:
+		b0 = (1 - cos_w0) / 2; b1 = 1 - cos_w0; b2 = (1 - cos_w0) / 2;
+		a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+		break;
+	case FilterType::HighPass:
+		b0 = (1 + cos_w0) / 2; b1 = -(1 + cos_w0); b2 = (1 + cos_w0) / 2;
+		a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+		break;
+	case FilterType::BandPass:
+		b0 = alpha; b1 = 0; b2 = -alpha;
+		a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+		break;
+	case FilterType::Notch:
+		b0 = 1; b1 = -2 * cos_w0; b2 = 1;
+		a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+		break;
+	case FilterType::Peaking:
+		b0 = 1 + alpha * A; b1 = -2 * cos_w0; b2 = 1 - alpha * A;
+		a0 = 1 + alpha / A; a1 = -2 * cos_w0; a2 = 1 - alpha / A;
+		break;
+	case FilterType::LowShelf:
+		b0 = A * ((A + 1) - (A - 1) * cos_w0 + sqrt_A_2alpha);
+		b1 = 2 * A * ((A - 1) - (A + 1) * cos_w0);
+		b2 = A * ((A + 1) - (A - 1) * cos_w0 - sqrt_A_2alpha);
+		a0 = (A + 1) + (A - 1) * cos_w0 + sqrt_A_2alpha;
+		a1 = -2 * ((A - 1) + (A + 1) * cos_w0);
+		a2 = (A + 1) + (A - 1) * cos_w0 - sqrt_A_2alpha;
+		break;
+	case FilterType::HighShelf:
+		b0 = A * ((A + 1) + (A - 1) * cos_w0 + sqrt_A_2alpha);
+		b1 = -2 * A * ((A - 1) + (A + 1) * cos_w0);
+		b2 = A * ((A + 1) + (A - 1) * cos_w0 - sqrt_A_2alpha);
+		a0 = (A + 1) - (A - 1) * cos_w0 + sqrt_A_2alpha;
+		a1 = 2 * ((A - 1) - (A + 1) * cos_w0);
+		a2 = (A + 1) - (A - 1) * cos_w0 - sqrt_A_2alpha;
+		break;
+	case FilterType::AllPass:
+		b0 = 1 - alpha; b1 = -2 * cos_w0; b2 = 1 + alpha;
+		a0 = 1 + alpha; a1 = -2 * cos_w0; a2 = 1 - alpha;
+		break;
+	default:
+		throw CoeffsErr({"Unknown filter type."});
+	}
+
+	return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+
+double magnitude_db(const BiquadCoeffs& c, double freq, int sample_rate)
+{
+	const std::complex<double> z1 = std::polar(1.0, -2 * M_PI * freq / sample_rate);
+	const std::complex<double> z2 = z1 * z1;
+	const std::complex<double> h = (c.b0 + c.b1 * z1 + c.b2 * z2) / (1.0 + c.a1 * z1 + c.a2 * z2);
+	return 20 * std::log10(std::max(std::abs(h), 1e-6));
+}
+
+
+CoefficientTable::CoefficientTable(FilterType type, float q, float gain_db, int sample_rate)
+	: type(type), q(q), gain_db(gain_db), sample_rate(sample_rate)
+{
+	if (sample_rate <= 0)
+		throw CoeffsErr({"Non-positive sample rate."});
+
+	max_freq = 0.5F * sample_rate;
+	if (max_freq <= min_freq)
+		return;
+
+	// whole octaves from min_freq, then the points of the octave nyquist falls in below it
+	size_t nr_octaves = 0;
+	while (min_freq * float(2 << nr_octaves) < max_freq)
+		++nr_octaves;
+	float top_octave_freq = min_freq * float(1 << nr_octaves);
+	size_t nr_top_points = size_t(std::ceil((max_freq / top_octave_freq - 1.0F) * points_per_octave));
+
+	points.resize(nr_octaves * points_per_octave + nr_top_points + 1);
+	for (size_t i = 0; i + 1 < points.size(); ++i) {
+		size_t octave = i / points_per_octave;
+		size_t k = i % points_per_octave;
+		last_grid_freq = min_freq * float(1 << octave) * (1.0F + float(k) / points_per_octave);
+		points[i] = design(type, last_grid_freq, q, gain_db, sample_rate);
+	}
+	// the last point closes the partial octave at nyquist
+	points.back() = design(type, max_freq, q, gain_db, sample_rate);
+}
+
+
+BiquadCoeffs CoefficientTable::lookup(float freq) const
+{
+	if (points.size() < 2 || !(freq >= min_freq && freq < max_freq))
+		return design(type, freq, q, gain_db, sample_rate);
+
+	// freq / min_freq = m * 2^e with m in [0.5, 1), so the octave is e - 1 and 2m - 1 is the position in it
+	int e;
+	double m = std::frexp(double(freq) / min_freq, &e);
+	double pos = (double(e - 1) + (2.0 * m - 1.0)) * points_per_octave;
+	size_t i = std::min(size_t(pos), points.size() - 2);
+	// the last segment runs from the last grid point to nyquist, narrower than the grid step
+	double t = i + 2 < points.size() ? pos - double(i)
+			: (double(freq) - last_grid_freq) / (double(max_freq) - last_grid_freq);
+
+	const BiquadCoeffs& p0 = points[i];
+	const BiquadCoeffs& p1 = points[i + 1];
+	return {
+		p0.b0 + t * (p1.b0 - p0.b0),
+		p0.b1 + t * (p1.b1 - p0.b1),
+		p0.b2 + t * (p1.b2 - p0.b2),
+		p0.a1 + t * (p1.a1 - p0.a1),
+		p0.a2 + t * (p1.a2 - p0.a2),
+	};
+}
+
+
+CoefficientTable::AccuracyReport CoefficientTable::measure_accuracy(size_t nr_probes) const
+{
+	AccuracyReport report;
+	report.nr_probes = nr_probes;
+	double sum_response_err_db = 0.0;
+
+	for (size_t i = 0; i < nr_probes; ++i) {
+		float freq = min_freq * std::pow(max_freq / min_freq, (i + 0.5F) / nr_probes);
+		BiquadCoeffs exact = design(type, freq, q, gain_db, sample_rate);
+		BiquadCoeffs approx = lookup(freq);
+
+		const double exact_c[] = {exact.b0, exact.b1, exact.b2, exact.a1, exact.a2};
+		const double approx_c[] = {approx.b0, approx.b1, approx.b2, approx.a1, approx.a2};
+		for (size_t c = 0; c < 5; ++c)
+			report.max_coeff_err = std::max(report.max_coeff_err,
+					std::fabs(exact_c[c] - approx_c[c]));
+
+		// compare the responses around the design frequency, where interpolation errors show most
+		for (double ratio : {0.5, 0.9, 1.0, 1.1, 2.0}) {
+			double probe = std::min(freq * ratio, 0.49 * sample_rate);
+			double err = std::fabs(std::max(magnitude_db(exact, probe, sample_rate), -80.0)
+					     - std::max(magnitude_db(approx, probe, sample_rate), -80.0));
+			report.max_response_err_db = std::max(report.max_response_err_db, err);
+			sum_response_err_db += err;
+		}
+	}
+	if (nr_probes > 0)
+		report.mean_response_err_db = sum_response_err_db / (nr_probes * 5);
+	return report;
+}
+
+
+float CoefficientTable::get_max_freq() const
+{
+	return max_freq;
+}
+
+
+bool CoefficientCache::Key::operator==(const Key& other) const
+{
+	return type == other.type && q == other.q && gain_db == other.gain_db
+		&& sample_rate == other.sample_rate;
+}
+
+
+size_t CoefficientCache::KeyHash::operator()(const Key& key) const
+{
+	size_t h = std::hash<int>()(static_cast<int>(key.type));
+	h = h * 31 + std::hash<float>()(key.q);
+	h = h * 31 + std::hash<float>()(key.gain_db);
+	h = h * 31 + std::hash<int>()(key.sample_rate);
+	return h;
+}
+
+
+std::shared_ptr<const CoefficientTable> CoefficientCache::get_table(FilterType type,
+		float q, float gain_db, int sample_rate)
+{
+	// parameters the type ignores must not split the cache
+	if (type == FilterType::OnePoleLowPass)
+		q = 0.0F;
+	if (type != FilterType::Peaking && type != FilterType::LowShelf && type != FilterType::HighShelf)
+		gain_db = 0.0F;
+
+	Key key {type, q, gain_db, sample_rate};
+	std::lock_guard lock {mutex};
+	auto table_it = tables.find(key);
+	if (table_it != tables.end())
+		return table_it->second;
+
+	auto table = std::make_shared<const CoefficientTable>(type, q, gain_db, sample_rate);
+	tables.emplace(key, table);
+	return table;
+}
+
+
+size_t CoefficientCache::get_nr_tables() const
+{
+	std::lock_guard lock {mutex};
+	return tables.size();
+}
+
+
+CoefficientCache& CoefficientCache::shared()
+{
+	static CoefficientCache cache;
+	return cache;
+}
+
+}
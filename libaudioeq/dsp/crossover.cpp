@@ -0,0 +1,230 @@
+#include <audioeq/dsp/crossover.h>
+#include <audioeq/dsp/kernels.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <type_traits>
+
+
+namespace aeq::dsp {
+
+namespace {
+
+/* Butterworth Q, two cascaded Butterworth sections make a Linkwitz-Riley section. */
+constexpr float butterworth_q = float(M_SQRT1_2);
+
+}
+
+
+template<typename T>
+BiquadBank<T>::BiquadBank(size_t nr_lanes)
+	: b0(nr_lanes, 1), b1(nr_lanes), b2(nr_lanes), a1(nr_lanes), a2(nr_lanes),
+	z1(nr_lanes), z2(nr_lanes) {}
+
+
+template<typename T>
+void BiquadBank<T>::set_lane(size_t lane, const BiquadCoeffs& c)
+{
+	b0[lane] = T(c.b0);
+	b1[lane] = T(c.b1);
+	b2[lane] = T(c.b2);
+	a1[lane] = T(c.a1);
+	a2[lane] = T(c.a2);
+}
+
+
+template<typename T>
+void BiquadBank<T>::reset()
+{
+	std::fill(z1.begin(), z1.end(), T(0));
+	std::fill(z2.begin(), z2.end(), T(0));
+}
+
+
+template<typename T>
+bool BiquadBank<T>::is_state_below(T threshold) const
+{
+	auto below = [threshold](T z) { return std::fabs(z) <= threshold; };
+	return std::all_of(z1.begin(), z1.end(), below) && std::all_of(z2.begin(), z2.end(), below);
+}
+
+
+template<typename T>
+void BiquadBank<T>::process(T *data, size_t stride, size_t nr_samples)
+{
+	const BiquadBankArgs<T> args {b0.data(), b1.data(), b2.data(), a1.data(), a2.data(),
+		z1.data(), z2.data(), b0.size()};
+	if constexpr (std::is_same_v<T, float>)
+		kernels().biquad_bank_f32(args, data, stride, nr_samples);
+	else
+		kernels().biquad_bank_f64(args, data, stride, nr_samples);
+}
+
+
+template<typename T>
+size_t BiquadBank<T>::get_nr_lanes() const
+{
+	return b0.size();
+}
+
+
+template<typename T>
+LRCrossover<T>::LRCrossover(const std::vector<float>& freqs, int sample_rate, unsigned int nr_channels)
+	: nr_channels(nr_channels), nr_bands(freqs.size() + 1)
+{
+	if (nr_bands < min_bands || nr_bands > max_bands)
+		throw CrossoverErr({"Crossover needs 2 to 6 bands."});
+	if (nr_channels == 0)
+		throw CrossoverErr({"Crossover without channels."});
+	if (!std::is_sorted(freqs.begin(), freqs.end(), std::less_equal<float>()))
+		throw CrossoverErr({"Crossover frequencies must be strictly increasing."});
+
+	const size_t C = nr_channels;
+	for (float freq : freqs) {
+		if (freq <= 0.0F || freq >= sample_rate / 2.0F)
+			throw CrossoverErr({"Crossover frequency out of range."});
+
+		BiquadCoeffs lp = design(FilterType::LowPass, freq, butterworth_q, 0.0F, sample_rate);
+		BiquadCoeffs hp = design(FilterType::HighPass, freq, butterworth_q, 0.0F, sample_rate);
+		Split split {BiquadBank<T>(2 * C), BiquadBank<T>(2 * C)};
+		for (size_t ch = 0; ch < C; ++ch) {
+			split.first.set_lane(2 * ch, lp);
+			split.first.set_lane(2 * ch + 1, hp);
+			split.second.set_lane(2 * ch, lp);
+			split.second.set_lane(2 * ch + 1, hp);
+		}
+		splits.push_back(std::move(split));
+	}
+
+	// the allpass of split j equals the sum of its low and high pass
+	for (size_t j = 1; j < freqs.size(); ++j) {
+		BiquadCoeffs ap = design(FilterType::AllPass, freqs[j], butterworth_q, 0.0F, sample_rate);
+		BiquadBank<T> bank(j * C);
+		for (size_t lane = 0; lane < j * C; ++lane)
+			bank.set_lane(lane, ap);
+		allpasses.push_back(std::move(bank));
+	}
+
+	split_buf.resize(block_size * 2 * C);
+	band_buf.resize(block_size * (nr_bands - 1) * C);
+}
+
+
+template<typename T>
+void LRCrossover<T>::process(const float *const *in, float *const *out, size_t nr_samples)
+{
+	for (size_t offset = 0; offset < nr_samples; offset += block_size)
+		process_block(in, out, offset, std::min(block_size, nr_samples - offset));
+}
+
+
+template<typename T>
+void LRCrossover<T>::process_block(const float *const *in, float *const *out, size_t offset, size_t nr_samples)
+{
+	const size_t C = nr_channels;
+	const size_t split_stride = 2 * C;
+	const size_t band_stride = (nr_bands - 1) * C;
+	const size_t last_split = splits.size() - 1;
+
+	// the input of the first split feeds both its low and high pass lanes
+	for (size_t ch = 0; ch < C; ++ch) {
+		const float *in_buf = in[ch] ? in[ch] + offset : nullptr;
+		for (size_t i = 0; i < nr_samples; ++i) {
+			const T x = in_buf ? T(in_buf[i]) : T(0);
+			split_buf[i * split_stride + 2 * ch] = x;
+			split_buf[i * split_stride + 2 * ch + 1] = x;
+		}
+	}
+
+	for (size_t k = 0; k <= last_split; ++k) {
+		splits[k].first.process(split_buf.data(), split_stride, nr_samples);
+		splits[k].second.process(split_buf.data(), split_stride, nr_samples);
+
+		for (size_t i = 0; i < nr_samples; ++i) {
+			T *frame = &split_buf[i * split_stride];
+			T *band_frame = &band_buf[i * band_stride + k * C];
+			for (size_t ch = 0; ch < C; ++ch) {
+				// the low band is done but for the allpasses of the splits above
+				band_frame[ch] = frame[2 * ch];
+				// the high band feeds both lanes of the next split
+				if (k < last_split)
+					frame[2 * ch] = frame[2 * ch + 1];
+			}
+		}
+	}
+
+	// the top band needs no allpass, it went through every split
+	for (size_t ch = 0; ch < C; ++ch) {
+		float *out_buf = out[(nr_bands - 1) * C + ch];
+		if (out_buf == nullptr)
+			continue;
+		out_buf += offset;
+		for (size_t i = 0; i < nr_samples; ++i)
+			out_buf[i] = float(split_buf[i * split_stride + 2 * ch + 1]);
+	}
+
+	// band k is delayed by the allpasses of splits k + 1 and up, which lead its lanes
+	for (auto& allpass : allpasses)
+		allpass.process(band_buf.data(), band_stride, nr_samples);
+
+	for (size_t k = 0; k + 1 < nr_bands; ++k) {
+		for (size_t ch = 0; ch < C; ++ch) {
+			float *out_buf = out[k * C + ch];
+			if (out_buf == nullptr)
+				continue;
+			out_buf += offset;
+			for (size_t i = 0; i < nr_samples; ++i)
+				out_buf[i] = float(band_buf[i * band_stride + k * C + ch]);
+		}
+	}
+}
+
+
+template<typename T>
+void LRCrossover<T>::reset()
+{
+	for (auto& split : splits) {
+		split.first.reset();
+		split.second.reset();
+	}
+	for (auto& allpass : allpasses)
+		allpass.reset();
+}
+
+
+template<typename T>
+bool LRCrossover<T>::is_state_below(float threshold) const
+{
+	for (const auto& split : splits) {
+		if (!split.first.is_state_below(T(threshold)) || !split.second.is_state_below(T(threshold)))
+			return false;
+	}
+	for (const auto& allpass : allpasses) {
+		if (!allpass.is_state_below(T(threshold)))
+			return false;
+	}
+	return true;
+}
+
+
+template<typename T>
+size_t LRCrossover<T>::get_nr_bands() const
+{
+	return nr_bands;
+}
+
+
+template<typename T>
+unsigned int LRCrossover<T>::get_nr_channels() const
+{
+	return nr_channels;
+}
+
+
+template class BiquadBank<float>;
+template class BiquadBank<double>;
+template class LRCrossover<float>;
+template class LRCrossover<double>;
+
+}
@@ -0,0 +1,220 @@
+#include <audioeq/dsp/dynamic_eq.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace aeq::dsp {
+
+namespace {
+
+/* Floor of the envelope in the gain computation, -200 dB. */
+constexpr double min_env = 1e-10;
+
+/* One-pole smoothing coefficient of given time constant. */
+double smoothing_coeff(float time_ms, int sample_rate)
+{
+	return 1.0 - std::exp(-1000.0 / (double(time_ms) * sample_rate));
+}
+
+}
+
+
+template<typename T>
+DynamicEq<T>::DynamicEq(const std::vector<DynamicBand>& bands, int sample_rate, unsigned int nr_channels)
+	: nr_channels(nr_channels), nr_bands(bands.size()), sample_rate(sample_rate), bands(bands),
+	band_passes(bands.size() * nr_channels)
+{
+	if (bands.empty() || nr_bands > max_bands)
+		throw DynamicEqErr({"Dynamic equalizer needs 1 to 8 bands."});
+	if (nr_channels == 0)
+		throw DynamicEqErr({"Dynamic equalizer without channels."});
+
+	const size_t nr_lanes = nr_bands * nr_channels;
+	attack_coeffs.resize(nr_lanes);
+	release_coeffs.resize(nr_lanes);
+	for (size_t b = 0; b < nr_bands; ++b) {
+		const DynamicBand& band = bands[b];
+		if (band.freq <= 0.0F || band.freq >= sample_rate / 2.0F)
+			throw DynamicEqErr({"Dynamic band frequency out of range."});
+		if (band.q <= 0.0F)
+			throw DynamicEqErr({"Non-positive dynamic band Q."});
+		if (band.ratio < 1.0F)
+			throw DynamicEqErr({"Dynamic band ratio below 1."});
+		if (band.attack_ms <= 0.0F || band.release_ms <= 0.0F)
+			throw DynamicEqErr({"Non-positive dynamic band attack or release."});
+		configure_band(b);
+	}
+
+	envs.resize(nr_lanes);
+	mixes.resize(nr_lanes);
+	mix_steps.resize(nr_lanes);
+	band_buf.resize(block_size * nr_lanes);
+}
+
+
+template<typename T>
+void DynamicEq<T>::configure_band(size_t b)
+{
+	const DynamicBand& band = bands[b];
+	BiquadCoeffs band_pass = design(FilterType::BandPass, band.freq, band.q, 0.0F, sample_rate);
+	const T attack = T(smoothing_coeff(band.attack_ms, sample_rate));
+	const T release = T(smoothing_coeff(band.release_ms, sample_rate));
+	for (size_t ch = 0; ch < nr_channels; ++ch) {
+		const size_t lane = b * nr_channels + ch;
+		band_passes.set_lane(lane, band_pass);
+		attack_coeffs[lane] = attack;
+		release_coeffs[lane] = release;
+	}
+}
+
+
+template<typename T>
+void DynamicEq<T>::set_band(size_t b, const DynamicBand& settings)
+{
+	DynamicBand& band = bands[b];
+	band = settings;
+	band.freq = std::clamp(band.freq, 1.0F, 0.49F * sample_rate);
+	band.q = std::max(band.q, 0.05F);
+	band.ratio = std::max(band.ratio, 1.0F);
+	band.attack_ms = std::max(band.attack_ms, 0.01F);
+	band.release_ms = std::max(band.release_ms, 0.01F);
+	configure_band(b);
+}
+
+
+template<typename T>
+const DynamicBand& DynamicEq<T>::get_band(size_t b) const
+{
+	return bands[b];
+}
+
+
+template<typename T>
+void DynamicEq<T>::process(const float *const *in, float *const *out, size_t nr_samples)
+{
+	for (size_t offset = 0; offset < nr_samples; offset += block_size)
+		process_block(in, out, offset, std::min(block_size, nr_samples - offset));
+}
+
+
+template<typename T>
+void DynamicEq<T>::process_block(const float *const *in, float *const *out, size_t offset, size_t nr_samples)
+{
+	const size_t C = nr_channels;
+	const size_t nr_lanes = nr_bands * C;
+
+	// every band of a channel starts from the dry input
+	for (size_t ch = 0; ch < C; ++ch) {
+		const float *in_buf = in[ch] ? in[ch] + offset : nullptr;
+		for (size_t i = 0; i < nr_samples; ++i) {
+			const T x = in_buf ? T(in_buf[i]) : T(0);
+			for (size_t b = 0; b < nr_bands; ++b)
+				band_buf[i * nr_lanes + b * C + ch] = x;
+		}
+	}
+
+	band_passes.process(band_buf.data(), nr_lanes, nr_samples);
+
+	for (size_t start = 0; start < nr_samples; start += control_interval) {
+		const size_t end = std::min(nr_samples, start + control_interval);
+
+		// peak followers with separate attack and release, a select rather than a branch per lane
+		for (size_t i = start; i < end; ++i) {
+			const T *frame = &band_buf[i * nr_lanes];
+			for (size_t lane = 0; lane < nr_lanes; ++lane) {
+				const T level = std::fabs(frame[lane]);
+				const T env = envs[lane];
+				const T coeff = level > env ? attack_coeffs[lane] : release_coeffs[lane];
+				envs[lane] = env + coeff * (level - env);
+			}
+		}
+
+		// the mix coefficient ramps to the gain of the envelope at the end of the interval
+		for (size_t lane = 0; lane < nr_lanes; ++lane) {
+			const T target = T(std::pow(T(10), gain_db(lane, envs[lane]) / T(20))) - T(1);
+			mix_steps[lane] = (target - mixes[lane]) / T(end - start);
+		}
+		for (size_t i = start; i < end; ++i) {
+			T *frame = &band_buf[i * nr_lanes];
+			for (size_t lane = 0; lane < nr_lanes; ++lane) {
+				mixes[lane] += mix_steps[lane];
+				frame[lane] *= mixes[lane];
+			}
+		}
+	}
+
+	for (size_t ch = 0; ch < C; ++ch) {
+		float *out_buf = out[ch];
+		if (out_buf == nullptr)
+			continue;
+		out_buf += offset;
+		const float *in_buf = in[ch] ? in[ch] + offset : nullptr;
+		for (size_t i = 0; i < nr_samples; ++i) {
+			T y = in_buf ? T(in_buf[i]) : T(0);
+			for (size_t b = 0; b < nr_bands; ++b)
+				y += band_buf[i * nr_lanes + b * C + ch];
+			out_buf[i] = float(y);
+		}
+	}
+}
+
+
+template<typename T>
+T DynamicEq<T>::gain_db(size_t lane, T env) const
+{
+	const DynamicBand& band = bands[lane / nr_channels];
+	const T over = T(20) * std::log10(std::max(env, T(min_env))) - T(band.threshold_db);
+	if (over <= T(0))
+		return T(0);
+	const T gain = over * (T(1) - T(1) / T(band.ratio));
+	return band.range_db < 0.0F ? -std::min(gain, T(-band.range_db)) : std::min(gain, T(band.range_db));
+}
+
+
+template<typename T>
+void DynamicEq<T>::reset()
+{
+	band_passes.reset();
+	std::fill(envs.begin(), envs.end(), T(0));
+	std::fill(mixes.begin(), mixes.end(), T(0));
+	std::fill(mix_steps.begin(), mix_steps.end(), T(0));
+}
+
+
+template<typename T>
+bool DynamicEq<T>::is_state_below(float threshold) const
+{
+	auto below = [threshold](T value) { return std::fabs(value) <= T(threshold); };
+	return band_passes.is_state_below(T(threshold))
+		&& std::all_of(envs.begin(), envs.end(), below)
+		&& std::all_of(mixes.begin(), mixes.end(), below)
+		&& std::all_of(mix_steps.begin(), mix_steps.end(), below);
+}
+
+
+template<typename T>
+float DynamicEq<T>::get_gain_db(size_t band, unsigned int channel) const
+{
+	return float(20.0 * std::log10(1.0 + double(mixes[band * nr_channels + channel])));
+}
+
+
+template<typename T>
+size_t DynamicEq<T>::get_nr_bands() const
+{
+	return nr_bands;
+}
+
+
+template<typename T>
+unsigned int DynamicEq<T>::get_nr_channels() const
+{
+	return nr_channels;
+}
+
+
+template class DynamicEq<float>;
+template class DynamicEq<double>;
+
+}
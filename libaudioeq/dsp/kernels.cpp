@@ -0,0 +1,565 @@
+#include <audioeq/dsp/kernels.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#define AEQ_ISA_X86 1
+#elif defined(__aarch64__)
+#define AEQ_ISA_ARM64 1
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/* Kernel bodies are templates forced inline into one wrapper per level, the wrapper's target
+ * attribute then decides the instructions. Unlike per-file compile flags, no inline function
+ * built for a higher level can leak to the baseline code through the linker. */
+#define AEQ_KERNEL_INLINE inline __attribute__((always_inline))
+
+
+namespace aeq::dsp {
+
+namespace {
+
+AEQ_KERNEL_INLINE void one_pole_serial(const float *in, float *out, size_t nr_samples,
+		float alpha, float& last_out)
+{
+	// each input sample is read before the output sample at the same index is written
+	float y = last_out;
+	for (size_t i = 0; i < nr_samples; ++i) {
+		y = alpha * in[i] + (1.0F - alpha) * y;
+		out[i] = y;
+	}
+	last_out = y;
+}
+
+
+/* Generic vector of W floats. */
+template<size_t W>
+struct FloatVec;
+template<>
+struct FloatVec<4> { typedef float type __attribute__((vector_size(16))); };
+template<>
+struct FloatVec<8> { typedef float type __attribute__((vector_size(32))); };
+template<>
+struct FloatVec<16> { typedef float type __attribute__((vector_size(64))); };
+
+
+/* One-pole low pass W samples at a time. With c = 1 - alpha, sample k of a block is
+ *   c^(k+1) * y + sum over j <= k of alpha * c^(k-j) * in[j]
+ * where y is the last output of the previous block. The sums over the input don't depend on y,
+ * so the blocks overlap in the pipeline and only one multiply-add per block is serial.
+ * Written with generic vectors, which the target of the caller maps to its registers. */
+template<size_t W>
+AEQ_KERNEL_INLINE void one_pole_blocked(const float *in, float *out, size_t nr_samples,
+		float alpha, float& last_out)
+{
+	typedef typename FloatVec<W>::type Vec;
+
+	// taps[j][k] weighs in[j] into sample k
+	Vec taps[W];
+	Vec pows;
+	double c = 1.0 - double(alpha);
+	double c_pow = 1.0;
+	for (size_t k = 0; k < W; ++k) {
+		for (size_t j = 0; j < W; ++j)
+			taps[j][k] = 0.0F;
+	}
+	for (size_t d = 0; d < W; ++d) {
+		for (size_t j = 0; j + d < W; ++j)
+			taps[j][j + d] = float(alpha * c_pow);
+		c_pow *= c;
+		pows[d] = float(c_pow);
+	}
+
+	float y = last_out;
+	size_t i = 0;
+	for (; i + W <= nr_samples; i += W) {
+		// two accumulators halve the chain of dependent additions
+		Vec acc_even = taps[0] * in[i];
+		Vec acc_odd = taps[1] * in[i + 1];
+		for (size_t j = 2; j < W; j += 2) {
+			acc_even += taps[j] * in[i + j];
+			acc_odd += taps[j + 1] * in[i + j + 1];
+		}
+		Vec acc = acc_even + acc_odd + pows * y;
+		std::memcpy(out + i, &acc, sizeof(acc));
+		y = acc[W - 1];
+	}
+	one_pole_serial(in + i, out + i, nr_samples - i, alpha, y);
+	last_out = y;
+}
+
+
+/* Transposed direct form II, vectorized across lanes. */
+template<typename T>
+AEQ_KERNEL_INLINE void biquad_bank(const BiquadBankArgs<T>& args, T *data, size_t stride, size_t nr_samples)
+{
+	const size_t nr_lanes = args.nr_lanes;
+	const T *__restrict b0 = args.b0;
+	const T *__restrict b1 = args.b1;
+	const T *__restrict b2 = args.b2;
+	const T *__restrict a1 = args.a1;
+	const T *__restrict a2 = args.a2;
+	T *__restrict z1 = args.z1;
+	T *__restrict z2 = args.z2;
+
+	for (size_t i = 0; i < nr_samples; ++i) {
+		T *__restrict frame = data + i * stride;
+		for (size_t l = 0; l < nr_lanes; ++l) {
+			const T x = frame[l];
+			const T y = b0[l] * x + z1[l];
+			z1[l] = b1[l] * x - a1[l] * y + z2[l];
+			z2[l] = b2[l] * x - a2[l] * y;
+			frame[l] = y;
+		}
+	}
+}
+
+
+/* Reference: same loops, one lane at a time. */
+template<typename T>
+AEQ_KERNEL_INLINE void biquad_bank_serial(const BiquadBankArgs<T>& args, T *data, size_t stride, size_t nr_samples)
+{
+	for (size_t l = 0; l < args.nr_lanes; ++l) {
+		T z1 = args.z1[l], z2 = args.z2[l];
+		for (size_t i = 0; i < nr_samples; ++i) {
+			const T x = data[i * stride + l];
+			const T y = args.b0[l] * x + z1;
+			z1 = args.b1[l] * x - args.a1[l] * y + z2;
+			z2 = args.b2[l] * x - args.a2[l] * y;
+			data[i * stride + l] = y;
+		}
+		args.z1[l] = z1;
+		args.z2[l] = z2;
+	}
+}
+
+
+template<typename S>
+AEQ_KERNEL_INLINE float sample_to_float(S x)
+{
+	if constexpr (std::is_same_v<S, int16_t>)
+		return float(x) * (1.0F / 32768.0F);
+	else if constexpr (std::is_same_v<S, int32_t>)
+		return float(x) * (1.0F / 2147483648.0F);
+	else
+		return x;
+}
+
+
+/* Clip and round half away from zero. Truncating conversions vectorize on every level,
+ * lrint only with -fno-math-errno. */
+template<typename S>
+AEQ_KERNEL_INLINE S float_to_sample(float x)
+{
+	if constexpr (std::is_same_v<S, int16_t>) {
+		float v = std::min(std::max(x * 32768.0F, -32768.0F), 32767.0F);
+		return S(int32_t(v + (v < 0.0F ? -0.5F : 0.5F)));
+	} else if constexpr (std::is_same_v<S, int32_t>) {
+		// the largest float below 2^31
+		float v = std::min(std::max(x * 2147483648.0F, -2147483648.0F), 2147483520.0F);
+		return S(v + (v < 0.0F ? -0.5F : 0.5F));
+	} else {
+		return x;
+	}
+}
+
+
+/* Mono and stereo get loops of their own, which vectorize with fixed strides. */
+template<typename S>
+AEQ_KERNEL_INLINE void deinterleave_as(const S *__restrict in, float *const *out, unsigned int nr_channels,
+		size_t nr_frames)
+{
+	if (nr_channels == 1) {
+		float *__restrict mono = out[0];
+		for (size_t i = 0; i < nr_frames; ++i)
+			mono[i] = sample_to_float(in[i]);
+	} else if (nr_channels == 2) {
+		float *__restrict left = out[0];
+		float *__restrict right = out[1];
+		for (size_t i = 0; i < nr_frames; ++i) {
+			left[i] = sample_to_float(in[2 * i]);
+			right[i] = sample_to_float(in[2 * i + 1]);
+		}
+	} else {
+		for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+			float *__restrict channel = out[ch];
+			for (size_t i = 0; i < nr_frames; ++i)
+				channel[i] = sample_to_float(in[i * nr_channels + ch]);
+		}
+	}
+}
+
+
+template<typename S>
+AEQ_KERNEL_INLINE void interleave_as(const float *const *in, S *__restrict out, unsigned int nr_channels,
+		size_t nr_frames)
+{
+	if (nr_channels == 1) {
+		const float *__restrict mono = in[0];
+		for (size_t i = 0; i < nr_frames; ++i)
+			out[i] = float_to_sample<S>(mono[i]);
+	} else if (nr_channels == 2) {
+		const float *__restrict left = in[0];
+		const float *__restrict right = in[1];
+		for (size_t i = 0; i < nr_frames; ++i) {
+			out[2 * i] = float_to_sample<S>(left[i]);
+			out[2 * i + 1] = float_to_sample<S>(right[i]);
+		}
+	} else {
+		for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+			const float *__restrict channel = in[ch];
+			for (size_t i = 0; i < nr_frames; ++i)
+				out[i * nr_channels + ch] = float_to_sample<S>(channel[i]);
+		}
+	}
+}
+
+
+AEQ_KERNEL_INLINE void deinterleave_pcm(PcmFormat format, const void *in, float *const *out,
+		unsigned int nr_channels, size_t nr_frames)
+{
+	switch (format) {
+	case PcmFormat::F32:
+		deinterleave_as(static_cast<const float *>(in), out, nr_channels, nr_frames);
+		break;
+	case PcmFormat::S16:
+		deinterleave_as(static_cast<const int16_t *>(in), out, nr_channels, nr_frames);
+		break;
+	case PcmFormat::S32:
+		deinterleave_as(static_cast<const int32_t *>(in), out, nr_channels, nr_frames);
+		break;
+	}
+}
+
+
+AEQ_KERNEL_INLINE void interleave_pcm(PcmFormat format, const float *const *in, void *out,
+		unsigned int nr_channels, size_t nr_frames)
+{
+	switch (format) {
+	case PcmFormat::F32:
+		interleave_as(in, static_cast<float *>(out), nr_channels, nr_frames);
+		break;
+	case PcmFormat::S16:
+		interleave_as(in, static_cast<int16_t *>(out), nr_channels, nr_frames);
+		break;
+	case PcmFormat::S32:
+		interleave_as(in, static_cast<int32_t *>(out), nr_channels, nr_frames);
+		break;
+	}
+}
+
+
+/* Reference: one entry at a time over the whole call. */
+AEQ_KERNEL_INLINE void mix_matrix_serial(const MixMatrixArgs& args, size_t offset, size_t nr_samples)
+{
+	for (size_t o = 0; o < args.nr_outputs; ++o) {
+		float *out = args.out[o];
+		if (out == nullptr)
+			continue;
+		out += offset;
+		std::fill_n(out, nr_samples, 0.0F);
+		for (uint32_t e = args.starts[o]; e < args.starts[o + 1]; ++e) {
+			const MixEntry& entry = args.entries[e];
+			const float *in = args.in[entry.input] + offset;
+			for (size_t i = 0; i < nr_samples; ++i)
+				out[i] += (entry.gain + entry.step * float(i + 1)) * in[i];
+		}
+	}
+}
+
+
+/* Matrix mixing as a small sparse GEMM: a block of an output stays in registers while every entry
+ * of the output is added in, so each output sample is stored once and each entry costs one load
+ * and one multiply-add per vector. Zero entries are not in the list at all.
+ * A block is as many vectors as leave registers for the operands, 64 samples from AVX2 up: the
+ * lookup of an entry's input is then paid once per quantum of 64 frames. The loops over the
+ * vectors of a block are unrolled, or the accumulators would live in memory. */
+template<size_t W>
+AEQ_KERNEL_INLINE void mix_matrix_blocked(const MixMatrixArgs& args, size_t offset, size_t nr_samples)
+{
+	typedef typename FloatVec<W>::type Vec;
+	constexpr size_t nr_vecs = W == 4 ? 8 : 64 / W;
+	constexpr size_t block = nr_vecs * W;
+
+	// ramp positions of a vector relative to its first sample
+	Vec lanes;
+	for (size_t j = 0; j < W; ++j)
+		lanes[j] = float(j + 1);
+
+	for (size_t o = 0; o < args.nr_outputs; ++o) {
+		float *out = args.out[o];
+		if (out == nullptr)
+			continue;
+		out += offset;
+		const MixEntry *first = args.entries + args.starts[o];
+		const MixEntry *last = args.entries + args.starts[o + 1];
+
+		// a branch per entry would have the loads hoisted above it and spilled
+		const bool ramping = std::any_of(first, last, [](const MixEntry& entry) { return entry.step != 0.0F; });
+
+		size_t i = 0;
+		for (; i + block <= nr_samples; i += block) {
+			Vec acc[nr_vecs] = {};
+			if (!ramping) {
+				for (const MixEntry *entry = first; entry != last; ++entry) {
+					const float *in = args.in[entry->input] + offset + i;
+#pragma GCC unroll 8
+					for (size_t k = 0; k < nr_vecs; ++k) {
+						Vec x;
+						std::memcpy(&x, in + k * W, sizeof(Vec));
+						acc[k] += entry->gain * x;
+					}
+				}
+			} else {
+				for (const MixEntry *entry = first; entry != last; ++entry) {
+					const float *in = args.in[entry->input] + offset + i;
+#pragma GCC unroll 8
+					for (size_t k = 0; k < nr_vecs; ++k) {
+						Vec x;
+						std::memcpy(&x, in + k * W, sizeof(Vec));
+						acc[k] += (entry->gain + entry->step * (float(i + k * W) + lanes)) * x;
+					}
+				}
+			}
+#pragma GCC unroll 8
+			for (size_t k = 0; k < nr_vecs; ++k)
+				std::memcpy(out + i + k * W, &acc[k], sizeof(Vec));
+		}
+		// ramps may end anywhere in a quantum, the rest goes a vector at a time
+		for (; i + W <= nr_samples; i += W) {
+			Vec acc = {};
+			for (const MixEntry *entry = first; entry != last; ++entry) {
+				Vec x;
+				std::memcpy(&x, args.in[entry->input] + offset + i, sizeof(Vec));
+				acc += (entry->gain + entry->step * (float(i) + lanes)) * x;
+			}
+			std::memcpy(out + i, &acc, sizeof(Vec));
+		}
+		for (; i < nr_samples; ++i) {
+			float y = 0.0F;
+			for (const MixEntry *entry = first; entry != last; ++entry)
+				y += (entry->gain + entry->step * float(i + 1)) * args.in[entry->input][offset + i];
+			out[i] = y;
+		}
+	}
+}
+
+
+#define AEQ_DEFINE_KERNELS(suffix, target_attr, width, bank_f32, bank_f64) \
+	target_attr void one_pole_low_pass_##suffix(const float *in, float *out, size_t nr_samples, \
+			float alpha, float& last_out) \
+	{ \
+		one_pole_blocked<width>(in, out, nr_samples, alpha, last_out); \
+	} \
+	target_attr void biquad_bank_f32_##suffix(const BiquadBankArgs<float>& args, float *data, \
+			size_t stride, size_t nr_samples) \
+	{ \
+		bank_f32(args, data, stride, nr_samples); \
+	} \
+	target_attr void biquad_bank_f64_##suffix(const BiquadBankArgs<double>& args, double *data, \
+			size_t stride, size_t nr_samples) \
+	{ \
+		bank_f64(args, data, stride, nr_samples); \
+	} \
+	target_attr void deinterleave_##suffix(PcmFormat format, const void *in, float *const *out, \
+			unsigned int nr_channels, size_t nr_frames) \
+	{ \
+		deinterleave_pcm(format, in, out, nr_channels, nr_frames); \
+	} \
+	target_attr void interleave_##suffix(PcmFormat format, const float *const *in, void *out, \
+			unsigned int nr_channels, size_t nr_frames) \
+	{ \
+		interleave_pcm(format, in, out, nr_channels, nr_frames); \
+	} \
+	target_attr void mix_matrix_##suffix(const MixMatrixArgs& args, size_t offset, size_t nr_samples) \
+	{ \
+		mix_matrix_blocked<width>(args, offset, nr_samples); \
+	}
+
+
+void one_pole_low_pass_scalar(const float *in, float *out, size_t nr_samples, float alpha, float& last_out)
+{
+	one_pole_serial(in, out, nr_samples, alpha, last_out);
+}
+
+void biquad_bank_f32_scalar(const BiquadBankArgs<float>& args, float *data, size_t stride, size_t nr_samples)
+{
+	biquad_bank_serial(args, data, stride, nr_samples);
+}
+
+void biquad_bank_f64_scalar(const BiquadBankArgs<double>& args, double *data, size_t stride, size_t nr_samples)
+{
+	biquad_bank_serial(args, data, stride, nr_samples);
+}
+
+void deinterleave_scalar(PcmFormat format, const void *in, float *const *out, unsigned int nr_channels,
+		size_t nr_frames)
+{
+	deinterleave_pcm(format, in, out, nr_channels, nr_frames);
+}
+
+void interleave_scalar(PcmFormat format, const float *const *in, void *out, unsigned int nr_channels,
+		size_t nr_frames)
+{
+	interleave_pcm(format, in, out, nr_channels, nr_frames);
+}
+
+void mix_matrix_scalar(const MixMatrixArgs& args, size_t offset, size_t nr_samples)
+{
+	mix_matrix_serial(args, offset, nr_samples);
+}
+
+const Kernels scalar_kernels {Isa::Scalar, one_pole_low_pass_scalar, biquad_bank_f32_scalar, biquad_bank_f64_scalar,
+	deinterleave_scalar, interleave_scalar, mix_matrix_scalar};
+
+#if defined(AEQ_ISA_X86)
+AEQ_DEFINE_KERNELS(sse2, , 4, biquad_bank<float>, biquad_bank<double>)
+AEQ_DEFINE_KERNELS(avx2, __attribute__((target("avx2,fma"))), 8, biquad_bank<float>, biquad_bank<double>)
+AEQ_DEFINE_KERNELS(avx512, __attribute__((target("avx512f,avx2,fma"))), 16, biquad_bank<float>, biquad_bank<double>)
+
+const Kernels sse2_kernels {Isa::Sse2, one_pole_low_pass_sse2, biquad_bank_f32_sse2, biquad_bank_f64_sse2,
+	deinterleave_sse2, interleave_sse2, mix_matrix_sse2};
+const Kernels avx2_kernels {Isa::Avx2, one_pole_low_pass_avx2, biquad_bank_f32_avx2, biquad_bank_f64_avx2,
+	deinterleave_avx2, interleave_avx2, mix_matrix_avx2};
+const Kernels avx512_kernels {Isa::Avx512, one_pole_low_pass_avx512, biquad_bank_f32_avx512, biquad_bank_f64_avx512,
+	deinterleave_avx512, interleave_avx512, mix_matrix_avx512};
+#elif defined(AEQ_ISA_ARM64)
+AEQ_DEFINE_KERNELS(neon, , 4, biquad_bank<float>, biquad_bank<double>)
+
+const Kernels neon_kernels {Isa::Neon, one_pole_low_pass_neon, biquad_bank_f32_neon, biquad_bank_f64_neon,
+	deinterleave_neon, interleave_neon, mix_matrix_neon};
+#endif
+
+
+const Kernels *kernels_of(Isa isa)
+{
+	switch (isa) {
+	case Isa::Scalar:
+		return &scalar_kernels;
+#if defined(AEQ_ISA_X86)
+	case Isa::Sse2:
+		return &sse2_kernels;
+	case Isa::Avx2:
+		return &avx2_kernels;
+	case Isa::Avx512:
+		return &avx512_kernels;
+#elif defined(AEQ_ISA_ARM64)
+	case Isa::Neon:
+		return &neon_kernels;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+
+const Kernels *select_kernels()
+{
+	Isa isa = detect_isa();
+	const char *name = std::getenv("AUDIOEQ_ISA");
+	Isa forced;
+	if (name != nullptr && parse_isa(name, forced) && is_isa_supported(forced))
+		isa = forced;
+	return kernels_of(isa);
+}
+
+
+std::atomic<const Kernels *>& current_kernels()
+{
+	static std::atomic<const Kernels *> current {select_kernels()};
+	return current;
+}
+
+const char *const isa_names[] = {"scalar", "sse2", "avx2", "avx512", "neon"};
+
+}
+
+
+const Kernels& kernels()
+{
+	return *current_kernels().load(std::memory_order_relaxed);
+}
+
+
+Isa detect_isa()
+{
+#if defined(AEQ_ISA_X86)
+	if (is_isa_supported(Isa::Avx512))
+		return Isa::Avx512;
+	if (is_isa_supported(Isa::Avx2))
+		return Isa::Avx2;
+	return Isa::Sse2;
+#elif defined(AEQ_ISA_ARM64)
+	if (is_isa_supported(Isa::Neon))
+		return Isa::Neon;
+	return Isa::Scalar;
+#else
+	return Isa::Scalar;
+#endif
+}
+
+
+bool is_isa_supported(Isa isa)
+{
+	switch (isa) {
+	case Isa::Scalar:
+		return true;
+#if defined(AEQ_ISA_X86)
+	case Isa::Sse2:
+		return true;
+	case Isa::Avx2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	case Isa::Avx512:
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")
+			&& __builtin_cpu_supports("fma");
+#elif defined(AEQ_ISA_ARM64)
+	case Isa::Neon:
+		return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#endif
+	default:
+		return false;
+	}
+}
+
+
+bool force_isa(Isa isa)
+{
+	if (!is_isa_supported(isa))
+		return false;
+	current_kernels().store(kernels_of(isa), std::memory_order_relaxed);
+	return true;
+}
+
+
+const char *isa_name(Isa isa)
+{
+	return isa_names[static_cast<size_t>(isa)];
+}
+
+
+bool parse_isa(const char *name, Isa& isa)
+{
+	for (size_t i = 0; i < std::size(isa_names); ++i) {
+		if (std::strcmp(name, isa_names[i]) == 0) {
+			isa = static_cast<Isa>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+namespace {
+
+/* Select at load time, not in the first RT callback. */
+[[maybe_unused]] const Kernels& startup_kernels = kernels();
+
+}
+
+}
@@ -0,0 +1,46 @@
+#include <audioeq/dsp/pcm.h>
+
+#include <cstring>
+#include <iterator>
+
+
+namespace aeq::dsp {
+
+namespace {
+
+const char *const format_names[] = {"f32", "s16", "s32"};
+
+}
+
+
+size_t get_sample_size(PcmFormat format)
+{
+	switch (format) {
+	case PcmFormat::S16:
+		return sizeof(int16_t);
+	case PcmFormat::S32:
+		return sizeof(int32_t);
+	default:
+		return sizeof(float);
+	}
+}
+
+
+const char *pcm_format_name(PcmFormat format)
+{
+	return format_names[static_cast<size_t>(format)];
+}
+
+
+bool parse_pcm_format(const char *name, PcmFormat& format)
+{
+	for (size_t i = 0; i < std::size(format_names); ++i) {
+		if (std::strcmp(name, format_names[i]) == 0) {
+			format = static_cast<PcmFormat>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+}
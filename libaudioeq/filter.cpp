@@ -1,13 +1,48 @@
 #include <audioeq/filter.h>
+#include <audioeq/core.h>
+#include <audioeq/filter_host.h>
+#include <audioeq/trace.h>
 
 #include <spa/pod/builder.h>
 #include <spa/param/latency-utils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 
 namespace aeq {
 
+namespace {
+
+/* Read instead of missing inputs by every filter. */
+alignas(64) const float silence[Filter::max_quantum] = {};
+
+bool are_buffers_silent(const std::vector<float *>& buffers, size_t nr_samples, float threshold)
+{
+	for (auto buffer : buffers) {
+		if (buffer == nullptr)
+			continue;
+		for (size_t i = 0; i < nr_samples; ++i) {
+			if (std::fabs(buffer[i]) > threshold)
+				return false;
+		}
+	}
+	return true;
+}
+
+}
+
+
 Filter::~Filter()
 {
+	if (host) {
+		// the subclass is gone by now, a quantum dispatched by the host would run a dead object
+		std::fprintf(stderr, "Hosted filter destroyed before FilterHost::remove_filter.\n");
+		std::abort();
+	}
 	if (filter) {
 		disconnect();
 		pw_filter_destroy(filter);
@@ -15,11 +50,92 @@ Filter::~Filter()
 }
 
 
+void Filter::attach_tap(TapPoint point, AnalysisTap *tap)
+{
+	taps[static_cast<int>(point)].store(tap, std::memory_order_release);
+}
+
+
+void Filter::attach_capture(CaptureTap *capture)
+{
+	this->capture.store(capture, std::memory_order_release);
+}
+
+
+void Filter::attach_param_surface(ParamSurface *surface)
+{
+	param_surface.store(surface, std::memory_order_release);
+}
+
+
+std::vector<ParamInfo> Filter::get_params() const
+{
+	return {};
+}
+
+
+void Filter::set_silence_detection(bool enabled, float threshold, BypassMode mode)
+{
+	silence_threshold.store(threshold, std::memory_order_relaxed);
+	bypass_mode.store(mode, std::memory_order_relaxed);
+	silence_detection.store(enabled, std::memory_order_release);
+}
+
+
+uint64_t Filter::get_nr_processed_quanta() const
+{
+	return nr_processed_quanta.load(std::memory_order_relaxed);
+}
+
+
+uint64_t Filter::get_nr_skipped_quanta() const
+{
+	return nr_skipped_quanta.load(std::memory_order_relaxed);
+}
+
+
+void Filter::init_detached()
+{
+	if (filter || detached)
+		throw FilterErr({"Filter is already initialized."});
+	detached = true;
+	core_init(nullptr);
+}
+
+
+void Filter::process_detached(float *const *in, float *const *out, size_t nr_samples)
+{
+	std::copy_n(in, i_quantum_buffers.size(), i_quantum_buffers.begin());
+	std::copy_n(out, o_quantum_buffers.size(), o_quantum_buffers.begin());
+	ProcessClock clock;
+	clock.position = detached_position;
+	detached_position += nr_samples;
+	run_chunks(nr_samples, clock);
+}
+
+
+size_t Filter::get_nr_input_ports() const
+{
+	return i_audio_ports.size();
+}
+
+
+size_t Filter::get_nr_output_ports() const
+{
+	return o_audio_ports.size();
+}
+
+
 void Filter::core_init(pw_filter *filter)
 {
+	if (detached)
+		return;
 	if (filter == nullptr)
 		throw FilterErr({"Invalid initialization of the filter."});
 	this->filter = filter;
+	// a hosted filter shares the pw_filter of its host, which dispatches the process callback
+	if (host)
+		return;
 	setup_filter_events();
 	connect();
 }
@@ -47,12 +163,26 @@ void Filter::disconnect()
 }
 
 
-void Filter::add_audio_port(PortDirection direction, const char *name)
+void Filter::stop_processing()
 {
-	pw_properties *props = pw_properties_new(
-			PW_KEY_FORMAT_DSP, "32 bit float mono audio",
-			PW_KEY_PORT_NAME, name, NULL);
+	if (host) {
+		// dropped from the dispatch list on the data thread before this returns
+		host->remove_filter(*this);
+		return;
+	}
+	if (filter == nullptr)
+		return;
+
+	core->lock_loop();
+	disconnect();
+	core->unlock_loop();
+	// a quantum may still be running on the data thread
+	core->invoke_on_data_loop([](void *) {}, nullptr);
+}
 
+
+void Filter::add_audio_port(PortDirection direction, const char *name)
+{
 	std::vector<AudioPort *> *ports;
 	spa_direction spa_dir;
 	if (direction == PortDirection::Input) {
@@ -63,23 +193,56 @@ void Filter::add_audio_port(PortDirection direction, const char *name)
 		spa_dir = SPA_DIRECTION_OUTPUT;
 	}
 
-	AudioPort *port = static_cast<AudioPort *>(
+	AudioPort *port;
+	if (detached) {
+		port = detached_ports.emplace_back(std::make_unique<AudioPort>()).get();
+	} else {
+		std::string port_name = port_prefix + name;
+		pw_properties *props = pw_properties_new(
+				PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+				PW_KEY_PORT_NAME, port_name.c_str(), NULL);
+		port = static_cast<AudioPort *>(
 				pw_filter_add_port(filter,
 				spa_dir,
 				PW_FILTER_PORT_FLAG_MAP_BUFFERS,
 				sizeof(AudioPort),
 				props, nullptr, 0));
+	}
 	ports->push_back(port);
+	i_quantum_buffers.resize(i_audio_ports.size(), nullptr);
+	o_quantum_buffers.resize(o_audio_ports.size(), nullptr);
+	i_buffers.resize(i_audio_ports.size(), nullptr);
+	o_buffers.resize(o_audio_ports.size(), nullptr);
+	block_in.resize(i_audio_ports.size(), silence);
+	block_out.resize(o_audio_ports.size(), nullptr);
+	if (direction == PortDirection::Output)
+		discard.resize(max_quantum);
+	if (detached && !is_inplace_capable())
+		alias_scratch.resize(i_audio_ports.size(), std::vector<float>(max_quantum));
 }
 
 
 void Filter::rem_audio_port(AudioPort *port)
 {
-	auto do_remove = [](auto& port_it, auto& ports)
+	auto do_remove = [this](auto& port_it, auto& ports)
 	{
 		AudioPort *port = *port_it;
 		ports.erase(port_it);
-		pw_filter_remove_port(port);
+		if (detached) {
+			auto detached_it = std::find_if(detached_ports.begin(), detached_ports.end(),
+					[port](const auto& detached_port) { return detached_port.get() == port; });
+			detached_ports.erase(detached_it);
+		} else {
+			pw_filter_remove_port(port);
+		}
+		i_quantum_buffers.resize(i_audio_ports.size());
+		o_quantum_buffers.resize(o_audio_ports.size());
+		i_buffers.resize(i_audio_ports.size());
+		o_buffers.resize(o_audio_ports.size());
+		block_in.resize(i_audio_ports.size());
+		block_out.resize(o_audio_ports.size());
+		if (!alias_scratch.empty())
+			alias_scratch.resize(i_audio_ports.size());
 	};
 
 	auto port_it = std::find(i_audio_ports.begin(), i_audio_ports.end(), port);
@@ -96,15 +259,101 @@ void Filter::rem_audio_port(AudioPort *port)
 }
 
 
+bool Filter::is_inplace_capable() const noexcept
+{
+	return false;
+}
+
+
+const ProcessBlock& Filter::get_process_block() const
+{
+	return block;
+}
+
+
+void Filter::reset_state() noexcept
+{
+}
+
+
+bool Filter::is_state_below(float threshold) const noexcept
+{
+	return false;
+}
+
+
+void Filter::set_param(size_t index, float value)
+{
+}
+
+
 float *Filter::get_input_buffer(size_t index, size_t nr_samples)
 {
-	return static_cast<float *>(pw_filter_get_dsp_buffer(i_audio_ports[index], nr_samples));
+	return i_buffers[index];
 }
 
 
 float *Filter::get_output_buffer(size_t index, size_t nr_samples)
 {
-	return static_cast<float *>(pw_filter_get_dsp_buffer(o_audio_ports[index], nr_samples));
+	return o_buffers[index];
+}
+
+
+void Filter::resolve_buffers(size_t nr_samples)
+{
+	for (size_t i = 0; i < i_audio_ports.size(); ++i)
+		i_quantum_buffers[i] = static_cast<float *>(pw_filter_get_dsp_buffer(i_audio_ports[i], nr_samples));
+	for (size_t i = 0; i < o_audio_ports.size(); ++i)
+		o_quantum_buffers[i] = static_cast<float *>(pw_filter_get_dsp_buffer(o_audio_ports[i], nr_samples));
+}
+
+
+void Filter::unalias_buffers(size_t nr_samples)
+{
+	if (alias_scratch.empty())
+		return;
+	size_t nr_pairs = std::min({i_buffers.size(), o_buffers.size(), alias_scratch.size()});
+	for (size_t i = 0; i < nr_pairs; ++i) {
+		if (i_buffers[i] == nullptr || i_buffers[i] != o_buffers[i])
+			continue;
+		std::copy_n(i_buffers[i], nr_samples, alias_scratch[i].data());
+		i_buffers[i] = alias_scratch[i].data();
+	}
+}
+
+
+void Filter::prepare_block(size_t nr_samples)
+{
+	for (size_t i = 0; i < i_buffers.size(); ++i)
+		block_in[i] = i_buffers[i] ? i_buffers[i] : silence;
+	for (size_t i = 0; i < o_buffers.size(); ++i)
+		block_out[i] = o_buffers[i] ? o_buffers[i] : discard.data();
+	block.in = block_in.data();
+	block.out = block_out.data();
+	block.nr_inputs = block_in.size();
+	block.nr_outputs = block_out.size();
+	block.nr_samples = nr_samples;
+}
+
+
+void Filter::feed_tap(TapPoint point, const std::vector<float *>& buffers, size_t nr_samples)
+{
+	AnalysisTap *tap = taps[static_cast<int>(point)].load(std::memory_order_acquire);
+	if (tap == nullptr)
+		return;
+	size_t nr_channels = std::min<size_t>(buffers.size(), tap->get_nr_channels());
+	for (size_t i = 0; i < nr_channels; ++i) {
+		if (buffers[i])
+			tap->push(i, buffers[i], nr_samples);
+	}
+}
+
+
+void Filter::feed_capture(CaptureTap& capture, const std::vector<float *>& buffers,
+		unsigned int first_channel)
+{
+	for (size_t i = 0; i < buffers.size(); ++i)
+		capture.write_channel(first_channel + i, buffers[i]);
 }
 
 
@@ -119,7 +368,130 @@ void Filter::setup_filter_events()
 void Filter::on_process(void *data, struct spa_io_position *position)
 {
 	FilterEventsUserData *feud = static_cast<FilterEventsUserData *>(data);
-	feud->self->on_process(position->clock.duration);
+	ProcessClock clock;
+	clock.nsec = position->clock.nsec;
+	clock.position = position->clock.position;
+	clock.rate = position->clock.rate.denom;
+	clock.rate_diff = position->clock.rate_diff;
+	feud->self->process_quantum(position->clock.duration, clock);
+}
+
+
+void Filter::process_quantum(size_t nr_samples, const ProcessClock& clock, size_t offset)
+{
+	resolve_buffers(offset + nr_samples);
+	if (offset > 0) {
+		for (auto& buffer : i_quantum_buffers)
+			buffer = buffer ? buffer + offset : nullptr;
+		for (auto& buffer : o_quantum_buffers)
+			buffer = buffer ? buffer + offset : nullptr;
+	}
+	run_chunks(nr_samples, clock);
+}
+
+
+void Filter::run_chunks(size_t nr_samples, const ProcessClock& clock)
+{
+	// scratch space and the kernels' contracts are sized for max_quantum, the graph may run
+	// larger quanta if its quantum limit is raised
+	for (size_t offset = 0; offset < nr_samples; offset += max_quantum) {
+		const size_t nr_chunk_samples = std::min(max_quantum, nr_samples - offset);
+		chunk_offset = offset;
+		for (size_t i = 0; i < i_buffers.size(); ++i)
+			i_buffers[i] = i_quantum_buffers[i] ? i_quantum_buffers[i] + offset : nullptr;
+		for (size_t i = 0; i < o_buffers.size(); ++i)
+			o_buffers[i] = o_quantum_buffers[i] ? o_quantum_buffers[i] + offset : nullptr;
+		// pw_filter hands every port its own buffer, only detached callers may alias them
+		if (detached)
+			unalias_buffers(nr_chunk_samples);
+
+		block.clock = clock;
+		block.clock.position = clock.position + offset;
+		if (clock.rate != 0)
+			block.clock.nsec = clock.nsec + offset * SPA_NSEC_PER_SEC / clock.rate;
+		run_quantum(nr_chunk_samples);
+	}
+}
+
+
+void Filter::run_quantum(size_t nr_samples)
+{
+	trace::Scope trace_scope {"Filter::process"};
+
+	ParamSurface *surface = param_surface.load(std::memory_order_acquire);
+	if (surface) {
+		for (uint64_t changed = surface->poll(); changed != 0; changed &= changed - 1) {
+			const size_t index = __builtin_ctzll(changed);
+			set_param(index, surface->get_value(index));
+		}
+		surface->measure_inputs(i_buffers, nr_samples);
+	}
+
+	feed_tap(TapPoint::Input, i_buffers, nr_samples);
+
+	// inputs are captured before on_process, which may overwrite them in place
+	CaptureTap *capture = this->capture.load(std::memory_order_acquire);
+	if (capture && !capture->reserve(nr_samples))
+		capture = nullptr;
+	if (capture)
+		feed_capture(*capture, i_buffers, 0);
+
+	prepare_block(nr_samples);
+
+	if (!silence_detection.load(std::memory_order_acquire)) {
+		idle = false;
+		on_process(nr_samples);
+		nr_processed_quanta.store(nr_processed_quanta.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+	} else {
+		const float threshold = silence_threshold.load(std::memory_order_relaxed);
+		const bool input_silent = are_buffers_silent(i_buffers, nr_samples, threshold);
+		if (input_silent && idle) {
+			bypass(nr_samples);
+			nr_skipped_quanta.store(nr_skipped_quanta.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
+		} else {
+			on_process(nr_samples);
+			nr_processed_quanta.store(nr_processed_quanta.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
+			// silent output may still leave a tail in the state, e.g. behind a latency
+			idle = input_silent && are_buffers_silent(o_buffers, nr_samples, threshold)
+				&& is_state_below(threshold);
+			if (idle)
+				reset_state();
+		}
+	}
+
+	feed_tap(TapPoint::Output, o_buffers, nr_samples);
+
+	if (surface) {
+		surface->publish_meters(o_buffers, nr_samples);
+		surface->publish_stats(nr_processed_quanta.load(std::memory_order_relaxed),
+				nr_skipped_quanta.load(std::memory_order_relaxed));
+	}
+
+	if (capture) {
+		feed_capture(*capture, o_buffers, i_buffers.size());
+		capture->commit();
+	}
+}
+
+
+void Filter::bypass(size_t nr_samples)
+{
+	const bool pass_through = bypass_mode.load(std::memory_order_relaxed) == BypassMode::PassThrough;
+	for (size_t i = 0; i < o_buffers.size(); ++i) {
+		float *out_buf = o_buffers[i];
+		if (out_buf == nullptr)
+			continue;
+		const float *in_buf = i < i_buffers.size() ? i_buffers[i] : nullptr;
+		if (pass_through && in_buf) {
+			if (in_buf != out_buf)
+				std::memcpy(out_buf, in_buf, nr_samples * sizeof(float));
+		} else {
+			std::memset(out_buf, 0, nr_samples * sizeof(float));
+		}
+	}
 }
 
 
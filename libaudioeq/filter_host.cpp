@@ -0,0 +1,106 @@
+#include <audioeq/filter_host.h>
+#include <audioeq/core.h>
+#include <audioeq/trace.h>
+
+#include <algorithm>
+#include <typeinfo>
+
+
+namespace aeq {
+
+FilterHost::~FilterHost()
+{
+	// the ports of the hosted filters go away together with the shared pw_filter
+	for (auto filter : hosted) {
+		filter->host = nullptr;
+		filter->filter = nullptr;
+	}
+}
+
+
+void FilterHost::add_filter(Filter& filter, const char *name)
+{
+	if (this->filter == nullptr || core == nullptr)
+		throw FilterHostErr(FilterErr({"Filter host is not initialized."}));
+	if (filter.filter != nullptr)
+		throw FilterHostErr(FilterErr({"Filter is already initialized."}));
+
+	core->lock_loop();
+	utils::Defer defer {[this](){ core->unlock_loop(); }};
+
+	filter.core = core;
+	filter.host = this;
+	filter.port_prefix = std::string(name) + ":";
+	try {
+		filter.core_init(this->filter);
+	} catch (...) {
+		filter.host = nullptr;
+		throw;
+	}
+
+	hosted.push_back(&filter);
+	publish();
+}
+
+
+void FilterHost::remove_filter(Filter& filter)
+{
+	auto filter_it = std::find(hosted.begin(), hosted.end(), &filter);
+	if (filter_it == hosted.end())
+		return;
+
+	core->lock_loop();
+	utils::Defer defer {[this](){ core->unlock_loop(); }};
+
+	hosted.erase(filter_it);
+	publish();
+
+	// no longer dispatched, so the ports can go
+	while (!filter.i_audio_ports.empty())
+		filter.rem_audio_port(filter.i_audio_ports.back());
+	while (!filter.o_audio_ports.empty())
+		filter.rem_audio_port(filter.o_audio_ports.back());
+
+	filter.host = nullptr;
+	filter.filter = nullptr;
+}
+
+
+size_t FilterHost::get_nr_filters() const
+{
+	return hosted.size();
+}
+
+
+void FilterHost::on_process(size_t nr_samples)
+{
+	trace::Scope trace_scope {"FilterHost::process"};
+	const ProcessClock& clock = get_process_block().clock;
+	for (auto filter : dispatch)
+		filter->process_quantum(nr_samples, clock, chunk_offset);
+}
+
+
+void FilterHost::publish()
+{
+	struct Swap {
+		std::vector<Filter *> *dispatch;
+		std::vector<Filter *> next;
+	};
+
+	Swap swap {&dispatch, hosted};
+	std::sort(swap.next.begin(), swap.next.end(), [](Filter *a, Filter *b)
+	{
+		size_t type_a = typeid(*a).hash_code(), type_b = typeid(*b).hash_code();
+		return type_a != type_b ? type_a < type_b : a < b;
+	});
+
+	// the old list is swapped out on the data thread and freed here after the call returns
+	core->invoke_on_data_loop([](void *data)
+	{
+		Swap *swap = static_cast<Swap *>(data);
+		swap->dispatch->swap(swap->next);
+	}, &swap);
+}
+
+}
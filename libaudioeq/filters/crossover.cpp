@@ -0,0 +1,87 @@
+#include <audioeq/filters/crossover.h>
+#include <audioeq/dsp/biquad.h>
+
+#include <string>
+
+
+namespace aeq::filters {
+
+CrossoverFilter::CrossoverFilter(int sample_rate, unsigned int nr_channels, const std::vector<float>& freqs)
+	: nr_channels(nr_channels), nr_bands(freqs.size() + 1)
+{
+	if (sample_rate <= 0)
+		throw CrossoverFilterErr(FilterErr({"Non-positive sample rate."}));
+	if (freqs.empty() || nr_bands > max_bands)
+		throw CrossoverFilterErr(FilterErr({"Crossover needs 2 to 6 bands."}));
+
+	// the lowest split has the poles nearest to z = 1
+	if (dsp::recommend_precision(freqs.front(), sample_rate) == dsp::StatePrecision::F64)
+		crossover_f64 = std::make_unique<dsp::LRCrossover<double>>(freqs, sample_rate, nr_channels);
+	else
+		crossover_f32 = std::make_unique<dsp::LRCrossover<float>>(freqs, sample_rate, nr_channels);
+}
+
+
+void CrossoverFilter::core_init(pw_filter *filter)
+{
+	Filter::core_init(filter);
+	if (nr_channels == 1) {
+		add_audio_port(PortDirection::Input, "xover-in");
+		for (size_t band = 0; band < nr_bands; ++band)
+			add_audio_port(PortDirection::Output, ("xover-band" + std::to_string(band)).c_str());
+	} else if (nr_channels == 2) {
+		add_audio_port(PortDirection::Input, "xover-in_L");
+		add_audio_port(PortDirection::Input, "xover-in_R");
+		for (size_t band = 0; band < nr_bands; ++band) {
+			add_audio_port(PortDirection::Output, ("xover-band" + std::to_string(band) + "_L").c_str());
+			add_audio_port(PortDirection::Output, ("xover-band" + std::to_string(band) + "_R").c_str());
+		}
+	} else {
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Input, ("xover-in_" + std::to_string(i)).c_str());
+		for (size_t band = 0; band < nr_bands; ++band)
+			for (unsigned int i = 0; i < nr_channels; ++i)
+				add_audio_port(PortDirection::Output,
+						("xover-band" + std::to_string(band) + "_" + std::to_string(i)).c_str());
+	}
+}
+
+
+size_t CrossoverFilter::get_nr_bands() const
+{
+	return nr_bands;
+}
+
+
+void CrossoverFilter::process(const ProcessBlock& block)
+{
+	// the output ports are the bands of every channel in order
+	if (crossover_f64)
+		crossover_f64->process(block.in, block.out, block.nr_samples);
+	else
+		crossover_f32->process(block.in, block.out, block.nr_samples);
+}
+
+
+bool CrossoverFilter::is_inplace_capable() const noexcept
+{
+	// every block is read in full before any band of it is written
+	return true;
+}
+
+
+void CrossoverFilter::reset_state() noexcept
+{
+	if (crossover_f64)
+		crossover_f64->reset();
+	else
+		crossover_f32->reset();
+}
+
+
+bool CrossoverFilter::is_state_below(float threshold) const noexcept
+{
+	return crossover_f64 ? crossover_f64->is_state_below(threshold) : crossover_f32->is_state_below(threshold);
+}
+
+}
@@ -0,0 +1,136 @@
+#include <audioeq/filters/dynamic_eq.h>
+#include <audioeq/dsp/biquad.h>
+
+#include <iterator>
+#include <string>
+
+
+namespace aeq::filters {
+
+namespace {
+
+/* Parameters of every band, in the order of get_params. */
+struct BandParam {
+	const char *suffix;
+	float dsp::DynamicBand::*field;
+	float min;
+	float max;
+};
+
+constexpr BandParam band_params[] = {
+	{"freq",	&dsp::DynamicBand::freq,		16.0F,	20000.0F},
+	{"q",		&dsp::DynamicBand::q,			0.1F,	20.0F},
+	{"threshold",	&dsp::DynamicBand::threshold_db,	-80.0F,	0.0F},
+	{"ratio",	&dsp::DynamicBand::ratio,		1.0F,	20.0F},
+	{"range",	&dsp::DynamicBand::range_db,		-24.0F,	24.0F},
+	{"attack",	&dsp::DynamicBand::attack_ms,		0.1F,	200.0F},
+	{"release",	&dsp::DynamicBand::release_ms,		1.0F,	2000.0F},
+};
+
+constexpr size_t nr_band_params = std::size(band_params);
+
+}
+
+DynamicEqFilter::DynamicEqFilter(int sample_rate, unsigned int nr_channels,
+		const std::vector<dsp::DynamicBand>& bands)
+	: nr_channels(nr_channels)
+{
+	if (sample_rate <= 0)
+		throw DynamicEqFilterErr(FilterErr({"Non-positive sample rate."}));
+	if (bands.empty() || bands.size() > max_bands)
+		throw DynamicEqFilterErr(FilterErr({"Dynamic equalizer needs 1 to 8 bands."}));
+
+	// set_param may move any band down to the bottom of the frequency range on the RT thread,
+	// where the state can't be swapped, so the precision is picked for the lowest band possible
+	const float lowest_freq = band_params[0].min;
+	if (dsp::recommend_precision(lowest_freq, sample_rate) == dsp::StatePrecision::F64)
+		eq_f64 = std::make_unique<dsp::DynamicEq<double>>(bands, sample_rate, nr_channels);
+	else
+		eq_f32 = std::make_unique<dsp::DynamicEq<float>>(bands, sample_rate, nr_channels);
+}
+
+
+void DynamicEqFilter::core_init(pw_filter *filter)
+{
+	Filter::core_init(filter);
+	if (nr_channels == 1) {
+		add_audio_port(PortDirection::Input, "deq-in");
+		add_audio_port(PortDirection::Output, "deq-out");
+	} else if (nr_channels == 2) {
+		add_audio_port(PortDirection::Input, "deq-in_L");
+		add_audio_port(PortDirection::Input, "deq-in_R");
+		add_audio_port(PortDirection::Output, "deq-out_L");
+		add_audio_port(PortDirection::Output, "deq-out_R");
+	} else {
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Input, ("deq-in_" + std::to_string(i)).c_str());
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Output, ("deq-out_" + std::to_string(i)).c_str());
+	}
+}
+
+
+size_t DynamicEqFilter::get_nr_bands() const
+{
+	return eq_f64 ? eq_f64->get_nr_bands() : eq_f32->get_nr_bands();
+}
+
+
+std::vector<ParamInfo> DynamicEqFilter::get_params() const
+{
+	std::vector<ParamInfo> params;
+	for (size_t b = 0; b < get_nr_bands(); ++b) {
+		const dsp::DynamicBand& band = eq_f64 ? eq_f64->get_band(b) : eq_f32->get_band(b);
+		for (const BandParam& param : band_params)
+			params.push_back({"b" + std::to_string(b) + "-" + param.suffix, param.min, param.max,
+					band.*param.field});
+	}
+	return params;
+}
+
+
+void DynamicEqFilter::set_param(size_t index, float value)
+{
+	const size_t b = index / nr_band_params;
+	if (b >= get_nr_bands())
+		return;
+	dsp::DynamicBand band = eq_f64 ? eq_f64->get_band(b) : eq_f32->get_band(b);
+	band.*band_params[index % nr_band_params].field = value;
+	if (eq_f64)
+		eq_f64->set_band(b, band);
+	else
+		eq_f32->set_band(b, band);
+}
+
+
+void DynamicEqFilter::process(const ProcessBlock& block)
+{
+	if (eq_f64)
+		eq_f64->process(block.in, block.out, block.nr_samples);
+	else
+		eq_f32->process(block.in, block.out, block.nr_samples);
+}
+
+
+bool DynamicEqFilter::is_inplace_capable() const noexcept
+{
+	// every output sample is written right after its input sample is read
+	return true;
+}
+
+
+void DynamicEqFilter::reset_state() noexcept
+{
+	if (eq_f64)
+		eq_f64->reset();
+	else
+		eq_f32->reset();
+}
+
+
+bool DynamicEqFilter::is_state_below(float threshold) const noexcept
+{
+	return eq_f64 ? eq_f64->is_state_below(threshold) : eq_f32->is_state_below(threshold);
+}
+
+}
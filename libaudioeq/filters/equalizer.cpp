@@ -0,0 +1,171 @@
+#include <audioeq/filters/equalizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+
+namespace aeq::filters {
+
+EqualizerFilter::EqualizerFilter(int sample_rate, unsigned int nr_channels, float crossfade_ms)
+	: nr_channels(nr_channels), sample_rate(sample_rate)
+{
+	if (sample_rate <= 0)
+		throw EqualizerFilterErr(FilterErr({"Non-positive sample rate."}));
+
+	for (auto& curve : curves)
+		curve.states.resize(size_t(nr_channels) * max_bands);
+
+	// equal-power crossfade: cos^2 + sin^2 = 1
+	size_t fade_len = std::max<size_t>(1, size_t(crossfade_ms * sample_rate / 1000.0F));
+	fade_in_gains.resize(fade_len);
+	fade_out_gains.resize(fade_len);
+	for (size_t i = 0; i < fade_len; ++i) {
+		double phase = 0.5 * M_PI * (i + 1) / fade_len;
+		fade_in_gains[i] = std::sin(phase);
+		fade_out_gains[i] = std::cos(phase);
+	}
+	fade_scratch.resize(max_quantum);
+}
+
+
+void EqualizerFilter::core_init(pw_filter *filter)
+{
+	Filter::core_init(filter);
+	if (nr_channels == 1) {
+		add_audio_port(PortDirection::Input, "eq-in");
+		add_audio_port(PortDirection::Output, "eq-out");
+	} else if (nr_channels == 2) {
+		add_audio_port(PortDirection::Input, "eq-in_L");
+		add_audio_port(PortDirection::Input, "eq-in_R");
+		add_audio_port(PortDirection::Output, "eq-out_L");
+		add_audio_port(PortDirection::Output, "eq-out_R");
+	} else {
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Input, ("eq-in_" + std::to_string(i)).c_str());
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Output, ("eq-out_" + std::to_string(i)).c_str());
+	}
+}
+
+
+void EqualizerFilter::set_curve(const PresetBand *bands, size_t nr_bands)
+{
+	nr_bands = std::min(nr_bands, max_bands);
+
+	std::lock_guard lock {writer_mutex};
+
+	// design first, so that an invalid band leaves the running curve untouched
+	std::array<dsp::BiquadStage, max_bands> stages;
+	for (size_t i = 0; i < nr_bands; ++i) {
+		const PresetBand& band = bands[i];
+		dsp::StatePrecision precision = state_precision.value_or(
+				dsp::recommend_precision(band.freq, sample_rate));
+		stages[i] = dsp::BiquadStage(dsp::design(static_cast<dsp::FilterType>(band.type),
+					band.freq, band.q, band.gain_db, sample_rate), precision);
+	}
+
+	Curve& curve = curves[writer_curve];
+	curve.nr_bands = nr_bands;
+	curve.stages = stages;
+	writer_curve = published.exchange(writer_curve | dirty_bit, std::memory_order_acq_rel) & ~dirty_bit;
+}
+
+
+void EqualizerFilter::load_preset(const Preset& preset)
+{
+	set_curve(preset.bands, preset.nr_bands);
+}
+
+
+void EqualizerFilter::set_state_precision(std::optional<dsp::StatePrecision> precision)
+{
+	std::lock_guard lock {writer_mutex};
+	state_precision = precision;
+}
+
+
+void EqualizerFilter::take_published_curve()
+{
+	if (fading || (published.load(std::memory_order_relaxed) & dirty_bit) == 0)
+		return;
+
+	int curve_idx = published.exchange(spare_curve, std::memory_order_acq_rel) & ~dirty_bit;
+	spare_curve = active_curve;
+	active_curve = curve_idx;
+
+	Curve& curve = curves[active_curve];
+	std::fill(curve.states.begin(), curve.states.end(), dsp::BiquadStageState());
+	fading = true;
+	fade_pos = 0;
+}
+
+
+void EqualizerFilter::process(const ProcessBlock& block)
+{
+	take_published_curve();
+
+	Curve& new_curve = curves[active_curve];
+	Curve& old_curve = curves[spare_curve];
+
+	const size_t nr_samples = block.nr_samples;
+	const size_t fade_len = fade_in_gains.size();
+	const size_t nr_fade_samples = fading ? std::min({nr_samples, fade_len - fade_pos, max_quantum}) : 0;
+
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		const float *in_buf = block.in[ch];
+		float *out_buf = block.out[ch];
+
+		// the old curve runs first as the new one may overwrite an aliased input
+		if (nr_fade_samples > 0)
+			dsp::process_cascade(old_curve.stages.data(), &old_curve.states[ch * max_bands],
+					old_curve.nr_bands, in_buf, fade_scratch.data(), nr_fade_samples);
+
+		dsp::process_cascade(new_curve.stages.data(), &new_curve.states[ch * max_bands],
+				new_curve.nr_bands, in_buf, out_buf, nr_samples);
+
+		for (size_t i = 0; i < nr_fade_samples; ++i)
+			out_buf[i] = fade_in_gains[fade_pos + i] * out_buf[i]
+				   + fade_out_gains[fade_pos + i] * fade_scratch[i];
+	}
+
+	if (fading) {
+		fade_pos += nr_fade_samples;
+		if (fade_pos >= fade_len)
+			fading = false;
+	}
+}
+
+
+bool EqualizerFilter::is_inplace_capable() const noexcept
+{
+	return true;
+}
+
+
+void EqualizerFilter::reset_state() noexcept
+{
+	// the curve being written and the published one get their state reset when taken
+	for (int curve_idx : {active_curve, spare_curve}) {
+		Curve& curve = curves[curve_idx];
+		std::fill(curve.states.begin(), curve.states.end(), dsp::BiquadStageState());
+	}
+}
+
+
+bool EqualizerFilter::is_state_below(float threshold) const noexcept
+{
+	// the fading curve still sounds
+	if (fading)
+		return false;
+	const Curve& curve = curves[active_curve];
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		for (size_t band = 0; band < curve.nr_bands; ++band) {
+			if (!dsp::is_state_below(curve.stages[band], curve.states[ch * max_bands + band], threshold))
+				return false;
+		}
+	}
+	return true;
+}
+
+}
@@ -1,5 +1,7 @@
 #include <audioeq/filters/low_pass.h>
+#include <audioeq/dsp/kernels.h>
 
+#include <algorithm>
 #include <cmath>
 
 
@@ -7,10 +9,11 @@ namespace aeq::filters {
 
 LowPassFilter::LowPassFilter(float cutoff_freq, int sample_rate, unsigned int nr_channels)
 	: nr_channels(nr_channels), cuttoff_freq(cutoff_freq), sample_rate(sample_rate),
-	alpha(calc_alpha(cutoff_freq, sample_rate))
+	alpha_table(get_alpha_table(sample_rate)), alpha(calc_alpha(cutoff_freq, *alpha_table))
 {
 	if (nr_channels > 2)
-		nr_channels = 2;
+		this->nr_channels = 2;
+	last_outs.assign(this->nr_channels, 0.0F);
 }
 
 
@@ -33,44 +36,66 @@ void LowPassFilter::core_init(pw_filter *filter)
 
 void LowPassFilter::set_cutoff_freq(float cutoff_freq)
 {
-	this->cuttoff_freq = cutoff_freq;
-	this->alpha = calc_alpha(cuttoff_freq, sample_rate);
+	this->cuttoff_freq.store(cutoff_freq, std::memory_order_relaxed);
+	this->alpha.store(calc_alpha(cutoff_freq, *alpha_table), std::memory_order_relaxed);
 }
 
 
-void LowPassFilter::on_process(size_t nr_samples)
+std::vector<ParamInfo> LowPassFilter::get_params() const
 {
-	for (int i = 0; i < nr_channels; ++i) {
-		float *in_buf = get_input_buffer(i, nr_samples);
-		if (in_buf == nullptr)
-			continue;
+	return {{"cutoff", 16.0F, 20000.0F, cuttoff_freq.load(std::memory_order_relaxed)}};
+}
 
-		float *out_buf = get_output_buffer(i, nr_samples);
-		if (out_buf == nullptr)
-			continue;
 
-		single_channel_process(in_buf, out_buf, nr_samples);
-	}
+void LowPassFilter::set_param(size_t index, float value)
+{
+	if (index == 0)
+		set_cutoff_freq(value);
 }
 
 
-void LowPassFilter::single_channel_process(float *in_buf, float *out_buf, size_t nr_samples)
+void LowPassFilter::process(const ProcessBlock& block)
 {
-	for (size_t i = 0; i < nr_samples; ++i) {
-		out_buf[i] = alpha * in_buf[i] + (1.0F - alpha) * out_buf[i];
-	}
+	const float alpha = this->alpha.load(std::memory_order_relaxed);
+	const dsp::Kernels& kernels = dsp::kernels();
+	for (int i = 0; i < nr_channels; ++i)
+		kernels.one_pole_low_pass(block.in[i], block.out[i], block.nr_samples, alpha, last_outs[i]);
+}
+
+
+bool LowPassFilter::is_inplace_capable() const noexcept
+{
+	return true;
+}
+
+
+void LowPassFilter::reset_state() noexcept
+{
+	std::fill(last_outs.begin(), last_outs.end(), 0.0F);
+}
+
+
+bool LowPassFilter::is_state_below(float threshold) const noexcept
+{
+	return std::all_of(last_outs.begin(), last_outs.end(),
+			[threshold](float last_out) { return std::fabs(last_out) <= threshold; });
 }
 
 
-float LowPassFilter::calc_alpha(float cutoff_freq, int sample_rate)
+std::shared_ptr<const dsp::CoefficientTable> LowPassFilter::get_alpha_table(int sample_rate)
 {
 	if (sample_rate <= 0)
 		throw LowPassFilterErr(FilterErr({"Non-positive sample rate."}));
+	return dsp::CoefficientCache::shared().get_table(dsp::FilterType::OnePoleLowPass,
+			0.0F, 0.0F, sample_rate);
+}
+
+
+float LowPassFilter::calc_alpha(float cutoff_freq, const dsp::CoefficientTable& alpha_table)
+{
 	if (cutoff_freq <= 0.0F)
 		throw LowPassFilterErr(FilterErr({"Non-positive cuttoff frequency."}));
-	float dt = 1.0F / sample_rate;
-	float rc = 1.0F / (2 * M_PI * cutoff_freq);
-	return dt / (dt + rc);
+	return static_cast<float>(alpha_table.lookup(cutoff_freq).b0);
 }
 
 }
@@ -0,0 +1,142 @@
+#include <audioeq/filters/matrix_mixer.h>
+
+#include <algorithm>
+#include <string>
+
+
+namespace aeq::filters {
+
+MatrixMixerFilter::MatrixMixerFilter(int sample_rate, unsigned int nr_inputs, unsigned int nr_outputs,
+		float smoothing_ms)
+	: nr_inputs(nr_inputs), nr_outputs(nr_outputs)
+{
+	if (sample_rate <= 0)
+		throw MatrixMixerFilterErr(FilterErr({"Non-positive sample rate."}));
+	if (nr_inputs == 0 || nr_outputs == 0)
+		throw MatrixMixerFilterErr(FilterErr({"Matrix mixer without inputs or outputs."}));
+
+	const size_t nr_gains = size_t(nr_inputs) * nr_outputs;
+	for (auto& matrix : matrices)
+		matrix.resize(nr_gains);
+	gains.resize(nr_gains);
+	current_gains.resize(nr_gains);
+	// the RT thread rebuilds the entries in place
+	entries.reserve(nr_gains);
+	starts.resize(size_t(nr_outputs) + 1);
+
+	ramp_len = std::max<size_t>(1, size_t(smoothing_ms * sample_rate / 1000.0F));
+}
+
+
+void MatrixMixerFilter::core_init(pw_filter *filter)
+{
+	Filter::core_init(filter);
+	for (unsigned int i = 0; i < nr_inputs; ++i)
+		add_audio_port(PortDirection::Input, ("mix-in_" + std::to_string(i)).c_str());
+	for (unsigned int i = 0; i < nr_outputs; ++i)
+		add_audio_port(PortDirection::Output, ("mix-out_" + std::to_string(i)).c_str());
+}
+
+
+void MatrixMixerFilter::set_gain(unsigned int output, unsigned int input, float gain)
+{
+	if (output >= nr_outputs || input >= nr_inputs)
+		throw MatrixMixerFilterErr(FilterErr({"Matrix mixer route out of range."}));
+
+	std::lock_guard lock {writer_mutex};
+	gains[size_t(output) * nr_inputs + input] = gain;
+	matrices[writer_matrix] = gains;
+	writer_matrix = published.exchange(writer_matrix | dirty_bit, std::memory_order_acq_rel) & ~dirty_bit;
+}
+
+
+void MatrixMixerFilter::set_matrix(const std::vector<float>& new_gains)
+{
+	if (new_gains.size() != gains.size())
+		throw MatrixMixerFilterErr(FilterErr({"Gain matrix of wrong size."}));
+
+	std::lock_guard lock {writer_mutex};
+	gains = new_gains;
+	matrices[writer_matrix] = gains;
+	writer_matrix = published.exchange(writer_matrix | dirty_bit, std::memory_order_acq_rel) & ~dirty_bit;
+}
+
+
+std::vector<float> MatrixMixerFilter::get_matrix() const
+{
+	std::lock_guard lock {writer_mutex};
+	return gains;
+}
+
+
+void MatrixMixerFilter::take_published_matrix()
+{
+	if ((published.load(std::memory_order_relaxed) & dirty_bit) == 0)
+		return;
+
+	target_matrix = published.exchange(target_matrix, std::memory_order_acq_rel) & ~dirty_bit;
+	// a ramp still running starts over from where it got to
+	ramp_left = ramp_len;
+	build_entries(ramp_len);
+}
+
+
+void MatrixMixerFilter::build_entries(size_t ramp_len)
+{
+	const std::vector<float>& targets = matrices[target_matrix];
+	entries.clear();
+	for (unsigned int o = 0; o < nr_outputs; ++o) {
+		starts[o] = uint32_t(entries.size());
+		for (unsigned int i = 0; i < nr_inputs; ++i) {
+			const size_t idx = size_t(o) * nr_inputs + i;
+			const float gain = current_gains[idx];
+			const float target = targets[idx];
+			if (gain == 0.0F && target == 0.0F)
+				continue;
+			const float step = ramp_len > 0 ? (target - gain) / float(ramp_len) : 0.0F;
+			entries.push_back({i, gain, step});
+		}
+	}
+	starts[nr_outputs] = uint32_t(entries.size());
+}
+
+
+void MatrixMixerFilter::process(const ProcessBlock& block)
+{
+	take_published_matrix();
+
+	const size_t nr_samples = block.nr_samples;
+	const dsp::MixMatrixArgs args {block.in, block.out, entries.data(), starts.data(), nr_outputs};
+	const dsp::Kernels& kernels = dsp::kernels();
+	const size_t nr_ramp_samples = std::min(nr_samples, ramp_left);
+
+	if (nr_ramp_samples > 0) {
+		kernels.mix_matrix(args, 0, nr_ramp_samples);
+		ramp_left -= nr_ramp_samples;
+		for (uint32_t o = 0; o < nr_outputs; ++o) {
+			for (uint32_t e = starts[o]; e < starts[o + 1]; ++e) {
+				dsp::MixEntry& entry = entries[e];
+				entry.gain += entry.step * float(nr_ramp_samples);
+				current_gains[size_t(o) * nr_inputs + entry.input] = entry.gain;
+			}
+		}
+		// land exactly on the targets and drop the routes that faded out
+		if (ramp_left == 0) {
+			current_gains = matrices[target_matrix];
+			build_entries(0);
+		}
+	}
+
+	if (nr_ramp_samples < nr_samples)
+		kernels.mix_matrix(args, nr_ramp_samples, nr_samples - nr_ramp_samples);
+}
+
+
+
+bool MatrixMixerFilter::is_state_below(float threshold) const noexcept
+{
+	// memoryless but for the gain ramps, which carry on once processing resumes
+	return ramp_left == 0;
+}
+
+}
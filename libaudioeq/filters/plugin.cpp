@@ -0,0 +1,183 @@
+#include <audioeq/filters/plugin.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+
+namespace aeq::filters {
+
+namespace {
+
+/* Stages handed back and not unloaded yet. Every load unloads those handed back before it and
+ * every swap hands back one stage, so a few are plenty. */
+constexpr size_t max_retired = 16;
+
+}
+
+
+PluginFilter::PluginFilter(int sample_rate, unsigned int nr_channels, float crossfade_ms)
+	: nr_channels(nr_channels), sample_rate(sample_rate), retired(max_retired, 1)
+{
+	if (sample_rate <= 0)
+		throw PluginFilterErr(FilterErr({"Non-positive sample rate."}));
+	if (nr_channels == 0)
+		throw PluginFilterErr(FilterErr({"Plugin filter without channels."}));
+
+	// equal-gain crossfade: both stages run versions of the same DSP, their outputs are correlated
+	// and the gains summing to 1 keep the level, equal-power gains would bump it by 3 dB mid-fade
+	size_t fade_len = std::max<size_t>(1, size_t(crossfade_ms * sample_rate / 1000.0F));
+	fade_in_gains.resize(fade_len);
+	fade_out_gains.resize(fade_len);
+	for (size_t i = 0; i < fade_len; ++i) {
+		fade_in_gains[i] = float(double(i + 1) / fade_len);
+		fade_out_gains[i] = 1.0F - fade_in_gains[i];
+	}
+
+	scratch.resize(size_t(nr_channels) * max_quantum);
+	for (unsigned int ch = 0; ch < nr_channels; ++ch)
+		fade_bufs.push_back(&scratch[ch * max_quantum]);
+}
+
+
+PluginFilter::~PluginFilter()
+{
+	// the data thread must be out of the stages before their modules are unmapped
+	stop_processing();
+	collect_retired();
+	delete pending.load(std::memory_order_acquire);
+	delete fading;
+	delete active;
+}
+
+
+void PluginFilter::core_init(pw_filter *filter)
+{
+	Filter::core_init(filter);
+	if (nr_channels == 1) {
+		add_audio_port(PortDirection::Input, "plugin-in");
+		add_audio_port(PortDirection::Output, "plugin-out");
+	} else if (nr_channels == 2) {
+		add_audio_port(PortDirection::Input, "plugin-in_L");
+		add_audio_port(PortDirection::Input, "plugin-in_R");
+		add_audio_port(PortDirection::Output, "plugin-out_L");
+		add_audio_port(PortDirection::Output, "plugin-out_R");
+	} else {
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Input, ("plugin-in_" + std::to_string(i)).c_str());
+		for (unsigned int i = 0; i < nr_channels; ++i)
+			add_audio_port(PortDirection::Output, ("plugin-out_" + std::to_string(i)).c_str());
+	}
+}
+
+
+void PluginFilter::load(const char *path)
+{
+	// prepared before taking the lock, the module may take a while to load
+	auto stage = std::make_unique<PluginStage>(path, sample_rate, nr_channels, max_quantum);
+
+	std::lock_guard lock {loader_mutex};
+	collect_retired();
+	// a stage still pending was never seen by the RT thread
+	delete pending.exchange(stage.release(), std::memory_order_acq_rel);
+}
+
+
+uint64_t PluginFilter::get_nr_swaps() const
+{
+	return nr_swaps.load(std::memory_order_relaxed);
+}
+
+
+void PluginFilter::take_pending_stage()
+{
+	if (is_fading || pending.load(std::memory_order_relaxed) == nullptr)
+		return;
+
+	PluginStage *stage = pending.exchange(nullptr, std::memory_order_acq_rel);
+	if (stage == nullptr)
+		return;
+	fading = active;
+	active = stage;
+	is_fading = true;
+	fade_pos = 0;
+}
+
+
+void PluginFilter::run_stage(PluginStage *stage, const float *const *in, float *const *out, size_t nr_samples)
+{
+	if (stage) {
+		stage->process(in, out, nr_samples);
+		return;
+	}
+	for (unsigned int ch = 0; ch < nr_channels; ++ch)
+		std::memcpy(out[ch], in[ch], nr_samples * sizeof(float));
+}
+
+
+void PluginFilter::process(const ProcessBlock& block)
+{
+	take_pending_stage();
+
+	const size_t nr_samples = block.nr_samples;
+	const size_t fade_len = fade_in_gains.size();
+	const size_t nr_fade_samples = is_fading ? std::min({nr_samples, fade_len - fade_pos, max_quantum}) : 0;
+
+	// the inputs are private copies if aliased, so both stages read the same input
+	if (nr_fade_samples > 0)
+		run_stage(fading, block.in, fade_bufs.data(), nr_fade_samples);
+	run_stage(active, block.in, block.out, nr_samples);
+
+	for (unsigned int ch = 0; ch < nr_channels && nr_fade_samples > 0; ++ch) {
+		float *out_buf = block.out[ch];
+		const float *fade_buf = fade_bufs[ch];
+		for (size_t i = 0; i < nr_fade_samples; ++i)
+			out_buf[i] = fade_in_gains[fade_pos + i] * out_buf[i]
+				   + fade_out_gains[fade_pos + i] * fade_buf[i];
+	}
+
+	if (is_fading) {
+		fade_pos += nr_fade_samples;
+		if (fade_pos >= fade_len) {
+			retire(fading);
+			fading = nullptr;
+			is_fading = false;
+			nr_swaps.store(nr_swaps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	}
+}
+
+
+void PluginFilter::reset_state() noexcept
+{
+	// nothing left to fade from once the state is gone
+	if (is_fading) {
+		retire(fading);
+		fading = nullptr;
+		is_fading = false;
+		nr_swaps.store(nr_swaps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	if (active)
+		active->reset();
+}
+
+
+void PluginFilter::retire(PluginStage *stage)
+{
+	// a full ring leaks the stage rather than unloading it here
+	if (stage)
+		retired.push(&stage, 1);
+}
+
+
+void PluginFilter::collect_retired()
+{
+	size_t size;
+	while (PluginStage *const *stage = retired.front(size)) {
+		delete *stage;
+		retired.pop();
+	}
+}
+
+}
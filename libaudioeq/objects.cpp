@@ -28,7 +28,13 @@ void Port::link_to(Port& other)
 		linked_ports.emplace_back(other.id, &other);
 	else
 		*found_port_it = {other.id, &other};
-	other.linked_ports.emplace_back(id, this);
+
+	// the other port may already wait for this one by id
+	auto found_this_it = other.find_linked_port(id);
+	if (found_this_it == other.linked_ports.end())
+		other.linked_ports.emplace_back(id, this);
+	else
+		*found_this_it = {id, this};
 }
 
 void Port::link_to_id(uint32_t other_id)
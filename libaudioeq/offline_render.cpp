@@ -0,0 +1,197 @@
+#include <audioeq/offline_render.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace aeq {
+
+namespace {
+
+/* Samples run through all stages at a time, in f64 between the stages. */
+constexpr size_t block_size = 256;
+
+/* Component i of the state vector of a curve: z1 then z2 of every stage. */
+double& state_at(dsp::BiquadState<double> *state, size_t i)
+{
+	return i % 2 == 0 ? state[i / 2].z1 : state[i / 2].z2;
+}
+
+/* c = a * b of n x n row-major matrices. */
+void mat_mul(const std::vector<double>& a, const std::vector<double>& b, std::vector<double>& c, size_t n)
+{
+	std::fill(c.begin(), c.end(), 0.0);
+	for (size_t r = 0; r < n; ++r)
+		for (size_t k = 0; k < n; ++k)
+			for (size_t col = 0; col < n; ++col)
+				c[r * n + col] += a[r * n + k] * b[k * n + col];
+}
+
+}
+
+
+OfflineRenderer::OfflineRenderer(const PresetBand *bands, size_t nr_bands, int sample_rate,
+		size_t nr_threads, size_t chunk_size)
+	: chunk_size(chunk_size), pool(nr_threads)
+{
+	if (sample_rate <= 0)
+		throw OfflineRenderErr({"Non-positive sample rate."});
+	if (chunk_size == 0)
+		throw OfflineRenderErr({"Zero chunk size."});
+
+	for (size_t i = 0; i < nr_bands; ++i) {
+		const PresetBand& band = bands[i];
+		stages.emplace_back(dsp::design(static_cast<dsp::FilterType>(band.type),
+					band.freq, band.q, band.gain_db, sample_rate));
+	}
+
+	// column i of the one sample transition is where a unit state i goes on silence
+	const size_t n = get_state_size();
+	std::vector<double> step(n * n);
+	std::vector<dsp::BiquadState<double>> state(stages.size());
+	for (size_t i = 0; i < n; ++i) {
+		std::fill(state.begin(), state.end(), dsp::BiquadState<double>());
+		state_at(state.data(), i) = 1.0;
+		float ignored = 0.0F;
+		run(state.data(), nullptr, &ignored, 1);
+		for (size_t r = 0; r < n; ++r)
+			step[r * n + i] = state_at(state.data(), r);
+	}
+
+	// raise it to chunk_size by squaring
+	chunk_transition.assign(n * n, 0.0);
+	for (size_t i = 0; i < n; ++i)
+		chunk_transition[i * n + i] = 1.0;
+	std::vector<double> product(n * n);
+	for (size_t e = chunk_size; e > 0; e >>= 1) {
+		if (e & 1) {
+			mat_mul(chunk_transition, step, product, n);
+			chunk_transition.swap(product);
+		}
+		mat_mul(step, step, product, n);
+		step.swap(product);
+	}
+}
+
+
+void OfflineRenderer::render(const float *const *in, float *const *out, unsigned int nr_channels, size_t nr_frames)
+{
+	const size_t nr_chunks = (nr_frames + chunk_size - 1) / chunk_size;
+	if (stages.empty() || nr_chunks < 2 || pool.get_nr_threads() == 1) {
+		render_serial(in, out, nr_channels, nr_frames);
+		return;
+	}
+
+	const size_t nr_stages = stages.size();
+	std::vector<dsp::BiquadState<double>> states(nr_channels * nr_chunks * nr_stages);
+	auto chunk_state = [&](size_t ch, size_t chunk)
+	{
+		return &states[(ch * nr_chunks + chunk) * nr_stages];
+	};
+	auto chunk_len = [&](size_t chunk)
+	{
+		return std::min(chunk_size, nr_frames - chunk * chunk_size);
+	};
+
+	// 1. every chunk from zero state
+	pool.parallel_for(nr_channels * nr_chunks, [&](size_t task)
+	{
+		size_t ch = task / nr_chunks, chunk = task % nr_chunks;
+		run(chunk_state(ch, chunk), in[ch] + chunk * chunk_size, out[ch] + chunk * chunk_size,
+				chunk_len(chunk));
+	});
+
+	// 2. replace the end states from zero by the true start states
+	const size_t n = get_state_size();
+	std::vector<double> carry(n), next(n);
+	for (size_t ch = 0; ch < nr_channels; ++ch) {
+		std::fill(carry.begin(), carry.end(), 0.0);
+		for (size_t chunk = 0; chunk < nr_chunks; ++chunk) {
+			dsp::BiquadState<double> *state = chunk_state(ch, chunk);
+			for (size_t r = 0; r < n; ++r) {
+				double sum = state_at(state, r);
+				for (size_t col = 0; col < n; ++col)
+					sum += chunk_transition[r * n + col] * carry[col];
+				next[r] = sum;
+			}
+			for (size_t r = 0; r < n; ++r)
+				state_at(state, r) = carry[r];
+			carry.swap(next);
+		}
+	}
+
+	// 3. the response to the start states, the first chunk starts from zero
+	pool.parallel_for(nr_channels * (nr_chunks - 1), [&](size_t task)
+	{
+		size_t ch = task / (nr_chunks - 1), chunk = task % (nr_chunks - 1) + 1;
+		add_state_response(chunk_state(ch, chunk), out[ch] + chunk * chunk_size, chunk_len(chunk));
+	});
+}
+
+
+void OfflineRenderer::render_serial(const float *const *in, float *const *out, unsigned int nr_channels,
+		size_t nr_frames) const
+{
+	std::vector<dsp::BiquadState<double>> state(stages.size());
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		std::fill(state.begin(), state.end(), dsp::BiquadState<double>());
+		run(state.data(), in[ch], out[ch], nr_frames);
+	}
+}
+
+
+size_t OfflineRenderer::get_nr_threads() const
+{
+	return pool.get_nr_threads();
+}
+
+
+size_t OfflineRenderer::get_chunk_size() const
+{
+	return chunk_size;
+}
+
+
+void OfflineRenderer::run(dsp::BiquadState<double> *state, const float *in, float *out, size_t nr_samples) const
+{
+	double buf[block_size];
+	for (size_t offset = 0; offset < nr_samples; offset += block_size) {
+		const size_t n = std::min(block_size, nr_samples - offset);
+		for (size_t i = 0; i < n; ++i)
+			buf[i] = in ? in[offset + i] : 0.0;
+
+		for (size_t stage = 0; stage < stages.size(); ++stage)
+			dsp::process_biquad(stages[stage], state[stage], buf, buf, n);
+
+		if (in) {
+			for (size_t i = 0; i < n; ++i)
+				out[offset + i] = float(buf[i]);
+		} else {
+			for (size_t i = 0; i < n; ++i)
+				out[offset + i] = float(double(out[offset + i]) + buf[i]);
+		}
+	}
+}
+
+
+void OfflineRenderer::add_state_response(dsp::BiquadState<double> *state, float *out, size_t nr_samples) const
+{
+	const size_t n = get_state_size();
+	for (size_t offset = 0; offset < nr_samples; offset += block_size) {
+		double max_state = 0.0;
+		for (size_t i = 0; i < n; ++i)
+			max_state = std::max(max_state, std::fabs(state_at(state, i)));
+		if (max_state < decay_threshold)
+			return;
+
+		run(state, nullptr, out + offset, std::min(block_size, nr_samples - offset));
+	}
+}
+
+
+size_t OfflineRenderer::get_state_size() const
+{
+	return 2 * stages.size();
+}
+
+}
@@ -0,0 +1,376 @@
+#include <audioeq/param_surface.h>
+#include <audioeq/filter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace aeq {
+
+namespace {
+
+constexpr size_t layout_size = (sizeof(ParamSurfaceLayout) + 4095) & ~size_t(4095);
+
+/* Clamp a value from another process into a range, NaN included. */
+float clamp_param(float min, float max, float value)
+{
+	if (!(value >= min))
+		return min;
+	if (!(value <= max))
+		return max;
+	return value;
+}
+
+float peak(const float *buffer, size_t nr_samples)
+{
+	if (buffer == nullptr)
+		return 0.0F;
+	// independent partial maxima, so that the loop vectorizes without reassociating NaNs
+	constexpr size_t nr_partial = 8;
+	float partial[nr_partial] = {};
+	size_t i = 0;
+	for (; i + nr_partial <= nr_samples; i += nr_partial)
+		for (size_t j = 0; j < nr_partial; ++j)
+			partial[j] = std::max(partial[j], std::fabs(buffer[i + j]));
+	for (; i < nr_samples; ++i)
+		partial[0] = std::max(partial[0], std::fabs(buffer[i]));
+	return *std::max_element(partial, partial + nr_partial);
+}
+
+}
+
+
+ParamSurface::ParamSurface(const Filter& filter, const char *shm_name)
+{
+	const std::vector<ParamInfo> params = filter.get_params();
+	const size_t nr_inputs = filter.get_nr_input_ports();
+	const size_t nr_outputs = filter.get_nr_output_ports();
+	if (params.size() > ParamSurfaceLayout::max_params)
+		throw ParamSurfaceErr({"Too many parameters for a surface."});
+	if (nr_inputs + nr_outputs > ParamSurfaceLayout::max_meters)
+		throw ParamSurfaceErr({"Too many ports for a surface."});
+	for (const ParamInfo& param : params) {
+		if (param.name.size() >= ParamSurfaceLayout::name_size)
+			throw ParamSurfaceErr(AudioEqErr("Too long parameter name - '" + param.name + "'."));
+	}
+
+	if (shm_name) {
+		fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if (fd < 0)
+			throw ParamSurfaceErr({"Failed to create shared memory object", errno});
+		name = shm_name;
+	} else {
+		fd = memfd_create("audioeq-params", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+		if (fd < 0)
+			throw ParamSurfaceErr({"Failed to create memfd", errno});
+	}
+
+	auto fail = [this](const char *msg)
+	{
+		int errnum = errno;
+		if (layout)
+			munmap(layout, layout_size);
+		::close(fd);
+		if (!name.empty())
+			shm_unlink(name.c_str());
+		throw ParamSurfaceErr({msg, errnum});
+	};
+
+	if (ftruncate(fd, layout_size) < 0)
+		fail("Failed to size the surface");
+	// a client shrinking a memfd would fault the RT thread, a named object is only trusted
+	if (!shm_name && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+		fail("Failed to seal the surface");
+
+	void *mem = mmap(nullptr, layout_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED)
+		fail("Failed to map the surface");
+	layout = new (mem) ParamSurfaceLayout();
+	// best effort, the pages are faulted in below anyway
+	mlock(layout, layout_size);
+
+	layout->magic = ParamSurfaceLayout::magic_value;
+	layout->version = ParamSurfaceLayout::layout_version;
+	layout->nr_params = params.size();
+	layout->nr_input_meters = nr_inputs;
+	layout->nr_output_meters = nr_outputs;
+	nr_params = params.size();
+	nr_input_meters = nr_inputs;
+	nr_output_meters = nr_outputs;
+	for (size_t i = 0; i < params.size(); ++i) {
+		ParamSurfaceLayout::Param& param = layout->params[i];
+		std::strncpy(param.name, params[i].name.c_str(), ParamSurfaceLayout::name_size);
+		param.min = params[i].min;
+		param.max = params[i].max;
+		param.def = params[i].def;
+		layout->values[i].store(param.def, std::memory_order_relaxed);
+		values[i] = param.def;
+		mins[i] = param.min;
+		maxs[i] = param.max;
+	}
+	layout->params_seq.store(0, std::memory_order_release);
+}
+
+
+ParamSurface::~ParamSurface()
+{
+	munmap(layout, layout_size);
+	::close(fd);
+	if (!name.empty())
+		shm_unlink(name.c_str());
+}
+
+
+int ParamSurface::get_fd() const
+{
+	return fd;
+}
+
+
+const std::string& ParamSurface::get_name() const
+{
+	return name;
+}
+
+
+size_t ParamSurface::get_nr_params() const
+{
+	return nr_params;
+}
+
+
+uint64_t ParamSurface::poll()
+{
+	const uint32_t seq = layout->params_seq.load(std::memory_order_acquire);
+	if (seq == last_seq)
+		return 0;
+
+	float fresh[ParamSurfaceLayout::max_params];
+	if ((seq & 1) == 0) {
+		for (size_t i = 0; i < nr_params; ++i)
+			fresh[i] = layout->values[i].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	if ((seq & 1) != 0 || layout->params_seq.load(std::memory_order_relaxed) != seq) {
+		layout->nr_torn_reads.fetch_add(1, std::memory_order_relaxed);
+		return 0;
+	}
+	last_seq = seq;
+
+	uint64_t changed = 0;
+	for (size_t i = 0; i < nr_params; ++i) {
+		const float value = clamp_param(mins[i], maxs[i], fresh[i]);
+		if (value != values[i]) {
+			values[i] = value;
+			changed |= uint64_t(1) << i;
+		}
+	}
+	layout->nr_param_updates.fetch_add(1, std::memory_order_relaxed);
+	return changed;
+}
+
+
+float ParamSurface::get_value(size_t index) const
+{
+	return values[index];
+}
+
+
+void ParamSurface::measure_inputs(const std::vector<float *>& inputs, size_t nr_samples)
+{
+	const size_t nr_inputs = std::min<size_t>(inputs.size(), nr_input_meters);
+	for (size_t i = 0; i < nr_inputs; ++i)
+		peaks[i] = peak(inputs[i], nr_samples);
+}
+
+
+void ParamSurface::publish_meters(const std::vector<float *>& outputs, size_t nr_samples)
+{
+	// peaks first, keeping the window readers retry on short
+	const size_t nr_meters = nr_input_meters + nr_output_meters;
+	const size_t nr_outputs = std::min<size_t>(outputs.size(), nr_output_meters);
+	for (size_t i = 0; i < nr_outputs; ++i)
+		peaks[nr_input_meters + i] = peak(outputs[i], nr_samples);
+
+	const uint32_t seq = layout->meters_seq.load(std::memory_order_relaxed);
+	layout->meters_seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t i = 0; i < nr_meters; ++i)
+		layout->meters[i].store(peaks[i], std::memory_order_relaxed);
+	layout->meters_seq.store(seq + 2, std::memory_order_release);
+}
+
+
+void ParamSurface::publish_stats(uint64_t nr_processed_quanta, uint64_t nr_skipped_quanta)
+{
+	layout->nr_processed_quanta.store(nr_processed_quanta, std::memory_order_relaxed);
+	layout->nr_skipped_quanta.store(nr_skipped_quanta, std::memory_order_relaxed);
+}
+
+
+ParamSurfaceClient::ParamSurfaceClient(const char *shm_name)
+{
+	int shm_fd = shm_open(shm_name, O_RDWR | O_CLOEXEC, 0);
+	if (shm_fd < 0)
+		throw ParamSurfaceErr({"Failed to open shared memory object", errno});
+	try {
+		map(shm_fd);
+	} catch (...) {
+		::close(shm_fd);
+		throw;
+	}
+	fd = shm_fd;
+}
+
+
+ParamSurfaceClient::ParamSurfaceClient(int fd)
+{
+	int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (dup_fd < 0)
+		throw ParamSurfaceErr({"Failed to duplicate the surface descriptor", errno});
+	try {
+		map(dup_fd);
+	} catch (...) {
+		::close(dup_fd);
+		throw;
+	}
+	this->fd = dup_fd;
+}
+
+
+ParamSurfaceClient::~ParamSurfaceClient()
+{
+	munmap(layout, layout_size);
+	::close(fd);
+}
+
+
+void ParamSurfaceClient::map(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+		throw ParamSurfaceErr({"Failed to stat the surface", errno});
+	if (size_t(st.st_size) < layout_size)
+		throw ParamSurfaceErr({"Surface is too small."});
+
+	void *mem = mmap(nullptr, layout_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED)
+		throw ParamSurfaceErr({"Failed to map the surface", errno});
+	ParamSurfaceLayout *mapped = static_cast<ParamSurfaceLayout *>(mem);
+	if (mapped->magic != ParamSurfaceLayout::magic_value || mapped->version != ParamSurfaceLayout::layout_version
+			|| mapped->nr_params > ParamSurfaceLayout::max_params
+			|| mapped->nr_input_meters + mapped->nr_output_meters > ParamSurfaceLayout::max_meters) {
+		munmap(mem, layout_size);
+		throw ParamSurfaceErr({"Not a parameter surface of this version."});
+	}
+	layout = mapped;
+}
+
+
+size_t ParamSurfaceClient::get_nr_params() const
+{
+	return layout->nr_params;
+}
+
+
+const ParamSurfaceLayout::Param& ParamSurfaceClient::get_param_info(size_t index) const
+{
+	return layout->params[index];
+}
+
+
+bool ParamSurfaceClient::find_param(std::string_view name, size_t& index) const
+{
+	for (size_t i = 0; i < layout->nr_params; ++i) {
+		const char *param_name = layout->params[i].name;
+		if (name == std::string_view(param_name, strnlen(param_name, ParamSurfaceLayout::name_size))) {
+			index = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void ParamSurfaceClient::set_params(const size_t *indices, const float *values, size_t nr_values)
+{
+	// take the sequence from even to odd, waiting out other writers
+	uint32_t seq = layout->params_seq.load(std::memory_order_relaxed);
+	while (true) {
+		if (seq & 1) {
+			std::this_thread::yield();
+			seq = layout->params_seq.load(std::memory_order_relaxed);
+			continue;
+		}
+		if (layout->params_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+					std::memory_order_relaxed))
+			break;
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (size_t i = 0; i < nr_values; ++i) {
+		if (indices[i] >= layout->nr_params)
+			continue;
+		const ParamSurfaceLayout::Param& param = layout->params[indices[i]];
+		const float value = clamp_param(param.min, param.max, values[i]);
+		layout->values[indices[i]].store(value, std::memory_order_relaxed);
+	}
+	layout->params_seq.store(seq + 2, std::memory_order_release);
+}
+
+
+void ParamSurfaceClient::set_param(size_t index, float value)
+{
+	set_params(&index, &value, 1);
+}
+
+
+float ParamSurfaceClient::get_param(size_t index) const
+{
+	// a single value is consistent on its own
+	return layout->values[index].load(std::memory_order_relaxed);
+}
+
+
+void ParamSurfaceClient::read_meters(std::vector<float>& input_peaks, std::vector<float>& output_peaks) const
+{
+	const size_t nr_inputs = layout->nr_input_meters;
+	const size_t nr_outputs = layout->nr_output_meters;
+	input_peaks.resize(nr_inputs);
+	output_peaks.resize(nr_outputs);
+	while (true) {
+		const uint32_t seq = layout->meters_seq.load(std::memory_order_acquire);
+		if (seq & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+		for (size_t i = 0; i < nr_inputs; ++i)
+			input_peaks[i] = layout->meters[i].load(std::memory_order_relaxed);
+		for (size_t i = 0; i < nr_outputs; ++i)
+			output_peaks[i] = layout->meters[nr_inputs + i].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (layout->meters_seq.load(std::memory_order_relaxed) == seq)
+			return;
+	}
+}
+
+
+ParamSurfaceStats ParamSurfaceClient::get_stats() const
+{
+	return {
+		layout->nr_processed_quanta.load(std::memory_order_relaxed),
+		layout->nr_skipped_quanta.load(std::memory_order_relaxed),
+		layout->nr_param_updates.load(std::memory_order_relaxed),
+		layout->nr_torn_reads.load(std::memory_order_relaxed),
+	};
+}
+
+}
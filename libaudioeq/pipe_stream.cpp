@@ -0,0 +1,111 @@
+#include <audioeq/pipe_stream.h>
+#include <audioeq/dsp/kernels.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+
+namespace aeq {
+
+PipeStream::PipeStream(Filter& filter, dsp::PcmFormat format, unsigned int nr_channels, size_t nr_frames)
+	: filter(filter), format(format), nr_channels(nr_channels), nr_frames(nr_frames),
+	frame_size(dsp::get_sample_size(format) * nr_channels)
+{
+	if (nr_channels == 0 || nr_frames == 0)
+		throw PipeStreamErr({"No channels or frames to stream."});
+	if (filter.get_nr_input_ports() != nr_channels || filter.get_nr_output_ports() != nr_channels)
+		throw PipeStreamErr({"Filter ports don't match the stream channels."});
+
+	buf.resize(nr_frames * frame_size);
+	channels.assign(nr_channels, std::vector<float>(nr_frames));
+	channel_ptrs.resize(nr_channels);
+}
+
+
+uint64_t PipeStream::run(int in_fd, int out_fd)
+{
+	// fails on anything but pipes, where it isn't needed
+	fcntl(in_fd, F_SETPIPE_SZ, pipe_size);
+	fcntl(out_fd, F_SETPIPE_SZ, pipe_size);
+	posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	uint64_t nr_streamed = 0;
+	size_t filled = 0;
+	while (true) {
+		size_t nr_read = read_some(in_fd, filled, frame_size - filled % frame_size);
+		filled += nr_read;
+		const size_t nr_whole_frames = filled / frame_size;
+		if (nr_whole_frames == 0)
+			break;
+
+		process(nr_whole_frames);
+		write_all(out_fd, buf.data(), nr_whole_frames * frame_size);
+		nr_streamed += nr_whole_frames;
+
+		// keep the partial frame for the next read
+		const size_t rest = filled - nr_whole_frames * frame_size;
+		std::memmove(buf.data(), buf.data() + nr_whole_frames * frame_size, rest);
+		filled = rest;
+		if (nr_read == 0)
+			break;
+	}
+	return nr_streamed;
+}
+
+
+size_t PipeStream::read_some(int fd, size_t filled, size_t min_size)
+{
+	size_t nr_read = 0;
+	while (nr_read < min_size) {
+		ssize_t ret = read(fd, buf.data() + filled + nr_read, buf.size() - filled - nr_read);
+		if (ret == 0)
+			break;
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			throw PipeStreamErr({"Failed to read input", errno});
+		}
+		nr_read += ret;
+	}
+	return nr_read;
+}
+
+
+void PipeStream::write_all(int fd, const uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t ret = write(fd, data, size);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			throw PipeStreamErr({"Failed to write output", errno});
+		}
+		data += ret;
+		size -= ret;
+	}
+}
+
+
+void PipeStream::process(size_t nr_frames)
+{
+	for (unsigned int ch = 0; ch < nr_channels; ++ch)
+		channel_ptrs[ch] = channels[ch].data();
+	dsp::kernels().deinterleave(format, buf.data(), channel_ptrs.data(), nr_channels, nr_frames);
+
+	for (size_t offset = 0; offset < nr_frames; offset += Filter::max_quantum) {
+		for (unsigned int ch = 0; ch < nr_channels; ++ch)
+			channel_ptrs[ch] = channels[ch].data() + offset;
+		filter.process_detached(channel_ptrs.data(), channel_ptrs.data(),
+				std::min(Filter::max_quantum, nr_frames - offset));
+	}
+
+	for (unsigned int ch = 0; ch < nr_channels; ++ch)
+		channel_ptrs[ch] = channels[ch].data();
+	dsp::kernels().interleave(format, channel_ptrs.data(), buf.data(), nr_channels, nr_frames);
+}
+
+}
@@ -0,0 +1,118 @@
+#include <audioeq/plugin_stage.h>
+
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace aeq {
+
+namespace {
+
+/* Copy a module into a new memfd, returns the memfd. */
+int copy_module(const char *path)
+{
+	int src = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (src < 0)
+		throw PluginStageErr({"Failed to open plugin module", errno});
+	int copy = memfd_create("audioeq-plugin", MFD_CLOEXEC);
+	if (copy < 0) {
+		int errnum = errno;
+		::close(src);
+		throw PluginStageErr({"Failed to create memfd", errnum});
+	}
+
+	char buf[1 << 16];
+	while (true) {
+		ssize_t nr_read = ::read(src, buf, sizeof(buf));
+		if (nr_read < 0 && errno == EINTR)
+			continue;
+		if (nr_read == 0)
+			break;
+		bool failed = nr_read < 0;
+		for (ssize_t done = 0; !failed && done < nr_read;) {
+			ssize_t nr_written = ::write(copy, buf + done, nr_read - done);
+			if (nr_written < 0 && errno == EINTR)
+				continue;
+			failed = nr_written <= 0;
+			done += nr_written;
+		}
+		if (failed) {
+			int errnum = errno;
+			::close(src);
+			::close(copy);
+			throw PluginStageErr({"Failed to copy plugin module", errnum});
+		}
+	}
+	::close(src);
+	return copy;
+}
+
+}
+
+
+PluginStage::PluginStage(const char *path, int sample_rate, unsigned int nr_channels, size_t max_quantum)
+{
+	if (sample_rate <= 0)
+		throw PluginStageErr({"Non-positive sample rate."});
+	if (nr_channels == 0)
+		throw PluginStageErr({"Plugin stage without channels."});
+
+	copy_fd = copy_module(path);
+	std::string copy_path = "/proc/self/fd/" + std::to_string(copy_fd);
+	handle = dlopen(copy_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (handle == nullptr) {
+		std::string msg = std::string("Failed to load plugin module: ") + dlerror();
+		::close(copy_fd);
+		throw PluginStageErr(AudioEqErr(std::move(msg)));
+	}
+
+	auto entry = reinterpret_cast<aeq_plugin_stage_func>(dlsym(handle, AEQ_PLUGIN_ENTRY));
+	desc = entry ? entry() : nullptr;
+	const char *err = nullptr;
+	if (desc == nullptr)
+		err = "No " AEQ_PLUGIN_ENTRY " entry in plugin module.";
+	else if (desc->abi_version != AEQ_PLUGIN_ABI_VERSION)
+		err = "Plugin module built for another ABI version.";
+	else if (!desc->create || !desc->destroy || !desc->process || !desc->reset)
+		err = "Incomplete plugin stage descriptor.";
+	else if ((instance = desc->create(sample_rate, nr_channels, max_quantum)) == nullptr)
+		err = "Failed to create plugin stage.";
+	if (err) {
+		dlclose(handle);
+		::close(copy_fd);
+		throw PluginStageErr({err});
+	}
+
+	// the first quantum on the RT thread must not fault in code or data
+	std::vector<float> silence(size_t(nr_channels) * max_quantum);
+	std::vector<float> out(silence.size());
+	std::vector<const float *> in_bufs;
+	std::vector<float *> out_bufs;
+	for (unsigned int ch = 0; ch < nr_channels; ++ch) {
+		in_bufs.push_back(&silence[ch * max_quantum]);
+		out_bufs.push_back(&out[ch * max_quantum]);
+	}
+	process(in_bufs.data(), out_bufs.data(), max_quantum);
+	reset();
+}
+
+
+PluginStage::~PluginStage()
+{
+	desc->destroy(instance);
+	dlclose(handle);
+	::close(copy_fd);
+}
+
+
+const char *PluginStage::get_name() const
+{
+	return desc->name ? desc->name : "";
+}
+
+}
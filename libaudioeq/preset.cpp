@@ -0,0 +1,140 @@
+#include <audioeq/preset.h>
+#include <audioeq/utils/defer.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace aeq {
+
+static_assert(sizeof(PresetBand) == 16, "Preset band layout must not change.");
+
+PresetStore::PresetStore(const char *path)
+{
+	int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		throw PresetErr({"Error: failed to open preset file", errno});
+	utils::Defer close_fd {[fd](){ ::close(fd); }};
+
+	struct stat st;
+	if (::fstat(fd, &st) < 0)
+		throw PresetErr({"Error: failed to stat preset file", errno});
+	if (size_t(st.st_size) < sizeof(FileHeader))
+		throw PresetErr({"Error: preset file too small."});
+
+	map_size = st.st_size;
+	map = ::mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	if (map == MAP_FAILED) {
+		map = nullptr;
+		throw PresetErr({"Error: failed to map preset file", errno});
+	}
+	utils::Defer unmap {[this](){ ::munmap(map, map_size); }};
+
+	const auto *base = static_cast<const unsigned char *>(map);
+	const FileHeader *header = reinterpret_cast<const FileHeader *>(base);
+	if (std::memcmp(header->magic, "AEQP", 4) != 0)
+		throw PresetErr({"Error: not a preset file."});
+	if (header->version != version)
+		throw PresetErr({"Error: unsupported preset file version."});
+
+	const size_t entries_size = size_t(header->nr_presets) * sizeof(FileEntry);
+	const size_t bands_size = size_t(header->nr_bands) * sizeof(PresetBand);
+	if (map_size < sizeof(FileHeader) + entries_size + bands_size)
+		throw PresetErr({"Error: truncated preset file."});
+
+	entries = reinterpret_cast<const FileEntry *>(base + sizeof(FileHeader));
+	bands = reinterpret_cast<const PresetBand *>(base + sizeof(FileHeader) + entries_size);
+	nr_presets = header->nr_presets;
+
+	name_index.reserve(nr_presets);
+	for (size_t i = 0; i < nr_presets; ++i) {
+		const FileEntry& entry = entries[i];
+		if (size_t(entry.first_band) + entry.nr_bands > header->nr_bands)
+			throw PresetErr({"Error: preset bands out of range."});
+		name_index.emplace(std::string_view(entry.name, strnlen(entry.name, sizeof(entry.name))), i);
+	}
+
+	unmap.cancel();
+}
+
+
+PresetStore::~PresetStore()
+{
+	if (map)
+		::munmap(map, map_size);
+}
+
+
+size_t PresetStore::get_nr_presets() const
+{
+	return nr_presets;
+}
+
+
+Preset PresetStore::get_preset(size_t index) const
+{
+	if (index >= nr_presets)
+		throw PresetErr({"Error: preset index out of range."});
+	const FileEntry& entry = entries[index];
+	return {
+		std::string_view(entry.name, strnlen(entry.name, sizeof(entry.name))),
+		bands + entry.first_band,
+		entry.nr_bands,
+	};
+}
+
+
+bool PresetStore::find_preset(std::string_view name, Preset& preset) const
+{
+	auto found_it = name_index.find(name);
+	if (found_it == name_index.end())
+		return false;
+	preset = get_preset(found_it->second);
+	return true;
+}
+
+
+void PresetStore::save(const char *path, const std::vector<PresetDesc>& presets)
+{
+	FileHeader header {};
+	std::memcpy(header.magic, "AEQP", 4);
+	header.version = version;
+	header.nr_presets = presets.size();
+
+	std::vector<FileEntry> file_entries(presets.size());
+	std::vector<PresetBand> file_bands;
+	for (size_t i = 0; i < presets.size(); ++i) {
+		const PresetDesc& preset = presets[i];
+		if (preset.name.size() > max_name_len)
+			throw PresetErr(AudioEqErr("Error: preset name too long: " + preset.name));
+		FileEntry& entry = file_entries[i];
+		std::memset(&entry, 0, sizeof(entry));
+		std::memcpy(entry.name, preset.name.data(), preset.name.size());
+		entry.first_band = file_bands.size();
+		entry.nr_bands = preset.bands.size();
+		file_bands.insert(file_bands.end(), preset.bands.begin(), preset.bands.end());
+	}
+	header.nr_bands = file_bands.size();
+
+	FILE *file = std::fopen(path, "wb");
+	if (file == nullptr)
+		throw PresetErr({"Error: failed to create preset file", errno});
+	utils::Defer close_file {[file](){ std::fclose(file); }};
+
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	if (!file_entries.empty())
+		ok = ok && std::fwrite(file_entries.data(), sizeof(FileEntry), file_entries.size(), file)
+			== file_entries.size();
+	if (!file_bands.empty())
+		ok = ok && std::fwrite(file_bands.data(), sizeof(PresetBand), file_bands.size(), file)
+			== file_bands.size();
+	if (!ok)
+		throw PresetErr({"Error: failed to write preset file", errno});
+}
+
+}
@@ -0,0 +1,427 @@
+#include <audioeq/registry_model.h>
+
+#include <pipewire/pipewire.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+
+namespace aeq {
+
+void RegistryModel::on_global(uint32_t id, const char *type, const spa_dict *props)
+{
+	std::string_view str_type {type};
+
+	if (str_type == PW_TYPE_INTERFACE_Node)
+		wrap_node(id, props);
+	else if (str_type == PW_TYPE_INTERFACE_Port)
+		wrap_port(id, props);
+	else if (str_type == PW_TYPE_INTERFACE_Link)
+		wrap_link(id, props);
+}
+
+
+void RegistryModel::on_global_remove(uint32_t id)
+{
+	if (try_unwrap_node(id))
+		return;
+	if (try_unwrap_port(id))
+		return;
+	if (try_unwrap_link(id))
+		return;
+}
+
+
+void RegistryModel::list_nodes(std::vector<Node *>& nodes) const
+{
+	std::transform(registry_objects.nodes.begin(),
+			registry_objects.nodes.end(),
+			std::back_inserter(nodes),
+			[](const auto& id_node) { return id_node.second.get(); });
+}
+
+
+Node *RegistryModel::find_node(uint32_t id) const
+{
+	auto found_it = registry_objects.nodes.find(id);
+	if (found_it == registry_objects.nodes.end())
+		return nullptr;
+	return found_it->second.get();
+}
+
+
+Node *RegistryModel::find_node_by_name(std::string_view name) const
+{
+	utils::InternedString interned;
+	if (!names.find(name, interned))
+		return nullptr;
+	auto found_it = indices.nodes_by_name.find(interned);
+	if (found_it == indices.nodes_by_name.end())
+		return nullptr;
+	return found_it->second.front();
+}
+
+
+Port *RegistryModel::find_port(uint32_t id) const
+{
+	auto found_it = registry_objects.ports.find(id);
+	if (found_it == registry_objects.ports.end())
+		return nullptr;
+	return found_it->second.get();
+}
+
+
+Port *RegistryModel::find_port(uint32_t node_id, std::string_view name, PortDirection direction) const
+{
+	utils::InternedString interned;
+	if (!names.find(name, interned))
+		return nullptr;
+	auto found_it = indices.ports_by_key.find({node_id, interned, direction});
+	if (found_it == indices.ports_by_key.end())
+		return nullptr;
+	return found_it->second;
+}
+
+
+size_t RegistryModel::get_nr_nodes() const
+{
+	return registry_objects.nodes.size();
+}
+
+
+size_t RegistryModel::get_nr_ports() const
+{
+	return registry_objects.ports.size();
+}
+
+
+size_t RegistryModel::get_nr_links() const
+{
+	return registry_objects.links.size();
+}
+
+
+void RegistryModel::wrap_node(uint32_t id, const spa_dict *props)
+{
+	// get node name
+	const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+	if (name == nullptr)
+		name = "";
+	// get node description
+	const char *description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+	if (description == nullptr)
+		description = "";
+	// get node media class
+	const char *media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+	if (media_class == nullptr)
+		media_class = "";
+
+	// create the node wrapper and store it in registry_objects
+	Node *node = new Node(Object(id), names.intern(name), names.intern(description),
+			names.intern(media_class));
+	registry_objects.nodes[id] = std::unique_ptr<Node>(node);
+	index_node(*node);
+
+	// find ports that belong to this node but were found and wrapped before this node was found and wrapped
+	auto port_it = registry_objects.nodeless_ports.find(id);
+	if (port_it == registry_objects.nodeless_ports.end())
+		return;
+
+	// set this wrapper node as an owner of these ports
+	std::vector<Port *>& ports = port_it->second;
+	for (auto port : ports) {
+		port->set_owner(*node);
+		node->add_port(*port);
+	}
+
+	// remove refs to these ports in nodeless_ports
+	registry_objects.nodeless_ports.erase(port_it);
+}
+
+
+void RegistryModel::wrap_port(uint32_t id, const spa_dict *props)
+{
+	// get port name
+	const char *name = spa_dict_lookup(props, PW_KEY_PORT_NAME);
+	if (name == nullptr)
+		name = "";
+	// get port direction
+	const char *str_direction = spa_dict_lookup(props, PW_KEY_PORT_DIRECTION);
+	if (str_direction == nullptr)
+		str_direction = "out";
+	PortDirection direction = ::strcmp(str_direction, "in") == 0 ?
+						PortDirection::Input : PortDirection::Output;
+
+	// create the port wrapper and store it in registry_objects
+	Port *port = new Port(Object(id), names.intern(name), direction);
+	registry_objects.ports[id] = std::unique_ptr<Port>(port);
+
+	// get owner node id
+	const char *str_node_id = spa_dict_lookup(props, PW_KEY_NODE_ID);
+	uint32_t node_id = str_node_id ? ::atoi(str_node_id) : 0;
+
+	// find the node in the registry_objects
+	auto node_it = registry_objects.nodes.find(node_id);
+	if (node_it != registry_objects.nodes.end()) {
+		// if the node found, assign the node as owner of the port and add port to the node
+		Node *node = node_it->second.get();
+		port->set_owner(*node);
+		node->add_port(*port);
+	} else {
+		// if the node ain't found, assign only owner id to the port, node wrapper will be assigned later when found
+		port->set_owner_id(node_id);
+		// add port to the map of nodeless ports under the node id, so when the node appears it could find the ports it owns
+		registry_objects.nodeless_ports[node_id].push_back(port);
+	}
+	index_port(*port);
+
+	// find links that were missing this port to be 'complete' and were found and wrapped before this port was found and wrapped
+	auto portless_link_it = registry_objects.portless_links.find(id);
+	if (portless_link_it == registry_objects.portless_links.end())
+		return;
+
+	// resolve links
+	std::vector<LinkInfo>& portless_links = portless_link_it->second;
+	for (auto&& link : portless_links) {
+		// if this port is an input port, the other one is output port and vice versa
+		uint32_t other_id = direction == PortDirection::Input ? link.o_port_id : link.i_port_id;
+		Port *other = find_port(other_id);
+		if (other == nullptr)
+			// if the other port is missing like this one did, just link this port to an id without wrapper
+			port->link_to_id(other_id);
+		else
+			// otherwise the link will be complete now
+			port->link_to(*other);
+	}
+	// this links aren't missing this port anymore, so remove them
+	registry_objects.portless_links.erase(portless_link_it);
+}
+
+
+void RegistryModel::wrap_link(uint32_t id, const spa_dict *props)
+{
+	const char *str_port_id;
+	// get output port id
+	str_port_id = spa_dict_lookup(props, PW_KEY_LINK_OUTPUT_PORT);
+	uint32_t o_port_id = str_port_id ? ::atoi(str_port_id) : 0;
+	// get input port id
+	str_port_id = spa_dict_lookup(props, PW_KEY_LINK_INPUT_PORT);
+	uint32_t i_port_id = str_port_id ? ::atoi(str_port_id) : 0;
+
+	// find the ports if present
+	Port *o_port = find_port(o_port_id);
+	Port *i_port = find_port(i_port_id);
+
+	// store the link info in the registry_objects, only ids so that removed ports never dangle here
+	LinkInfo link {i_port_id, o_port_id};
+	registry_objects.links[id] = link;
+
+	if (o_port && i_port) {
+		// if both ports present, fully link them
+		o_port->link_to(*i_port);
+		return;
+	}
+
+	if (o_port) {
+		// if input port is missing but output port isn't, link output port to an input port id
+		o_port->link_to_id(i_port_id);
+		// and store it in the portless_links map under the input port id
+		registry_objects.portless_links[i_port_id].push_back(link);
+	}
+
+	if (i_port) {
+		// if output port is missing but input port isn't, link input port to an output port id
+		i_port->link_to_id(o_port_id);
+		// and store it in the portless_links map under the output port id
+		registry_objects.portless_links[o_port_id].push_back(link);
+	}
+
+	if (i_port != o_port)
+		return;
+
+	// if both ports are missing, store the link info under both input and output port IDs
+	registry_objects.portless_links[i_port_id].push_back(link);
+	registry_objects.portless_links[o_port_id].push_back(link);
+}
+
+
+bool RegistryModel::try_unwrap_node(uint32_t id)
+{
+	// find the node
+	auto node_it = registry_objects.nodes.find(id);
+	if (node_it == registry_objects.nodes.end())
+		return false;
+
+	Node *node = node_it->second.get();
+
+	// unown all its ports
+	size_t num_ports = node->get_nr_i_ports();
+	for (size_t i = 0; i < num_ports; ++i) {
+		Port& port = node->get_i_port(i);
+		unindex_port(port);
+		port.unown();
+	}
+
+	num_ports = node->get_nr_o_ports();
+	for (size_t i = 0; i < num_ports; ++i) {
+		Port& port = node->get_o_port(i);
+		unindex_port(port);
+		port.unown();
+	}
+
+	unindex_node(*node);
+	release_names(*node);
+
+	// remove it from registry_objects
+	registry_objects.nodes.erase(node_it);
+	return true;
+}
+
+
+bool RegistryModel::try_unwrap_port(uint32_t id)
+{
+	// find the port
+	auto port_it = registry_objects.ports.find(id);
+	if (port_it == registry_objects.ports.end())
+		return false;
+
+	Port *port = port_it->second.get();
+
+	// unlink from all its linked ports
+	size_t num_links = port->get_nr_linked_ports();
+	while (num_links > 0) {
+		auto linked_port = port->get_linked_port(--num_links);
+		if (linked_port) [[likely]]
+			linked_port->unlink_from(*port);
+	}
+
+	unindex_port(*port);
+
+	// detach from its owner, or from the ports waiting for it, so that no pointer to it is left behind
+	if (Node *owner = port->get_owner())
+		owner->rem_port(*port);
+	else
+		forget_nodeless_port(*port);
+	release_names(*port);
+
+	// remove it from registry_objects
+	registry_objects.ports.erase(port_it);
+	return true;
+}
+
+
+bool RegistryModel::try_unwrap_link(uint32_t id)
+{
+	// find the link
+	auto link_it = registry_objects.links.find(id);
+	if (link_it == registry_objects.links.end())
+		return false;
+
+	LinkInfo& link = link_it->second;
+
+	// unlink its ports one from each other
+	if (Port *i_port = find_port(link.i_port_id))
+		i_port->unlink_from_id(link.o_port_id);
+	if (Port *o_port = find_port(link.o_port_id))
+		o_port->unlink_from_id(link.i_port_id);
+
+	// a link removed before its ports appeared must not wait for them anymore
+	forget_portless_link(link.i_port_id, link);
+	forget_portless_link(link.o_port_id, link);
+
+	// remove it from registry_objects
+	registry_objects.links.erase(link_it);
+	return true;
+}
+
+
+void RegistryModel::index_node(Node& node)
+{
+	indices.nodes_by_name[node.name].push_back(&node);
+	indices.nodes_by_media_class[node.media_class].insert(&node);
+}
+
+
+void RegistryModel::unindex_node(Node& node)
+{
+	auto name_it = indices.nodes_by_name.find(node.name);
+	if (name_it != indices.nodes_by_name.end()) {
+		std::vector<Node *>& nodes = name_it->second;
+		nodes.erase(std::find(nodes.begin(), nodes.end(), &node));
+		if (nodes.empty())
+			indices.nodes_by_name.erase(name_it);
+	}
+
+	auto class_it = indices.nodes_by_media_class.find(node.media_class);
+	if (class_it != indices.nodes_by_media_class.end()) {
+		class_it->second.erase(&node);
+		if (class_it->second.empty())
+			indices.nodes_by_media_class.erase(class_it);
+	}
+}
+
+
+void RegistryModel::index_port(Port& port)
+{
+	indices.ports_by_key[{port.get_owner_id(), port.name, port.direction}] = &port;
+}
+
+
+void RegistryModel::unindex_port(Port& port)
+{
+	// another port with the same key may have replaced this one
+	auto found_it = indices.ports_by_key.find({port.get_owner_id(), port.name, port.direction});
+	if (found_it != indices.ports_by_key.end() && found_it->second == &port)
+		indices.ports_by_key.erase(found_it);
+}
+
+
+void RegistryModel::forget_nodeless_port(Port& port)
+{
+	auto nodeless_it = registry_objects.nodeless_ports.find(port.get_owner_id());
+	if (nodeless_it == registry_objects.nodeless_ports.end())
+		return;
+
+	std::vector<Port *>& ports = nodeless_it->second;
+	ports.erase(std::remove(ports.begin(), ports.end(), &port), ports.end());
+	// the owner may never appear, don't keep its entry around
+	if (ports.empty())
+		registry_objects.nodeless_ports.erase(nodeless_it);
+}
+
+
+void RegistryModel::forget_portless_link(uint32_t port_id, const LinkInfo& link)
+{
+	auto portless_it = registry_objects.portless_links.find(port_id);
+	if (portless_it == registry_objects.portless_links.end())
+		return;
+
+	// links between the same ports are interchangeable here, drop one of them
+	std::vector<LinkInfo>& links = portless_it->second;
+	auto found_it = std::find_if(links.begin(), links.end(), [&link](const LinkInfo& other) {
+		return other.i_port_id == link.i_port_id && other.o_port_id == link.o_port_id;
+	});
+	if (found_it != links.end())
+		links.erase(found_it);
+	if (links.empty())
+		registry_objects.portless_links.erase(portless_it);
+}
+
+
+void RegistryModel::release_names(Node& node)
+{
+	names.release(node.name);
+	names.release(node.description);
+	names.release(node.media_class);
+}
+
+
+void RegistryModel::release_names(Port& port)
+{
+	names.release(port.name);
+}
+
+}
@@ -0,0 +1,161 @@
+#include <audioeq/registry_recording.h>
+#include <audioeq/utils/defer.h>
+
+#include <cstdio>
+#include <cstring>
+
+
+namespace aeq {
+
+namespace {
+
+struct FileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t nr_events;
+};
+
+bool write_u32(FILE *file, uint32_t value)
+{
+	return std::fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+bool write_str(FILE *file, const std::string& str)
+{
+	return write_u32(file, str.size())
+		&& (str.empty() || std::fwrite(str.data(), 1, str.size(), file) == str.size());
+}
+
+bool read_u32(FILE *file, uint32_t& value)
+{
+	return std::fread(&value, sizeof(value), 1, file) == 1;
+}
+
+bool read_str(FILE *file, std::string& str)
+{
+	uint32_t size;
+	if (!read_u32(file, size))
+		return false;
+	str.resize(size);
+	return size == 0 || std::fread(str.data(), 1, size, file) == size;
+}
+
+}
+
+
+RegistryRecording::RegistryRecording(const char *path)
+{
+	FILE *file = std::fopen(path, "rb");
+	if (file == nullptr)
+		throw RegistryRecordingErr({"Error: failed to open registry recording", errno});
+	utils::Defer close_file {[file](){ std::fclose(file); }};
+
+	FileHeader header;
+	if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, "AEQR", 4) != 0)
+		throw RegistryRecordingErr({"Error: not a registry recording."});
+	if (header.version != version)
+		throw RegistryRecordingErr({"Error: unsupported registry recording version."});
+
+	events.resize(header.nr_events);
+	for (Event& event : events) {
+		uint8_t kind;
+		uint32_t nr_props;
+		bool ok = std::fread(&kind, sizeof(kind), 1, file) == 1
+			&& read_u32(file, event.id)
+			&& read_str(file, event.type)
+			&& read_u32(file, nr_props);
+		if (!ok || kind > uint8_t(Event::Kind::GlobalRemove))
+			throw RegistryRecordingErr({"Error: truncated registry recording."});
+		event.kind = Event::Kind(kind);
+
+		event.props.resize(nr_props);
+		for (auto& [key, value] : event.props) {
+			if (!read_str(file, key) || !read_str(file, value))
+				throw RegistryRecordingErr({"Error: truncated registry recording."});
+		}
+	}
+}
+
+
+void RegistryRecording::record_global(uint32_t id, const char *type, const spa_dict *props)
+{
+	Event& event = events.emplace_back(Event{Event::Kind::Global, id, type, {}});
+	if (props == nullptr)
+		return;
+	event.props.reserve(props->n_items);
+	for (uint32_t i = 0; i < props->n_items; ++i) {
+		const spa_dict_item& item = props->items[i];
+		event.props.emplace_back(item.key, item.value ? item.value : "");
+	}
+}
+
+
+void RegistryRecording::record_global_remove(uint32_t id)
+{
+	events.push_back({Event::Kind::GlobalRemove, id, {}, {}});
+}
+
+
+void RegistryRecording::replay(RegistryModel& model) const
+{
+	std::vector<spa_dict_item> items;
+	for (const Event& event : events) {
+		if (event.kind == Event::Kind::GlobalRemove) {
+			model.on_global_remove(event.id);
+			continue;
+		}
+
+		items.clear();
+		for (const auto& [key, value] : event.props)
+			items.push_back(SPA_DICT_ITEM_INIT(key.c_str(), value.c_str()));
+		spa_dict props = SPA_DICT_INIT(items.data(), uint32_t(items.size()));
+		model.on_global(event.id, event.type.c_str(), &props);
+	}
+}
+
+
+void RegistryRecording::save(const char *path) const
+{
+	FILE *file = std::fopen(path, "wb");
+	if (file == nullptr)
+		throw RegistryRecordingErr({"Error: failed to create registry recording", errno});
+	utils::Defer close_file {[file](){ std::fclose(file); }};
+
+	FileHeader header {};
+	std::memcpy(header.magic, "AEQR", 4);
+	header.version = version;
+	header.nr_events = events.size();
+
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	for (const Event& event : events) {
+		const uint8_t kind = uint8_t(event.kind);
+		ok = ok && std::fwrite(&kind, sizeof(kind), 1, file) == 1
+			&& write_u32(file, event.id)
+			&& write_str(file, event.type)
+			&& write_u32(file, event.props.size());
+		for (const auto& [key, value] : event.props)
+			ok = ok && write_str(file, key) && write_str(file, value);
+	}
+	if (!ok)
+		throw RegistryRecordingErr({"Error: failed to write registry recording", errno});
+}
+
+
+void RegistryRecording::clear()
+{
+	events.clear();
+}
+
+
+size_t RegistryRecording::get_nr_events() const
+{
+	return events.size();
+}
+
+
+const RegistryRecording::Event& RegistryRecording::get_event(size_t index) const
+{
+	return events.at(index);
+}
+
+}
@@ -0,0 +1,104 @@
+#include <audioeq/routing.h>
+
+#include <algorithm>
+
+
+namespace aeq {
+
+RoutingRules::RoutingRules(std::vector<RoutingRule> rules) : rules(std::move(rules)), trie(1)
+{
+	for (size_t i = 0; i < this->rules.size(); ++i) {
+		const RoutingRule& rule = this->rules[i];
+		if (!rule.node_name_prefix.empty())
+			add_to_trie(rule.node_name_prefix, i);
+		else if (!rule.media_class.empty())
+			by_media_class[rule.media_class].push_back(i);
+		else
+			match_all.push_back(i);
+		by_target[rule.target_node_name].push_back(i);
+	}
+}
+
+
+void RoutingRules::match(std::string_view node_name, std::string_view media_class,
+		std::vector<size_t>& matched) const
+{
+	const size_t first = matched.size();
+
+	// every trie node on the path of the name is the end of a matching prefix
+	if (!trie.empty()) {
+		uint32_t node = 0;
+		for (char c : node_name) {
+			const auto& children = trie[node].children;
+			auto child_it = std::lower_bound(children.begin(), children.end(), c,
+					[](const auto& child, char c) { return child.first < c; });
+			if (child_it == children.end() || child_it->first != c)
+				break;
+			node = child_it->second;
+			for (size_t rule : trie[node].rules) {
+				const std::string& rule_class = rules[rule].media_class;
+				if (rule_class.empty() || rule_class == media_class)
+					matched.push_back(rule);
+			}
+		}
+	}
+
+	if (!media_class.empty()) {
+		auto class_it = by_media_class.find(std::string(media_class));
+		if (class_it != by_media_class.end())
+			matched.insert(matched.end(), class_it->second.begin(), class_it->second.end());
+	}
+
+	matched.insert(matched.end(), match_all.begin(), match_all.end());
+	std::sort(matched.begin() + first, matched.end());
+}
+
+
+const std::vector<size_t> *RoutingRules::find_targeting(const std::string& node_name) const
+{
+	auto found_it = by_target.find(node_name);
+	if (found_it == by_target.end())
+		return nullptr;
+	return &found_it->second;
+}
+
+
+const RoutingRule& RoutingRules::get_rule(size_t index) const
+{
+	return rules[index];
+}
+
+
+size_t RoutingRules::get_nr_rules() const
+{
+	return rules.size();
+}
+
+
+const std::vector<RoutingRule>& RoutingRules::get_rules() const
+{
+	return rules;
+}
+
+
+void RoutingRules::add_to_trie(std::string_view prefix, size_t rule)
+{
+	uint32_t node = 0;
+	for (char c : prefix) {
+		auto& children = trie[node].children;
+		auto child_it = std::lower_bound(children.begin(), children.end(), c,
+				[](const auto& child, char c) { return child.first < c; });
+		if (child_it != children.end() && child_it->first == c) {
+			node = child_it->second;
+			continue;
+		}
+		uint32_t child = trie.size();
+		children.insert(child_it, {c, child});
+		// children is invalidated by the emplace
+		trie.emplace_back();
+		node = child;
+	}
+	trie[node].rules.push_back(rule);
+}
+
+}
@@ -0,0 +1,109 @@
+#include <audioeq/thread_settings.h>
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+
+namespace aeq {
+
+namespace {
+
+constexpr size_t nr_roles = 4;
+
+std::mutex settings_mutex;
+std::array<ThreadSettings, nr_roles> role_settings;
+std::array<std::atomic<int>, nr_roles> role_errors {};
+
+/* Touch size bytes below the current stack frame, the pages stay mapped after returning. */
+__attribute__((noinline)) void prefault_stack(size_t size)
+{
+	char *stack = static_cast<char *>(alloca(size));
+	std::memset(stack, 0, size);
+	// the stores are otherwise dead, and so may be the alloca
+	asm volatile("" : : "r"(stack) : "memory");
+}
+
+}
+
+
+void set_thread_settings(ThreadRole role, const ThreadSettings& settings)
+{
+	if (settings.fifo_priority < 0 || settings.fifo_priority > 99)
+		throw ThreadSettingsErr({"SCHED_FIFO priority out of range."});
+	for (unsigned int cpu : settings.cpus) {
+		if (cpu >= CPU_SETSIZE)
+			throw ThreadSettingsErr({"CPU index out of range."});
+	}
+
+	std::lock_guard lock {settings_mutex};
+	role_settings[static_cast<size_t>(role)] = settings;
+}
+
+
+ThreadSettings get_thread_settings(ThreadRole role)
+{
+	std::lock_guard lock {settings_mutex};
+	return role_settings[static_cast<size_t>(role)];
+}
+
+
+int apply_thread_settings(const ThreadSettings& settings) noexcept
+{
+	int err = 0;
+	if (!settings.cpus.empty()) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (unsigned int cpu : settings.cpus) {
+			if (cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &cpus);
+		}
+		int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		if (ret != 0 && err == 0)
+			err = ret;
+	}
+	if (settings.fifo_priority > 0) {
+		sched_param param {};
+		param.sched_priority = settings.fifo_priority;
+		int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (ret != 0 && err == 0)
+			err = ret;
+	}
+	if (settings.prefault_stack_size > 0)
+		prefault_stack(settings.prefault_stack_size);
+	return err;
+}
+
+
+void apply_thread_settings(ThreadRole role) noexcept
+{
+	const size_t idx = static_cast<size_t>(role);
+	int err;
+	{
+		std::lock_guard lock {settings_mutex};
+		err = apply_thread_settings(role_settings[idx]);
+	}
+	if (err != 0)
+		role_errors[idx].store(err, std::memory_order_relaxed);
+}
+
+
+int get_thread_settings_error(ThreadRole role)
+{
+	return role_errors[static_cast<size_t>(role)].load(std::memory_order_relaxed);
+}
+
+
+void lock_memory()
+{
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+		throw ThreadSettingsErr({"Failed to lock memory", errno});
+}
+
+}
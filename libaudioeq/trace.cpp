@@ -0,0 +1,122 @@
+#include <audioeq/trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+
+namespace aeq::trace {
+
+namespace {
+
+constexpr size_t nr_thread_rings = 32;
+constexpr size_t ring_capacity = 1 << 14;
+
+struct Event {
+	uint64_t ts_ns;
+	const char *name;
+	Phase phase;
+};
+
+struct ThreadRing {
+	std::atomic<uint64_t> write_idx {0};
+	Event events[ring_capacity];
+};
+
+std::mutex setup_mutex;
+std::unique_ptr<ThreadRing[]> rings_storage;
+std::atomic<ThreadRing *> rings {nullptr};
+std::atomic<size_t> nr_claimed_rings {0};
+
+thread_local ThreadRing *thread_ring = nullptr;
+thread_local bool thread_ring_claimed = false;
+
+uint64_t now_ns() noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ThreadRing *claim_thread_ring() noexcept
+{
+	ThreadRing *all_rings = rings.load(std::memory_order_acquire);
+	if (all_rings == nullptr)
+		return nullptr;
+	thread_ring_claimed = true;
+	size_t idx = nr_claimed_rings.fetch_add(1, std::memory_order_relaxed);
+	if (idx >= nr_thread_rings)
+		return nullptr;
+	return &all_rings[idx];
+}
+
+}
+
+
+std::atomic<bool> detail::enabled {false};
+
+
+void enable(bool enabled)
+{
+	if (enabled) {
+		std::lock_guard lock {setup_mutex};
+		if (rings_storage == nullptr) {
+			rings_storage = std::make_unique<ThreadRing[]>(nr_thread_rings);
+			rings.store(rings_storage.get(), std::memory_order_release);
+		}
+	}
+	detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+void emit(const char *name, Phase phase) noexcept
+{
+	if (!thread_ring_claimed)
+		thread_ring = claim_thread_ring();
+	if (thread_ring == nullptr)
+		return;
+
+	uint64_t w = thread_ring->write_idx.load(std::memory_order_relaxed);
+	thread_ring->events[w & (ring_capacity - 1)] = {now_ns(), name, phase};
+	thread_ring->write_idx.store(w + 1, std::memory_order_release);
+}
+
+
+void dump_chrome_json(std::ostream& os)
+{
+	ThreadRing *all_rings = rings.load(std::memory_order_acquire);
+	size_t nr_rings = std::min(nr_claimed_rings.load(), nr_thread_rings);
+
+	os << "{\"traceEvents\":[";
+	bool first = true;
+	for (size_t tid = 0; all_rings && tid < nr_rings; ++tid) {
+		ThreadRing& ring = all_rings[tid];
+		uint64_t w = ring.write_idx.load(std::memory_order_acquire);
+		uint64_t r = w > ring_capacity ? w - ring_capacity : 0;
+		for (; r < w; ++r) {
+			const Event& event = ring.events[r & (ring_capacity - 1)];
+			os << (first ? "\n" : ",\n");
+			first = false;
+			// Chrome trace timestamps are in microseconds
+			os << "{\"name\":\"" << event.name << "\",\"ph\":\"" << static_cast<char>(event.phase)
+			   << "\",\"ts\":" << event.ts_ns / 1000 << '.' << (event.ts_ns % 1000) / 100
+			   << ",\"pid\":1,\"tid\":" << tid;
+			if (event.phase == Phase::Instant)
+				os << ",\"s\":\"t\"";
+			os << '}';
+		}
+	}
+	os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+
+void clear()
+{
+	ThreadRing *all_rings = rings.load(std::memory_order_acquire);
+	if (all_rings == nullptr)
+		return;
+	for (size_t i = 0; i < nr_thread_rings; ++i)
+		all_rings[i].write_idx.store(0, std::memory_order_relaxed);
+}
+
+}
@@ -1,11 +1,23 @@
 #include "audioeq/audioeq.h"
 #include "audioeq/filters/low_pass.h"
-
+#include "audioeq/filters/equalizer.h"
+#include "audioeq/trace.h"
+#include "audioeq/dsp/kernels.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
+#include <unistd.h>
+
 constexpr float cutoff_freq = 2000;
 constexpr int sample_rate = 44100;
 constexpr int nr_channels = 2;
@@ -16,6 +28,11 @@ public:
 	struct CommandContext {
 		aeq::Core& core;
 		aeq::filters::LowPassFilter& low_pass_filter;
+		aeq::AnalysisTap& input_tap;
+		aeq::AnalysisTap& output_tap;
+		aeq::RegistryRecording& recording;
+		std::unique_ptr<aeq::CaptureTap>& capture;
+		std::unique_ptr<aeq::ParamSurface>& surface;
 	};
 
 	using CommandFunc = std::function<void (std::stringstream& cmdline_ss, CommandContext& context)>;
@@ -31,25 +48,161 @@ private:
 	static void do_unlink(std::stringstream& cmdline_ss, CommandContext& context);
 	static void do_list(std::stringstream& cmdline_ss, CommandContext& context);
 	static void do_freq(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_levels(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_stats(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_trace(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_record(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_capture(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_surface(std::stringstream& cmdline_ss, CommandContext& context);
+	static void do_route(std::stringstream& cmdline_ss, CommandContext& context);
 
 	static CommandsMap commands;
 };
 
 
+/* Streaming mode, no pipewire graph:
+ *	audioeq --pipe [--format f32|s16|s32] [--channels N] [--rate HZ] [--cutoff HZ]
+ *			[--preset FILE NAME]
+ * Raw interleaved PCM is read from stdin and written to stdout, through the low pass filter
+ * or, with --preset, through an equalizer running the preset. */
+static int run_pipe(int argc, char *argv[]);
+
+
 int main(int argc, char *argv[])
 {
+	if (argc > 1 && std::strcmp(argv[1], "--pipe") == 0)
+		return run_pipe(argc, argv);
+
 	aeq::Core core {argc, argv};
 
+	// taps are declared before the filter so that they outlive it
+	aeq::AnalysisTap input_tap {nr_channels, sample_rate};
+	aeq::AnalysisTap output_tap {nr_channels, sample_rate};
+	std::unique_ptr<aeq::CaptureTap> capture;
+	std::unique_ptr<aeq::ParamSurface> surface;
+
 	aeq::filters::LowPassFilter low_pass_filter {cutoff_freq, sample_rate, nr_channels};
 	core.init_filter(low_pass_filter, "AudioEQ: low pass filter");
-
-	BoringCLI boring_cli {{.core = core, .low_pass_filter = low_pass_filter}};
+	low_pass_filter.set_silence_detection(true);
+	low_pass_filter.attach_tap(aeq::TapPoint::Input, &input_tap);
+	low_pass_filter.attach_tap(aeq::TapPoint::Output, &output_tap);
+
+	aeq::RegistryRecording recording;
+
+	BoringCLI boring_cli {{
+		.core = core,
+		.low_pass_filter = low_pass_filter,
+		.input_tap = input_tap,
+		.output_tap = output_tap,
+		.recording = recording,
+		.capture = capture,
+		.surface = surface,
+	}};
 	boring_cli.run();
+	core.set_recording(nullptr);
 
 	return 0;
 }
 
 
+/* Parse a whole string as a positive number, false if it isn't one. */
+static bool parse_positive(const char *str, long& value)
+{
+	char *end;
+	errno = 0;
+	value = std::strtol(str, &end, 10);
+	return end != str && *end == '\0' && errno == 0 && value > 0;
+}
+
+static bool parse_positive(const char *str, float& value)
+{
+	char *end;
+	errno = 0;
+	value = std::strtof(str, &end);
+	return end != str && *end == '\0' && errno == 0 && std::isfinite(value) && value > 0;
+}
+
+
+static int run_pipe(int argc, char *argv[])
+{
+	aeq::dsp::PcmFormat format = aeq::dsp::PcmFormat::F32;
+	unsigned int pipe_nr_channels = nr_channels;
+	int pipe_sample_rate = sample_rate;
+	float pipe_cutoff_freq = cutoff_freq;
+	const char *preset_path = nullptr;
+	const char *preset_name = nullptr;
+
+	for (int i = 2; i < argc; ++i) {
+		std::string option = argv[i];
+		int nr_args = option == "--preset" ? 2 : 1;
+		if (i + nr_args >= argc) {
+			std::cerr << "Error: missing value of '" << option << "'." << std::endl;
+			return 1;
+		}
+		if (option == "--format") {
+			if (!aeq::dsp::parse_pcm_format(argv[i + 1], format)) {
+				std::cerr << "Error: unknown format - '" << argv[i + 1] << "'." << std::endl;
+				return 1;
+			}
+		} else if (option == "--channels" || option == "--rate") {
+			long value;
+			if (!parse_positive(argv[i + 1], value) || value > INT_MAX) {
+				std::cerr << "Error: invalid value of '" << option << "' - '" << argv[i + 1] << "'." << std::endl;
+				return 1;
+			}
+			if (option == "--channels")
+				pipe_nr_channels = value;
+			else
+				pipe_sample_rate = value;
+		} else if (option == "--cutoff") {
+			if (!parse_positive(argv[i + 1], pipe_cutoff_freq)) {
+				std::cerr << "Error: invalid value of '" << option << "' - '" << argv[i + 1] << "'." << std::endl;
+				return 1;
+			}
+		} else if (option == "--preset") {
+			preset_path = argv[i + 1];
+			preset_name = argv[i + 2];
+		} else {
+			std::cerr << "Error: unknown option - '" << option << "'." << std::endl;
+			return 1;
+		}
+		i += nr_args;
+	}
+
+	try {
+		std::unique_ptr<aeq::Filter> filter;
+		if (preset_path) {
+			aeq::PresetStore store {preset_path};
+			aeq::Preset preset;
+			if (!store.find_preset(preset_name, preset)) {
+				std::cerr << "Error: no such preset - '" << preset_name << "'." << std::endl;
+				return 1;
+			}
+			// no crossfade, the curve applies from the first sample
+			auto equalizer = std::make_unique<aeq::filters::EqualizerFilter>(pipe_sample_rate,
+					pipe_nr_channels, 0.0F);
+			equalizer->load_preset(preset);
+			filter = std::move(equalizer);
+		} else {
+			if (pipe_nr_channels > 2) {
+				std::cerr << "Error: the low pass filter takes 1 or 2 channels." << std::endl;
+				return 1;
+			}
+			filter = std::make_unique<aeq::filters::LowPassFilter>(pipe_cutoff_freq,
+					pipe_sample_rate, pipe_nr_channels);
+		}
+		filter->init_detached();
+
+		aeq::PipeStream stream {*filter, format, pipe_nr_channels};
+		stream.run(STDIN_FILENO, STDOUT_FILENO);
+	} catch (const aeq::AudioEqErr& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+
 void BoringCLI::run()
 {
 	std::string command_line;
@@ -74,6 +227,8 @@ void BoringCLI::run()
 			std::cerr << "Error: no such command - '" << command << "'." << std::endl;
 			continue;
 		}
+		// the key outlives the trace, the commands map is static
+		aeq::trace::Scope trace_scope {found_command_it->first.c_str()};
 		found_command_it->second(command_line_ss, context);
 	}
 }
@@ -139,27 +294,32 @@ void BoringCLI::do_list(std::stringstream& cmdline_ss, CommandContext& context)
 	core.lock_loop();
 	aeq::utils::Defer defer{[&core = core](){core.unlock_loop();}};
 
-	std::vector<aeq::Node *> nodes;
-	core.list_nodes(nodes);
-
-	for (auto node : nodes) {
-		std::cout << node->get_id() << ": " << node->get_name() << ": "
-			  << node->get_descripiton() << std::endl;
+	auto print_node = [](const aeq::Node& node)
+	{
+		std::cout << node.get_id() << ": " << node.get_name() << ": "
+			  << node.get_descripiton() << std::endl;
 
 		std::cout << "Input ports:" << std::endl;
-		size_t nr_ports = node->get_nr_i_ports();
+		size_t nr_ports = node.get_nr_i_ports();
 		for (size_t i = 0; i < nr_ports; ++i) {
-			auto& port = node->get_i_port(i);
+			auto& port = node.get_i_port(i);
 			std::cout << '\t' << port.get_id() << ": " << port.get_name() << std::endl;
 		}
 
 		std::cout << "Output ports:" << std::endl;
-		nr_ports = node->get_nr_o_ports();
+		nr_ports = node.get_nr_o_ports();
 		for (size_t i = 0; i < nr_ports; ++i) {
-			auto& port = node->get_o_port(i);
+			auto& port = node.get_o_port(i);
 			std::cout << '\t' << port.get_id() << ": " << port.get_name() << std::endl;
 		}
-	}
+	};
+
+	// optionally only the nodes of a media class
+	std::string media_class;
+	if (cmdline_ss >> media_class)
+		core.for_each_node_of_class(media_class, print_node);
+	else
+		core.for_each_node(print_node);
 }
 
 
@@ -182,9 +342,216 @@ void BoringCLI::do_freq(std::stringstream& cmdline_ss, CommandContext& context)
 }
 
 
+void BoringCLI::do_levels(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	auto to_db = [](float level) { return 20.F * std::log10(std::max(level, 1e-6F)); };
+
+	auto print_levels = [&to_db](const char *label, const aeq::AnalysisTap& tap)
+	{
+		std::cout << label << ":" << std::endl;
+		for (unsigned int i = 0; i < tap.get_nr_channels(); ++i) {
+			auto levels = tap.get_levels(i);
+			std::cout << '\t' << i << ": peak " << to_db(levels.peak) << " dB, rms "
+				  << to_db(levels.rms) << " dB" << std::endl;
+		}
+		std::cout << "\tdropped blocks: " << tap.get_nr_dropped() << std::endl;
+	};
+
+	print_levels("Input", context.input_tap);
+	print_levels("Output", context.output_tap);
+}
+
+
+void BoringCLI::do_stats(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	std::cout << "Processed quanta: " << context.low_pass_filter.get_nr_processed_quanta() << std::endl;
+	std::cout << "Skipped silent quanta: " << context.low_pass_filter.get_nr_skipped_quanta() << std::endl;
+	std::cout << "DSP kernels: " << aeq::dsp::isa_name(aeq::dsp::kernels().isa) << std::endl;
+	if (context.capture) {
+		std::cout << "Capture overruns: " << context.capture->get_nr_overruns() << " ("
+			  << context.capture->get_nr_dropped_frames() << " frames), written "
+			  << context.capture->get_nr_bytes_written() << " bytes" << std::endl;
+	}
+}
+
+
+void BoringCLI::do_trace(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	std::string action;
+	cmdline_ss >> action;
+
+	if (action == "on") {
+		aeq::trace::enable(true);
+	} else if (action == "off") {
+		aeq::trace::enable(false);
+	} else if (action == "clear") {
+		aeq::trace::clear();
+	} else if (action == "dump") {
+		std::string path;
+		if (!(cmdline_ss >> path)) {
+			std::cerr << "Error: no trace file given." << std::endl;
+			return;
+		}
+		std::ofstream trace_file {path};
+		if (!trace_file) {
+			std::cerr << "Error: failed to open '" << path << "'." << std::endl;
+			return;
+		}
+		aeq::trace::dump_chrome_json(trace_file);
+	} else {
+		std::cerr << "Error: usage - trace on|off|clear|dump <file>." << std::endl;
+	}
+}
+
+
+void BoringCLI::do_record(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	std::string action;
+	cmdline_ss >> action;
+
+	if (action == "start") {
+		context.core.set_recording(nullptr);
+		context.recording.clear();
+		context.core.set_recording(&context.recording);
+	} else if (action == "stop") {
+		context.core.set_recording(nullptr);
+		std::string path;
+		if (!(cmdline_ss >> path))
+			return;
+		try {
+			context.recording.save(path.c_str());
+		} catch (const aeq::RegistryRecordingErr& e) {
+			std::cerr << e.what() << std::endl;
+			return;
+		}
+		std::cout << "Saved " << context.recording.get_nr_events() << " events." << std::endl;
+	} else {
+		std::cerr << "Error: usage - record start|stop [file]." << std::endl;
+	}
+}
+
+
+void BoringCLI::do_capture(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	std::string action;
+	cmdline_ss >> action;
+
+	auto stop_capture = [&context]()
+	{
+		if (!context.capture)
+			return;
+		context.low_pass_filter.attach_capture(nullptr);
+		// wait for the quantum that may still be writing into it
+		context.core.invoke_on_data_loop([](void *) {}, nullptr);
+		context.capture.reset();
+	};
+
+	if (action == "start") {
+		std::string path;
+		if (!(cmdline_ss >> path)) {
+			std::cerr << "Error: no capture file given." << std::endl;
+			return;
+		}
+		stop_capture();
+		try {
+			// inputs and outputs of the filter
+			context.capture = std::make_unique<aeq::CaptureTap>(path.c_str(), 2 * nr_channels, sample_rate);
+		} catch (const aeq::CaptureTapErr& e) {
+			std::cerr << e.what() << std::endl;
+			return;
+		}
+		context.low_pass_filter.attach_capture(context.capture.get());
+	} else if (action == "stop") {
+		stop_capture();
+	} else {
+		std::cerr << "Error: usage - capture start <file>|stop." << std::endl;
+	}
+}
+
+
+void BoringCLI::do_surface(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	std::string action;
+	cmdline_ss >> action;
+
+	auto close_surface = [&context]()
+	{
+		if (!context.surface)
+			return;
+		context.low_pass_filter.attach_param_surface(nullptr);
+		// wait for the quantum that may still be reading it
+		context.core.invoke_on_data_loop([](void *) {}, nullptr);
+		context.surface.reset();
+	};
+
+	if (action == "open") {
+		std::string name;
+		if (!(cmdline_ss >> name) || name.front() != '/') {
+			std::cerr << "Error: no shared memory name like '/audioeq' given." << std::endl;
+			return;
+		}
+		close_surface();
+		try {
+			context.surface = std::make_unique<aeq::ParamSurface>(context.low_pass_filter, name.c_str());
+		} catch (const aeq::ParamSurfaceErr& e) {
+			std::cerr << e.what() << std::endl;
+			return;
+		}
+		context.low_pass_filter.attach_param_surface(context.surface.get());
+		std::cout << "Parameters at /dev/shm" << name << std::endl;
+	} else if (action == "close") {
+		close_surface();
+	} else {
+		std::cerr << "Error: usage - surface open </name>|close." << std::endl;
+	}
+}
+
+
+void BoringCLI::do_route(std::stringstream& cmdline_ss, CommandContext& context)
+{
+	std::string action;
+	cmdline_ss >> action;
+
+	std::vector<aeq::RoutingRule> rules = context.core.get_routing_rules();
+	if (action == "add") {
+		// '-' stands for any name or media class, the target name is the rest of the line
+		aeq::RoutingRule rule;
+		cmdline_ss >> rule.node_name_prefix >> rule.media_class >> std::ws;
+		std::getline(cmdline_ss, rule.target_node_name);
+		if (rule.target_node_name.empty()) {
+			std::cerr << "Error: usage - route add <name prefix|-> <media class|-> <target node name>." << std::endl;
+			return;
+		}
+		if (rule.node_name_prefix == "-")
+			rule.node_name_prefix.clear();
+		if (rule.media_class == "-")
+			rule.media_class.clear();
+		rules.push_back(std::move(rule));
+		context.core.set_routing_rules(std::move(rules));
+	} else if (action == "clear") {
+		context.core.set_routing_rules({});
+	} else if (action == "list") {
+		for (size_t i = 0; i < rules.size(); ++i) {
+			const aeq::RoutingRule& rule = rules[i];
+			std::cout << i << ": name '" << rule.node_name_prefix << "*', media class '"
+				  << rule.media_class << "' -> '" << rule.target_node_name << "'" << std::endl;
+		}
+	} else {
+		std::cerr << "Error: usage - route add|clear|list." << std::endl;
+	}
+}
+
+
 std::unordered_map<std::string, BoringCLI::CommandFunc> BoringCLI::commands = {
 	{"link", 	do_link},
 	{"unlink", 	do_unlink},
 	{"list", 	do_list},
 	{"freq", 	do_freq},
+	{"levels", 	do_levels},
+	{"stats", 	do_stats},
+	{"trace", 	do_trace},
+	{"record", 	do_record},
+	{"capture", 	do_capture},
+	{"surface", 	do_surface},
+	{"route", 	do_route},
 };